@@ -0,0 +1,311 @@
+// CFITSIO equivalents of the lib_fits benchmarks.
+//
+// CFITSIO has no asynchronous API, so the queue depth sweeps are replaced by
+// a frame-by-frame loop over the same cube.
+
+#include "common.hpp"
+
+#include <fitsio.h>
+
+namespace
+{
+    /**
+     * @brief CFITSIO image and datatype codes for a pixel type.
+     */
+    template <class T>
+    struct cfitsio_type;
+
+    template <>
+    struct cfitsio_type<std::uint8_t>
+    {
+        static constexpr int image = BYTE_IMG;
+        static constexpr int datatype = TBYTE;
+    };
+
+    template <>
+    struct cfitsio_type<std::int16_t>
+    {
+        static constexpr int image = SHORT_IMG;
+        static constexpr int datatype = TSHORT;
+    };
+
+    template <>
+    struct cfitsio_type<std::int32_t>
+    {
+        static constexpr int image = LONG_IMG;
+        static constexpr int datatype = TINT;
+    };
+
+    template <>
+    struct cfitsio_type<std::int64_t>
+    {
+        static constexpr int image = LONGLONG_IMG;
+        static constexpr int datatype = TLONGLONG;
+    };
+
+    template <>
+    struct cfitsio_type<float>
+    {
+        static constexpr int image = FLOAT_IMG;
+        static constexpr int datatype = TFLOAT;
+    };
+
+    template <>
+    struct cfitsio_type<double>
+    {
+        static constexpr int image = DOUBLE_IMG;
+        static constexpr int datatype = TDOUBLE;
+    };
+
+    /**
+     * @brief Abort the benchmark on a CFITSIO error.
+     *
+     * @return true if @p status reports an error
+     */
+    bool failed(benchmark::State &state, int status)
+    {
+        if (status != 0)
+        {
+            char message[FLEN_STATUS];
+            fits_get_errstatus(status, message);
+            state.SkipWithError(message);
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Write `hdus` images of `frames` x side x side pixels.
+     *
+     * The leading `!` makes CFITSIO overwrite an existing file, like ofits does.
+     *
+     * @return CFITSIO status
+     */
+    template <class T>
+    int write_file(const std::filesystem::path &filename, std::size_t hdus, std::size_t frames, std::size_t side, const std::vector<T> &frame)
+    {
+        int status = 0;
+        fitsfile *fptr = nullptr;
+
+        fits_create_file(&fptr, ("!" + filename.string()).c_str(), &status);
+
+        long naxes[3] = {static_cast<long>(side), static_cast<long>(side), static_cast<long>(frames)};
+
+        for (std::size_t h = 0; h < hdus && status == 0; ++h)
+        {
+            fits_create_img(fptr, cfitsio_type<T>::image, frames > 1 ? 3 : 2, naxes, &status);
+
+            for (std::size_t i = 0; i < frames && status == 0; ++i)
+            {
+                fits_write_img(fptr, cfitsio_type<T>::datatype, 1 + i * side * side, side * side,
+                               const_cast<T *>(frame.data()), &status);
+            }
+        }
+
+        if (fptr)
+        {
+            fits_close_file(fptr, &status);
+        }
+
+        return status;
+    }
+
+    /**
+     * @brief Read `hdus` images of `frames` x side x side pixels frame by frame.
+     *
+     * @return CFITSIO status
+     */
+    template <class T>
+    int read_file(const std::filesystem::path &filename, std::size_t hdus, std::size_t frames, std::size_t side, std::vector<T> &frame)
+    {
+        int status = 0;
+        int anynul = 0;
+        fitsfile *fptr = nullptr;
+
+        fits_open_file(&fptr, filename.c_str(), READONLY, &status);
+
+        for (std::size_t h = 0; h < hdus && status == 0; ++h)
+        {
+            fits_movabs_hdu(fptr, static_cast<int>(h + 1), nullptr, &status);
+
+            for (std::size_t i = 0; i < frames && status == 0; ++i)
+            {
+                fits_read_img(fptr, cfitsio_type<T>::datatype, 1 + i * side * side, side * side,
+                              nullptr, frame.data(), &anynul, &status);
+            }
+        }
+
+        if (fptr)
+        {
+            fits_close_file(fptr, &status);
+        }
+
+        return status;
+    }
+} // namespace
+
+//
+// Writing
+//
+
+// Write one side x side image
+template <class T>
+static void BM_cfitsio_write_sync(benchmark::State &state)
+{
+    const std::size_t side = state.range(0);
+    const auto data = bench::make_pixels<T>(side * side);
+    const auto filename = bench::scratch_file("cfitsio_write_sync.fits");
+
+    for (auto _ : state)
+    {
+        if (failed(state, write_file<T>(filename, 1, 1, side, data)))
+        {
+            break;
+        }
+    }
+
+    bench::set_processed(state, side * side, sizeof(T));
+}
+
+BENCHMARK_TEMPLATE(BM_cfitsio_write_sync, std::uint8_t)->ArgsProduct({bench::kImageSides});
+BENCHMARK_TEMPLATE(BM_cfitsio_write_sync, std::int16_t)->ArgsProduct({bench::kImageSides});
+BENCHMARK_TEMPLATE(BM_cfitsio_write_sync, std::int32_t)->ArgsProduct({bench::kImageSides});
+BENCHMARK_TEMPLATE(BM_cfitsio_write_sync, std::int64_t)->ArgsProduct({bench::kImageSides});
+BENCHMARK_TEMPLATE(BM_cfitsio_write_sync, float)->ArgsProduct({bench::kImageSides});
+BENCHMARK_TEMPLATE(BM_cfitsio_write_sync, double)->ArgsProduct({bench::kImageSides});
+
+// Write a cube frame by frame (counterpart of BM_lib_fits_write_async)
+template <class T>
+static void BM_cfitsio_write_cube(benchmark::State &state)
+{
+    const std::size_t side = state.range(0);
+    const auto data = bench::make_pixels<T>(side * side);
+    const auto filename = bench::scratch_file("cfitsio_write_cube.fits");
+
+    for (auto _ : state)
+    {
+        if (failed(state, write_file<T>(filename, 1, bench::kCubeFrames, side, data)))
+        {
+            break;
+        }
+    }
+
+    bench::set_processed(state, bench::kCubeFrames * side * side, sizeof(T));
+}
+
+BENCHMARK_TEMPLATE(BM_cfitsio_write_cube, std::int16_t)->Arg(256)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_cfitsio_write_cube, float)->Arg(256)->Arg(1024);
+
+// Write N HDUs of kHduSide x kHduSide pixels
+template <std::size_t N>
+static void BM_cfitsio_write_hdus(benchmark::State &state)
+{
+    const auto data = bench::make_pixels<float>(bench::kHduSide * bench::kHduSide);
+    const auto filename = bench::scratch_file("cfitsio_write_hdus.fits");
+
+    for (auto _ : state)
+    {
+        if (failed(state, write_file<float>(filename, N, 1, bench::kHduSide, data)))
+        {
+            break;
+        }
+    }
+
+    bench::set_processed(state, N * bench::kHduSide * bench::kHduSide, sizeof(float));
+}
+
+BENCHMARK_TEMPLATE(BM_cfitsio_write_hdus, 1);
+BENCHMARK_TEMPLATE(BM_cfitsio_write_hdus, 4);
+BENCHMARK_TEMPLATE(BM_cfitsio_write_hdus, 16);
+
+//
+// Reading
+//
+
+// Open a file and read one side x side image
+template <class T>
+static void BM_cfitsio_read_sync(benchmark::State &state)
+{
+    const std::size_t side = state.range(0);
+    auto buffer = bench::make_pixels<T>(side * side);
+    const auto filename = bench::scratch_file("cfitsio_read_sync.fits");
+
+    if (failed(state, write_file<T>(filename, 1, 1, side, buffer)))
+    {
+        return;
+    }
+
+    for (auto _ : state)
+    {
+        if (failed(state, read_file<T>(filename, 1, 1, side, buffer)))
+        {
+            break;
+        }
+        benchmark::DoNotOptimize(buffer.data());
+    }
+
+    bench::set_processed(state, side * side, sizeof(T));
+}
+
+BENCHMARK_TEMPLATE(BM_cfitsio_read_sync, std::uint8_t)->ArgsProduct({bench::kImageSides});
+BENCHMARK_TEMPLATE(BM_cfitsio_read_sync, std::int16_t)->ArgsProduct({bench::kImageSides});
+BENCHMARK_TEMPLATE(BM_cfitsio_read_sync, std::int32_t)->ArgsProduct({bench::kImageSides});
+BENCHMARK_TEMPLATE(BM_cfitsio_read_sync, std::int64_t)->ArgsProduct({bench::kImageSides});
+BENCHMARK_TEMPLATE(BM_cfitsio_read_sync, float)->ArgsProduct({bench::kImageSides});
+BENCHMARK_TEMPLATE(BM_cfitsio_read_sync, double)->ArgsProduct({bench::kImageSides});
+
+// Read a cube frame by frame (counterpart of BM_lib_fits_read_async)
+template <class T>
+static void BM_cfitsio_read_cube(benchmark::State &state)
+{
+    const std::size_t side = state.range(0);
+    auto buffer = bench::make_pixels<T>(side * side);
+    const auto filename = bench::scratch_file("cfitsio_read_cube.fits");
+
+    if (failed(state, write_file<T>(filename, 1, bench::kCubeFrames, side, buffer)))
+    {
+        return;
+    }
+
+    for (auto _ : state)
+    {
+        if (failed(state, read_file<T>(filename, 1, bench::kCubeFrames, side, buffer)))
+        {
+            break;
+        }
+        benchmark::DoNotOptimize(buffer.data());
+    }
+
+    bench::set_processed(state, bench::kCubeFrames * side * side, sizeof(T));
+}
+
+BENCHMARK_TEMPLATE(BM_cfitsio_read_cube, std::int16_t)->Arg(256)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_cfitsio_read_cube, float)->Arg(256)->Arg(1024);
+
+// Open a file with N HDUs and read all of them
+template <std::size_t N>
+static void BM_cfitsio_read_hdus(benchmark::State &state)
+{
+    auto buffer = bench::make_pixels<float>(bench::kHduSide * bench::kHduSide);
+    const auto filename = bench::scratch_file("cfitsio_read_hdus.fits");
+
+    if (failed(state, write_file<float>(filename, N, 1, bench::kHduSide, buffer)))
+    {
+        return;
+    }
+
+    for (auto _ : state)
+    {
+        if (failed(state, read_file<float>(filename, N, 1, bench::kHduSide, buffer)))
+        {
+            break;
+        }
+        benchmark::DoNotOptimize(buffer.data());
+    }
+
+    bench::set_processed(state, N * bench::kHduSide * bench::kHduSide, sizeof(float));
+}
+
+BENCHMARK_TEMPLATE(BM_cfitsio_read_hdus, 1);
+BENCHMARK_TEMPLATE(BM_cfitsio_read_hdus, 4);
+BENCHMARK_TEMPLATE(BM_cfitsio_read_hdus, 16);
@@ -0,0 +1,353 @@
+// Benchmarks for lib_fits: synchronous, asynchronous and memory-mapped
+// reading and writing across image sizes, BITPIX types, HDU counts and
+// queue depths.
+
+#include "common.hpp"
+
+#include <lib_fits.hpp>
+
+// STL
+#include <array>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+// POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Boost
+#include <boost/asio.hpp>
+
+namespace
+{
+    /**
+     * @brief Alias used to repeat a pixel type once per HDU.
+     */
+    template <class T, std::size_t>
+    using repeat_t = T;
+
+    /**
+     * @brief ofits with N image HDUs of type T.
+     */
+    template <class T, std::size_t... Is>
+    auto make_ofits(const std::filesystem::path &filename, std::size_t side, std::index_sequence<Is...>)
+    {
+        return std::make_unique<ofits<repeat_t<T, Is>...>>(filename, std::array<std::initializer_list<std::size_t>, sizeof...(Is)>{((void)Is, std::initializer_list<std::size_t>{side, side})...});
+    }
+
+    /**
+     * @brief Write a cube of `frames` frames of side x side pixels.
+     *
+     * Used to prepare the input of the read benchmarks outside of the timed loop.
+     */
+    template <class T>
+    void prepare_cube(const std::filesystem::path &filename, std::size_t frames, std::size_t side)
+    {
+        const auto frame = bench::make_pixels<T>(side * side);
+
+        ofits<T> file(filename, {{{frames, side, side}}});
+
+        for (std::size_t i = 0; i < frames; ++i)
+        {
+            file.template write_data<0>({i}, boost::asio::buffer(frame));
+        }
+    }
+
+    /**
+     * @brief Keeps `depth` asynchronous operations in flight over `count` frames.
+     *
+     * Every completion submits the next frame, so the queue stays full until
+     * all frames are submitted. The caller runs the io_context after start().
+     *
+     * @tparam Submit Callable (frame, slot, completion) issuing one operation
+     */
+    template <class Submit>
+    class pipeline
+    {
+    public:
+        pipeline(std::size_t depth, std::size_t count, Submit submit)
+            : depth_(depth), count_(count), submit_(std::move(submit))
+        {
+        }
+
+        /**
+         * @brief Submit the first `depth` operations.
+         */
+        void start()
+        {
+            for (std::size_t slot = 0; slot < std::min(depth_, count_); ++slot)
+            {
+                step(slot);
+            }
+        }
+
+        /**
+         * @brief Whether any operation completed with an error.
+         */
+        bool failed() const noexcept
+        {
+            return failed_;
+        }
+
+    private:
+        void step(std::size_t slot)
+        {
+            if (next_ < count_ && !failed_)
+            {
+                submit_(next_++, slot, [this, slot](const boost::system::error_code &error, std::size_t)
+                        {
+                    if (error)
+                    {
+                        failed_ = true;
+                        return;
+                    }
+                    step(slot); });
+            }
+        }
+
+        std::size_t depth_;    // Number of operations in flight
+        std::size_t count_;    // Number of frames to process
+        std::size_t next_ = 0; // Next frame to submit
+        bool failed_ = false;  // Whether an operation failed
+        Submit submit_;        // Operation factory
+    };
+} // namespace
+
+//
+// Writing
+//
+
+// Write one side x side image in a single synchronous call
+template <class T>
+static void BM_lib_fits_write_sync(benchmark::State &state)
+{
+    const std::size_t side = state.range(0);
+    const auto data = bench::make_pixels<T>(side * side);
+    const auto filename = bench::scratch_file("lib_fits_write_sync.fits");
+
+    for (auto _ : state)
+    {
+        ofits<T> file(filename, {{{side, side}}});
+        file.template write_data<0>({0}, boost::asio::buffer(data));
+    }
+
+    bench::set_processed(state, side * side, sizeof(T));
+}
+
+BENCHMARK_TEMPLATE(BM_lib_fits_write_sync, std::uint8_t)->ArgsProduct({bench::kImageSides});
+BENCHMARK_TEMPLATE(BM_lib_fits_write_sync, std::int16_t)->ArgsProduct({bench::kImageSides});
+BENCHMARK_TEMPLATE(BM_lib_fits_write_sync, std::int32_t)->ArgsProduct({bench::kImageSides});
+BENCHMARK_TEMPLATE(BM_lib_fits_write_sync, std::int64_t)->ArgsProduct({bench::kImageSides});
+BENCHMARK_TEMPLATE(BM_lib_fits_write_sync, float)->ArgsProduct({bench::kImageSides});
+BENCHMARK_TEMPLATE(BM_lib_fits_write_sync, double)->ArgsProduct({bench::kImageSides});
+
+// Write a cube frame by frame keeping `queue depth` writes in flight
+template <class T>
+static void BM_lib_fits_write_async(benchmark::State &state)
+{
+    const std::size_t side = state.range(0);
+    const std::size_t depth = state.range(1);
+    const auto data = bench::make_pixels<T>(side * side);
+    const auto filename = bench::scratch_file("lib_fits_write_async.fits");
+
+    for (auto _ : state)
+    {
+        ofits<T> file(filename, {{{bench::kCubeFrames, side, side}}});
+
+        pipeline writes(depth, bench::kCubeFrames, [&](std::size_t frame, std::size_t, auto completion)
+                        { file.template async_write_data<0>({frame}, boost::asio::buffer(data), completion); });
+
+        writes.start();
+        file.run();
+
+        if (writes.failed())
+        {
+            state.SkipWithError("async write failed");
+            break;
+        }
+    }
+
+    bench::set_processed(state, bench::kCubeFrames * side * side, sizeof(T));
+}
+
+BENCHMARK_TEMPLATE(BM_lib_fits_write_async, std::int16_t)->ArgsProduct({{256, 1024}, bench::kQueueDepths});
+BENCHMARK_TEMPLATE(BM_lib_fits_write_async, float)->ArgsProduct({{256, 1024}, bench::kQueueDepths});
+
+// Write N HDUs of kHduSide x kHduSide pixels
+template <std::size_t N>
+static void BM_lib_fits_write_hdus(benchmark::State &state)
+{
+    const auto data = bench::make_pixels<float>(bench::kHduSide * bench::kHduSide);
+    const auto filename = bench::scratch_file("lib_fits_write_hdus.fits");
+
+    for (auto _ : state)
+    {
+        auto file = make_ofits<float>(filename, bench::kHduSide, std::make_index_sequence<N>{});
+
+        [&]<std::size_t... Is>(std::index_sequence<Is...>)
+        {
+            (file->template write_data<Is>({0}, boost::asio::buffer(data)), ...);
+        }(std::make_index_sequence<N>{});
+    }
+
+    bench::set_processed(state, N * bench::kHduSide * bench::kHduSide, sizeof(float));
+}
+
+BENCHMARK_TEMPLATE(BM_lib_fits_write_hdus, 1);
+BENCHMARK_TEMPLATE(BM_lib_fits_write_hdus, 4);
+BENCHMARK_TEMPLATE(BM_lib_fits_write_hdus, 16);
+
+//
+// Reading
+//
+
+// Open a file and read one side x side image in a single synchronous call
+template <class T>
+static void BM_lib_fits_read_sync(benchmark::State &state)
+{
+    const std::size_t side = state.range(0);
+    const auto filename = bench::scratch_file("lib_fits_read_sync.fits");
+
+    prepare_cube<T>(filename, 1, side);
+
+    std::vector<T> buffer(side * side);
+
+    for (auto _ : state)
+    {
+        ifits file(filename);
+        file.get_hdu<0>().apply([&](auto image)
+                                { image.read_data({0}, boost::asio::buffer(buffer)); });
+        benchmark::DoNotOptimize(buffer.data());
+    }
+
+    bench::set_processed(state, side * side, sizeof(T));
+}
+
+BENCHMARK_TEMPLATE(BM_lib_fits_read_sync, std::uint8_t)->ArgsProduct({bench::kImageSides});
+BENCHMARK_TEMPLATE(BM_lib_fits_read_sync, std::int16_t)->ArgsProduct({bench::kImageSides});
+BENCHMARK_TEMPLATE(BM_lib_fits_read_sync, std::int32_t)->ArgsProduct({bench::kImageSides});
+BENCHMARK_TEMPLATE(BM_lib_fits_read_sync, std::int64_t)->ArgsProduct({bench::kImageSides});
+BENCHMARK_TEMPLATE(BM_lib_fits_read_sync, float)->ArgsProduct({bench::kImageSides});
+BENCHMARK_TEMPLATE(BM_lib_fits_read_sync, double)->ArgsProduct({bench::kImageSides});
+
+// Read a cube frame by frame keeping `queue depth` reads in flight
+template <class T>
+static void BM_lib_fits_read_async(benchmark::State &state)
+{
+    const std::size_t side = state.range(0);
+    const std::size_t depth = state.range(1);
+    const auto filename = bench::scratch_file("lib_fits_read_async.fits");
+
+    prepare_cube<T>(filename, bench::kCubeFrames, side);
+
+    ifits file(filename);
+
+    // One buffer per in-flight read
+    std::vector<std::vector<T>> buffers(depth, std::vector<T>(side * side));
+
+    for (auto _ : state)
+    {
+        bool failed = file.get_hdu<0>().apply([&](auto image)
+                                              {
+            pipeline reads(depth, bench::kCubeFrames, [&](std::size_t frame, std::size_t slot, auto completion)
+                           { image.async_read_data({frame}, boost::asio::buffer(buffers[slot]), completion); });
+
+            file.restart(); // The previous iteration ran the io_context out of work
+            reads.start();
+            file.run();
+
+            return reads.failed(); });
+
+        if (failed)
+        {
+            state.SkipWithError("async read failed");
+            break;
+        }
+    }
+
+    bench::set_processed(state, bench::kCubeFrames * side * side, sizeof(T));
+}
+
+BENCHMARK_TEMPLATE(BM_lib_fits_read_async, std::int16_t)->ArgsProduct({{256, 1024}, bench::kQueueDepths});
+BENCHMARK_TEMPLATE(BM_lib_fits_read_async, float)->ArgsProduct({{256, 1024}, bench::kQueueDepths});
+
+// Open a file with N HDUs and read all of them
+template <std::size_t N>
+static void BM_lib_fits_read_hdus(benchmark::State &state)
+{
+    const auto data = bench::make_pixels<float>(bench::kHduSide * bench::kHduSide);
+    const auto filename = bench::scratch_file("lib_fits_read_hdus.fits");
+
+    {
+        auto file = make_ofits<float>(filename, bench::kHduSide, std::make_index_sequence<N>{});
+
+        [&]<std::size_t... Is>(std::index_sequence<Is...>)
+        {
+            (file->template write_data<Is>({0}, boost::asio::buffer(data)), ...);
+        }(std::make_index_sequence<N>{});
+    }
+
+    std::vector<float> buffer(bench::kHduSide * bench::kHduSide);
+
+    for (auto _ : state)
+    {
+        ifits file(filename);
+
+        [&]<std::size_t... Is>(std::index_sequence<Is...>)
+        {
+            (file.get_hdu<Is>().apply([&](auto image)
+                                      { image.read_data({0}, boost::asio::buffer(buffer)); }),
+             ...);
+        }(std::make_index_sequence<N>{});
+
+        benchmark::DoNotOptimize(buffer.data());
+    }
+
+    bench::set_processed(state, N * bench::kHduSide * bench::kHduSide, sizeof(float));
+}
+
+BENCHMARK_TEMPLATE(BM_lib_fits_read_hdus, 1);
+BENCHMARK_TEMPLATE(BM_lib_fits_read_hdus, 4);
+BENCHMARK_TEMPLATE(BM_lib_fits_read_hdus, 16);
+
+// Baseline: read the same image through mmap + memcpy.
+// lib_fits has no memory-mapped mode, this is the ceiling the page cache allows.
+template <class T>
+static void BM_baseline_mmap_read(benchmark::State &state)
+{
+    const std::size_t side = state.range(0);
+    const auto filename = bench::scratch_file("baseline_mmap_read.fits");
+
+    prepare_cube<T>(filename, 1, side);
+
+    // The data block of the primary HDU starts right after its header block
+    constexpr std::size_t kDataOffset = 2880;
+    const std::size_t size = kDataOffset + side * side * sizeof(T);
+
+    std::vector<T> buffer(side * side);
+
+    for (auto _ : state)
+    {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        void *map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED)
+        {
+            ::close(fd);
+            state.SkipWithError("mmap failed");
+            break;
+        }
+
+        std::memcpy(buffer.data(), static_cast<const char *>(map) + kDataOffset, side * side * sizeof(T));
+        benchmark::DoNotOptimize(buffer.data());
+
+        ::munmap(map, size);
+        ::close(fd);
+    }
+
+    bench::set_processed(state, side * side, sizeof(T));
+}
+
+BENCHMARK_TEMPLATE(BM_baseline_mmap_read, std::int16_t)->ArgsProduct({bench::kImageSides});
+BENCHMARK_TEMPLATE(BM_baseline_mmap_read, float)->ArgsProduct({bench::kImageSides});
@@ -0,0 +1,148 @@
+// Memory footprint of resident headers: opens files with N extensions and K
+// extra keywords per header, keeps them open and reports the growth of the
+// resident set size next to the bytes accounted by ifits::get_memory_usage().
+
+#include "common.hpp"
+
+#include <lib_fits.hpp>
+
+// STL
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace
+{
+    /**
+     * @brief Number of files kept open by one iteration.
+     */
+    constexpr std::size_t kOpenFiles = 16;
+
+    /**
+     * @brief Extension counts of the sweep.
+     */
+    const std::vector<std::int64_t> kExtensions = {1, 16, 256};
+
+    /**
+     * @brief Extra keywords per header of the sweep.
+     */
+    const std::vector<std::int64_t> kHeaderCards = {16, 128};
+
+    /**
+     * @brief Append one 80-character header card.
+     */
+    void append_card(std::string &header, const char *key, const std::string &value)
+    {
+        char card[81];
+        std::snprintf(card, sizeof(card), "%-8s= %20s", key, value.c_str());
+
+        std::string padded(card);
+        padded.resize(80, ' ');
+        header += padded;
+    }
+
+    /**
+     * @brief Write a file with the given number of 8x8 int16 image extensions.
+     *
+     * The file is written directly: ofits takes the HDU types as template
+     * arguments and cannot create hundreds of extensions.
+     */
+    std::filesystem::path extensions_file(std::size_t extensions, std::size_t cards)
+    {
+        auto filename = bench::scratch_file("memory_" + std::to_string(extensions) + "_" + std::to_string(cards) + ".fits");
+
+        std::ofstream file(filename, std::ios::binary);
+
+        for (std::size_t i = 0; i < extensions; ++i)
+        {
+            std::string header;
+            if (i == 0)
+            {
+                append_card(header, "SIMPLE", "T");
+            }
+            else
+            {
+                append_card(header, "XTENSION", "'IMAGE   '");
+            }
+            append_card(header, "BITPIX", "16");
+            append_card(header, "NAXIS", "2");
+            append_card(header, "NAXIS1", "8");
+            append_card(header, "NAXIS2", "8");
+            append_card(header, "EXTEND", "T");
+
+            for (std::size_t card = 0; card < cards; ++card)
+            {
+                char key[9];
+                std::snprintf(key, sizeof(key), "KEY%05zu", card);
+                append_card(header, key, std::to_string(card * 1000 + i));
+            }
+
+            header += std::string("END").append(77, ' ');
+            header.resize((header.size() + 2879) / 2880 * 2880, ' ');
+
+            file << header << std::string(2880, '\0'); // 8x8 int16 pixels, padded to one block
+        }
+
+        return filename;
+    }
+
+    /**
+     * @brief Return the freed memory of the previous iteration to the system.
+     */
+    void release_free_memory()
+    {
+#if defined(__GLIBC__)
+        malloc_trim(0);
+#endif
+    }
+} // namespace
+
+// Keep kOpenFiles files with N extensions of K extra keywords open
+static void BM_lib_fits_memory_headers(benchmark::State &state)
+{
+    const auto extensions = static_cast<std::size_t>(state.range(0));
+    const auto cards = static_cast<std::size_t>(state.range(1));
+
+    const auto filename = extensions_file(extensions, cards);
+
+    double resident = 0;
+    double accounted = 0;
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        release_free_memory();
+        const auto before = bench::resident_bytes();
+        state.ResumeTiming();
+
+        std::vector<std::unique_ptr<ifits>> files;
+        for (std::size_t i = 0; i < kOpenFiles; ++i)
+        {
+            files.push_back(std::make_unique<ifits>(filename));
+        }
+
+        state.PauseTiming();
+        resident += static_cast<double>(bench::resident_bytes()) - static_cast<double>(before);
+        for (const auto &file : files)
+        {
+            accounted += static_cast<double>(file->get_memory_usage().total());
+        }
+        files.clear();
+        state.ResumeTiming();
+    }
+
+    const double hdus = static_cast<double>(state.iterations() * kOpenFiles * extensions);
+
+    state.counters["rss_per_hdu"] = resident / hdus;
+    state.counters["accounted_per_hdu"] = accounted / hdus;
+    state.counters["rss_per_file"] = resident / static_cast<double>(state.iterations() * kOpenFiles);
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * kOpenFiles));
+}
+
+BENCHMARK(BM_lib_fits_memory_headers)->ArgsProduct({kExtensions, kHeaderCards})->Unit(benchmark::kMillisecond);
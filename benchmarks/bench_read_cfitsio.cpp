@@ -0,0 +1,370 @@
+// CFITSIO equivalents of the read-path benchmarks in bench_read_lib_fits.cpp.
+// The same shapes, positions and data are used so that the rows of the JSON
+// report can be compared directly.
+
+#include "common.hpp"
+
+#include <fitsio.h>
+
+// STL
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+    /**
+     * @brief Throw on a CFITSIO error while preparing the corpus.
+     *
+     * @param status CFITSIO status
+     */
+    void check(int status)
+    {
+        if (status != 0)
+        {
+            char message[FLEN_STATUS];
+            fits_get_errstatus(status, message);
+            throw std::runtime_error(std::string("CFITSIO: ") + message);
+        }
+    }
+
+    /**
+     * @brief Open a file for reading, throwing on error.
+     */
+    fitsfile *open_file(const std::filesystem::path &filename)
+    {
+        int status = 0;
+        fitsfile *fptr = nullptr;
+        fits_open_file(&fptr, filename.c_str(), READONLY, &status);
+        check(status);
+        return fptr;
+    }
+
+    /**
+     * @brief Close a file opened with open_file().
+     */
+    void close_file(fitsfile *fptr)
+    {
+        int status = 0;
+        fits_close_file(fptr, &status);
+    }
+
+    /**
+     * @brief Create an image file and write it row by row.
+     *
+     * @param filename File name
+     * @param naxes Axes in CFITSIO order (fastest first)
+     * @param row Data of one row of naxes[0] pixels
+     * @param header Extra keywords to write
+     */
+    template <class T>
+    void write_image(const std::filesystem::path &filename, std::vector<long> naxes, const std::vector<T> &row, int bitpix, int datatype,
+                     const std::vector<std::pair<std::string, std::string>> &header = {})
+    {
+        int status = 0;
+        fitsfile *fptr = nullptr;
+
+        fits_create_file(&fptr, ("!" + filename.string()).c_str(), &status);
+        fits_create_img(fptr, bitpix, static_cast<int>(naxes.size()), naxes.data(), &status);
+
+        for (const auto &[key, value] : header)
+        {
+            fits_write_key(fptr, TSTRING, key.c_str(), const_cast<char *>(value.c_str()), nullptr, &status);
+        }
+
+        long pixels = 1;
+        for (long axis : naxes)
+        {
+            pixels *= axis;
+        }
+
+        for (long first = 0; first < pixels && status == 0; first += naxes[0])
+        {
+            fits_write_img(fptr, datatype, first + 1, naxes[0], const_cast<T *>(row.data()), &status);
+        }
+
+        fits_close_file(fptr, &status);
+        check(status);
+    }
+
+    const std::filesystem::path &cube_file()
+    {
+        static const auto filename = []
+        {
+            using namespace bench::read;
+            auto filename = bench::scratch_file("cfitsio_read_cube.fits");
+            write_image(filename, {kCubeSide, kCubeSide, kCubeFrames}, bench::make_pixels<float>(kCubeSide), FLOAT_IMG, TFLOAT);
+            return filename;
+        }();
+        return filename;
+    }
+
+    const std::filesystem::path &mosaic_file()
+    {
+        static const auto filename = []
+        {
+            using namespace bench::read;
+            auto filename = bench::scratch_file("cfitsio_read_mosaic.fits");
+            write_image(filename, {kMosaicSide, kMosaicSide}, bench::make_pixels<float>(kMosaicSide), FLOAT_IMG, TFLOAT);
+            return filename;
+        }();
+        return filename;
+    }
+
+    const std::vector<std::filesystem::path> &small_files()
+    {
+        static const auto filenames = []
+        {
+            using namespace bench::read;
+            std::vector<std::filesystem::path> filenames;
+            for (std::size_t i = 0; i < kSmallFiles; ++i)
+            {
+                auto filename = bench::scratch_file("cfitsio_small_" + std::to_string(i) + ".fits");
+                write_image(filename, {kSmallSide, kSmallSide}, bench::make_pixels<std::int16_t>(kSmallSide), SHORT_IMG, TSHORT,
+                            {{"OBJECT", "BENCH"}, {"EXPTIME", std::to_string(i)}});
+                filenames.push_back(filename);
+            }
+            return filenames;
+        }();
+        return filenames;
+    }
+
+    const std::filesystem::path &table_file()
+    {
+        static const auto filename = []
+        {
+            using namespace bench::read;
+            auto filename = bench::scratch_file("cfitsio_read_table.fits");
+
+            int status = 0;
+            fitsfile *fptr = nullptr;
+
+            char *ttype[] = {const_cast<char *>("RA"), const_cast<char *>("DEC"), const_cast<char *>("MAG"), const_cast<char *>("ID")};
+            char *tform[] = {const_cast<char *>("1D"), const_cast<char *>("1D"), const_cast<char *>("1E"), const_cast<char *>("1J")};
+
+            fits_create_file(&fptr, ("!" + filename.string()).c_str(), &status);
+            fits_create_tbl(fptr, BINARY_TBL, kTableRows, 4, ttype, tform, nullptr, "CATALOG", &status);
+
+            std::vector<double> ra(kTableChunk), dec(kTableChunk);
+            std::vector<float> mag(kTableChunk);
+            std::vector<int> id(kTableChunk);
+
+            for (std::size_t first = 0; first < kTableRows && status == 0; first += kTableChunk)
+            {
+                for (std::size_t i = 0; i < kTableChunk; ++i)
+                {
+                    const std::size_t row = first + i;
+                    ra[i] = row * 1e-3;
+                    dec[i] = -static_cast<double>(row) * 1e-3;
+                    mag[i] = (row % 2000) * 0.01f;
+                    id[i] = static_cast<int>(row);
+                }
+                fits_write_col(fptr, TDOUBLE, 1, first + 1, 1, kTableChunk, ra.data(), &status);
+                fits_write_col(fptr, TDOUBLE, 2, first + 1, 1, kTableChunk, dec.data(), &status);
+                fits_write_col(fptr, TFLOAT, 3, first + 1, 1, kTableChunk, mag.data(), &status);
+                fits_write_col(fptr, TINT, 4, first + 1, 1, kTableChunk, id.data(), &status);
+            }
+
+            fits_close_file(fptr, &status);
+            check(status);
+
+            return filename;
+        }();
+        return filename;
+    }
+} // namespace
+
+// Read the whole cube frame by frame, latency per frame
+static void BM_cfitsio_read_sequential(benchmark::State &state)
+{
+    using namespace bench::read;
+
+    fitsfile *fptr = open_file(cube_file());
+
+    std::vector<float> frame(kCubeSide * kCubeSide);
+    int status = 0, anynul = 0;
+
+    bench::latency_recorder latency;
+    bench::syscall_counter syscalls;
+
+    for (auto _ : state)
+    {
+        syscalls.start();
+        for (std::size_t i = 0; i < kCubeFrames; ++i)
+        {
+            latency.time([&]
+                         { fits_read_img(fptr, TFLOAT, 1 + i * frame.size(), frame.size(), nullptr, frame.data(), &anynul, &status); });
+        }
+        syscalls.stop();
+        benchmark::DoNotOptimize(frame.data());
+    }
+
+    close_file(fptr);
+
+    bench::set_processed(state, kCubeFrames * kCubeSide * kCubeSide, sizeof(float));
+    latency.report(state);
+    syscalls.report(state);
+}
+
+BENCHMARK(BM_cfitsio_read_sequential);
+
+// Read random single pixels of the cube, latency per pixel
+static void BM_cfitsio_read_random_pixel(benchmark::State &state)
+{
+    using namespace bench::read;
+
+    fitsfile *fptr = open_file(cube_file());
+
+    const auto frames = bench::random_positions(kPixels, kCubeFrames, 1);
+    const auto ys = bench::random_positions(kPixels, kCubeSide, 2);
+    const auto xs = bench::random_positions(kPixels, kCubeSide, 3);
+
+    float value = 0;
+    int status = 0, anynul = 0;
+
+    bench::latency_recorder latency;
+    bench::syscall_counter syscalls;
+
+    for (auto _ : state)
+    {
+        syscalls.start();
+        for (std::size_t i = 0; i < kPixels; ++i)
+        {
+            // CFITSIO pixel coordinates are 1-based and fastest axis first
+            long fpixel[3] = {static_cast<long>(xs[i] + 1), static_cast<long>(ys[i] + 1), static_cast<long>(frames[i] + 1)};
+            latency.time([&]
+                         { fits_read_pix(fptr, TFLOAT, fpixel, 1, nullptr, &value, &anynul, &status); });
+            benchmark::DoNotOptimize(value);
+        }
+        syscalls.stop();
+    }
+
+    close_file(fptr);
+
+    bench::set_processed(state, kPixels, sizeof(float));
+    latency.report(state);
+    syscalls.report(state);
+}
+
+BENCHMARK(BM_cfitsio_read_random_pixel);
+
+// Read random cutouts of the mosaic, latency per cutout
+static void BM_cfitsio_read_cutout(benchmark::State &state)
+{
+    using namespace bench::read;
+
+    fitsfile *fptr = open_file(mosaic_file());
+
+    const auto ys = bench::random_positions(kCutouts, kMosaicSide - kCutoutSide, 4);
+    const auto xs = bench::random_positions(kCutouts, kMosaicSide - kCutoutSide, 5);
+
+    std::vector<float> cutout(kCutoutSide * kCutoutSide);
+    int status = 0, anynul = 0;
+
+    bench::latency_recorder latency;
+    bench::syscall_counter syscalls;
+
+    for (auto _ : state)
+    {
+        syscalls.start();
+        for (std::size_t i = 0; i < kCutouts; ++i)
+        {
+            long fpixel[2] = {static_cast<long>(xs[i] + 1), static_cast<long>(ys[i] + 1)};
+            long lpixel[2] = {static_cast<long>(xs[i] + kCutoutSide), static_cast<long>(ys[i] + kCutoutSide)};
+            long inc[2] = {1, 1};
+            latency.time([&]
+                         { fits_read_subset(fptr, TFLOAT, fpixel, lpixel, inc, nullptr, cutout.data(), &anynul, &status); });
+        }
+        syscalls.stop();
+        benchmark::DoNotOptimize(cutout.data());
+    }
+
+    close_file(fptr);
+
+    bench::set_processed(state, kCutouts * kCutoutSide * kCutoutSide, sizeof(float));
+    latency.report(state);
+    syscalls.report(state);
+}
+
+BENCHMARK(BM_cfitsio_read_cutout);
+
+// Open many small files and read one keyword, latency per file
+static void BM_cfitsio_open_headers(benchmark::State &state)
+{
+    using namespace bench::read;
+
+    const auto &filenames = small_files();
+
+    bench::latency_recorder latency;
+    bench::syscall_counter syscalls;
+
+    for (auto _ : state)
+    {
+        syscalls.start();
+        for (const auto &filename : filenames)
+        {
+            latency.time([&]
+                         {
+                int status = 0, bitpix = 0;
+                fitsfile *fptr = open_file(filename);
+                fits_read_key(fptr, TINT, "BITPIX", &bitpix, nullptr, &status);
+                benchmark::DoNotOptimize(bitpix);
+                close_file(fptr); });
+        }
+        syscalls.stop();
+    }
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * kSmallFiles));
+    latency.report(state);
+    syscalls.report(state);
+}
+
+BENCHMARK(BM_cfitsio_open_headers);
+
+// Scan the MAG column of the table in chunks of rows, latency per chunk
+static void BM_cfitsio_column_scan(benchmark::State &state)
+{
+    using namespace bench::read;
+
+    fitsfile *fptr = open_file(table_file());
+
+    int status = 0, anynul = 0;
+    fits_movabs_hdu(fptr, 2, nullptr, &status);
+
+    std::vector<float> column(kTableChunk);
+
+    bench::latency_recorder latency;
+    bench::syscall_counter syscalls;
+
+    for (auto _ : state)
+    {
+        double sum = 0;
+
+        syscalls.start();
+        for (std::size_t first = 0; first < kTableRows; first += kTableChunk)
+        {
+            latency.time([&]
+                         { fits_read_col(fptr, TFLOAT, 3, first + 1, 1, kTableChunk, nullptr, column.data(), &anynul, &status); });
+
+            for (float mag : column)
+            {
+                sum += mag;
+            }
+        }
+        syscalls.stop();
+
+        benchmark::DoNotOptimize(sum);
+    }
+
+    close_file(fptr);
+
+    if (status != 0)
+    {
+        state.SkipWithError("fits_read_col failed");
+    }
+
+    bench::set_processed(state, kTableRows, sizeof(float));
+    latency.report(state);
+    syscalls.report(state);
+}
+
+BENCHMARK(BM_cfitsio_column_scan);
@@ -0,0 +1,392 @@
+// Read-path benchmarks for lib_fits: sequential cube reads, plain and
+// converted to double, random pixels, random cutouts, sampled display
+// limits, header-only opens of many small files and a table column scan.
+// Every scenario reports throughput, p50/p99 latency of one operation and
+// the number of I/O system calls per iteration.
+
+#include "common.hpp"
+
+#include <lib_fits.hpp>
+
+// STL
+#include <cstring>
+#include <string>
+
+// Boost
+#include <boost/asio.hpp>
+
+namespace
+{
+    /**
+     * @brief Path of a read corpus file, created once per process.
+     *
+     * @param name File name
+     * @param prepare Callable writing the file
+     * @return Path of the file
+     */
+    template <class Prepare>
+    std::filesystem::path corpus_file(const std::string &name, Prepare prepare)
+    {
+        const auto filename = bench::scratch_file(name);
+        prepare(filename);
+        return filename;
+    }
+
+    const std::filesystem::path &cube_file()
+    {
+        static const auto filename = corpus_file("lib_fits_read_cube.fits", [](const auto &filename)
+                                                 {
+            using namespace bench::read;
+            const auto frame = bench::make_pixels<float>(kCubeSide * kCubeSide);
+            ofits<float> file(filename, {{{kCubeFrames, kCubeSide, kCubeSide}}});
+            for (std::size_t i = 0; i < kCubeFrames; ++i)
+            {
+                file.write_data<0>({i}, boost::asio::buffer(frame));
+            } });
+        return filename;
+    }
+
+    const std::filesystem::path &mosaic_file()
+    {
+        static const auto filename = corpus_file("lib_fits_read_mosaic.fits", [](const auto &filename)
+                                                 {
+            using namespace bench::read;
+            const auto row = bench::make_pixels<float>(kMosaicSide);
+            ofits<float> file(filename, {{{kMosaicSide, kMosaicSide}}});
+            for (std::size_t y = 0; y < kMosaicSide; ++y)
+            {
+                file.write_data<0>({y}, boost::asio::buffer(row));
+            } });
+        return filename;
+    }
+
+    const std::vector<std::filesystem::path> &small_files()
+    {
+        static const auto filenames = []
+        {
+            using namespace bench::read;
+            const auto image = bench::make_pixels<std::int16_t>(kSmallSide * kSmallSide);
+            std::vector<std::filesystem::path> filenames;
+            for (std::size_t i = 0; i < kSmallFiles; ++i)
+            {
+                filenames.push_back(corpus_file("lib_fits_small_" + std::to_string(i) + ".fits", [&](const auto &filename)
+                                                {
+                    ofits<std::int16_t> file(filename, {{{kSmallSide, kSmallSide}}});
+                    file.value_as<0>("OBJECT", "BENCH");
+                    file.value_as<0>("EXPTIME", std::to_string(i));
+                    file.write_data<0>({0}, boost::asio::buffer(image)); }));
+            }
+            return filenames;
+        }();
+        return filenames;
+    }
+
+    // lib_fits has no BINTABLE API: the table is stored as an 8-bit image with
+    // one row of kRowSize bytes per table row, which has the same data layout
+    const std::filesystem::path &table_file()
+    {
+        static const auto filename = corpus_file("lib_fits_read_table.fits", [](const auto &filename)
+                                                 {
+            using namespace bench::read;
+            std::vector<std::uint8_t> chunk(kTableChunk * kRowSize);
+            ofits<std::uint8_t> file(filename, {{{kTableRows, kRowSize}}});
+            for (std::size_t first = 0; first < kTableRows; first += kTableChunk)
+            {
+                for (std::size_t i = 0; i < kTableChunk; ++i)
+                {
+                    const std::size_t row = first + i;
+                    const double ra = row * 1e-3, dec = -static_cast<double>(row) * 1e-3;
+                    const float mag = (row % 2000) * 0.01f;
+                    const std::int32_t id = static_cast<std::int32_t>(row);
+                    auto *bytes = chunk.data() + i * kRowSize;
+                    std::memcpy(bytes, &ra, 8);
+                    std::memcpy(bytes + 8, &dec, 8);
+                    std::memcpy(bytes + 16, &mag, 4);
+                    std::memcpy(bytes + 20, &id, 4);
+                }
+                file.write_data<0>({first}, boost::asio::buffer(chunk));
+            } });
+        return filename;
+    }
+} // namespace
+
+// Read the whole cube frame by frame, latency per frame
+static void BM_lib_fits_read_sequential(benchmark::State &state)
+{
+    using namespace bench::read;
+
+    ifits file(cube_file());
+    auto image = ifits::hdu::image_hdu<float>(file.get_hdu<0>());
+
+    std::vector<float> frame(kCubeSide * kCubeSide);
+
+    bench::latency_recorder latency;
+    bench::syscall_counter syscalls;
+
+    for (auto _ : state)
+    {
+        syscalls.start();
+        for (std::size_t i = 0; i < kCubeFrames; ++i)
+        {
+            latency.time([&]
+                         { image.read_data({i}, boost::asio::buffer(frame)); });
+        }
+        syscalls.stop();
+        benchmark::DoNotOptimize(frame.data());
+    }
+
+    bench::set_processed(state, kCubeFrames * kCubeSide * kCubeSide, sizeof(float));
+    latency.report(state);
+    syscalls.report(state);
+}
+
+BENCHMARK(BM_lib_fits_read_sequential);
+
+// Read the whole cube frame by frame converted to double, latency per frame
+static void BM_lib_fits_read_as_double(benchmark::State &state)
+{
+    using namespace bench::read;
+
+    ifits file(cube_file());
+    auto &hdu = file.get_hdu<0>();
+
+    std::vector<double> frame(kCubeSide * kCubeSide);
+
+    bench::latency_recorder latency;
+    bench::syscall_counter syscalls;
+
+    for (auto _ : state)
+    {
+        syscalls.start();
+        for (std::size_t i = 0; i < kCubeFrames; ++i)
+        {
+            latency.time([&]
+                         { hdu.read_as(image_region{{i, 0, 0}, {1, kCubeSide, kCubeSide}}, std::span(frame)); });
+        }
+        syscalls.stop();
+        benchmark::DoNotOptimize(frame.data());
+    }
+
+    bench::set_processed(state, kCubeFrames * kCubeSide * kCubeSide, sizeof(float));
+    latency.report(state);
+    syscalls.report(state);
+}
+
+BENCHMARK(BM_lib_fits_read_as_double);
+
+// Read random single pixels of the cube, latency per pixel
+static void BM_lib_fits_read_random_pixel(benchmark::State &state)
+{
+    using namespace bench::read;
+
+    ifits file(cube_file());
+    auto image = ifits::hdu::image_hdu<float>(file.get_hdu<0>());
+
+    const auto frames = bench::random_positions(kPixels, kCubeFrames, 1);
+    const auto ys = bench::random_positions(kPixels, kCubeSide, 2);
+    const auto xs = bench::random_positions(kPixels, kCubeSide, 3);
+
+    float value = 0;
+
+    bench::latency_recorder latency;
+    bench::syscall_counter syscalls;
+
+    for (auto _ : state)
+    {
+        syscalls.start();
+        for (std::size_t i = 0; i < kPixels; ++i)
+        {
+            latency.time([&]
+                         { image.read_data({frames[i], ys[i], xs[i]}, boost::asio::buffer(&value, sizeof(value))); });
+            benchmark::DoNotOptimize(value);
+        }
+        syscalls.stop();
+    }
+
+    bench::set_processed(state, kPixels, sizeof(float));
+    latency.report(state);
+    syscalls.report(state);
+}
+
+BENCHMARK(BM_lib_fits_read_random_pixel);
+
+// Read random cutouts of the mosaic row by row, latency per cutout
+static void BM_lib_fits_read_cutout(benchmark::State &state)
+{
+    using namespace bench::read;
+
+    ifits file(mosaic_file());
+    auto image = ifits::hdu::image_hdu<float>(file.get_hdu<0>());
+
+    const auto ys = bench::random_positions(kCutouts, kMosaicSide - kCutoutSide, 4);
+    const auto xs = bench::random_positions(kCutouts, kMosaicSide - kCutoutSide, 5);
+
+    std::vector<float> cutout(kCutoutSide * kCutoutSide);
+
+    bench::latency_recorder latency;
+    bench::syscall_counter syscalls;
+
+    for (auto _ : state)
+    {
+        syscalls.start();
+        for (std::size_t i = 0; i < kCutouts; ++i)
+        {
+            latency.time([&]
+                         {
+                for (std::size_t row = 0; row < kCutoutSide; ++row)
+                {
+                    image.read_data({ys[i] + row, xs[i]}, boost::asio::buffer(cutout.data() + row * kCutoutSide, kCutoutSide * sizeof(float)));
+                } });
+        }
+        syscalls.stop();
+        benchmark::DoNotOptimize(cutout.data());
+    }
+
+    bench::set_processed(state, kCutouts * kCutoutSide * kCutoutSide, sizeof(float));
+    latency.report(state);
+    syscalls.report(state);
+}
+
+BENCHMARK(BM_lib_fits_read_cutout);
+
+// Display limits of the mosaic from sampled pixels, latency per estimate
+static void BM_lib_fits_display_limits(benchmark::State &state)
+{
+    using namespace bench::read;
+
+    ifits file(mosaic_file());
+    auto &hdu = file.get_hdu<0>();
+
+    bench::latency_recorder latency;
+    bench::syscall_counter syscalls;
+
+    for (auto _ : state)
+    {
+        syscalls.start();
+        latency.time([&]
+                     {
+            benchmark::DoNotOptimize(hdu.zscale());
+            benchmark::DoNotOptimize(hdu.percentile_limits(0.5, 99.5)); });
+        syscalls.stop();
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    latency.report(state);
+    syscalls.report(state);
+}
+
+BENCHMARK(BM_lib_fits_display_limits);
+
+// Open many small files and read one keyword, latency per file
+static void BM_lib_fits_open_headers(benchmark::State &state)
+{
+    using namespace bench::read;
+
+    const auto &filenames = small_files();
+
+    bench::latency_recorder latency;
+    bench::syscall_counter syscalls;
+
+    for (auto _ : state)
+    {
+        syscalls.start();
+        for (const auto &filename : filenames)
+        {
+            latency.time([&]
+                         {
+                ifits file(filename);
+                benchmark::DoNotOptimize(file.get_hdu<0>().value_as<int>("BITPIX")); });
+        }
+        syscalls.stop();
+    }
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * kSmallFiles));
+    latency.report(state);
+    syscalls.report(state);
+}
+
+BENCHMARK(BM_lib_fits_open_headers);
+
+// Scan the MAG column of the table in chunks of rows, latency per chunk
+static void BM_lib_fits_column_scan(benchmark::State &state)
+{
+    using namespace bench::read;
+
+    ifits file(table_file());
+    auto image = ifits::hdu::image_hdu<std::uint8_t>(file.get_hdu<0>());
+
+    std::vector<std::uint8_t> chunk(kTableChunk * kRowSize);
+    std::vector<float> column(kTableChunk);
+
+    bench::latency_recorder latency;
+    bench::syscall_counter syscalls;
+
+    for (auto _ : state)
+    {
+        double sum = 0;
+
+        syscalls.start();
+        for (std::size_t first = 0; first < kTableRows; first += kTableChunk)
+        {
+            latency.time([&]
+                         {
+                image.read_data({first}, boost::asio::buffer(chunk));
+                for (std::size_t i = 0; i < kTableChunk; ++i)
+                {
+                    std::memcpy(&column[i], chunk.data() + i * kRowSize + kMagOffset, sizeof(float));
+                } });
+
+            for (float mag : column)
+            {
+                sum += mag;
+            }
+        }
+        syscalls.stop();
+
+        benchmark::DoNotOptimize(sum);
+    }
+
+    bench::set_processed(state, kTableRows, sizeof(float));
+    latency.report(state);
+    syscalls.report(state);
+}
+
+BENCHMARK(BM_lib_fits_column_scan);
+
+// Look up the keywords of the pixel path (BITPIX, NAXIS1, NAXIS2, EXPTIME) by name
+static void BM_lib_fits_keyword_lookup_string(benchmark::State &state)
+{
+    ifits file(small_files().front());
+    const auto &hdu = file.get_hdu<0>();
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(hdu.value_as<int>("BITPIX"));
+        benchmark::DoNotOptimize(hdu.value_as<std::size_t>("NAXIS1"));
+        benchmark::DoNotOptimize(hdu.value_as<std::size_t>("NAXIS2"));
+        benchmark::DoNotOptimize(hdu.value_as<double>("EXPTIME"));
+    }
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * 4));
+}
+
+BENCHMARK(BM_lib_fits_keyword_lookup_string);
+
+// Same keywords through the compile-time handles
+static void BM_lib_fits_keyword_lookup_handle(benchmark::State &state)
+{
+    ifits file(small_files().front());
+    const auto &hdu = file.get_hdu<0>();
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(hdu.get<kw::BITPIX>());
+        benchmark::DoNotOptimize(hdu.get<kw::NAXISn>(1));
+        benchmark::DoNotOptimize(hdu.get<kw::NAXISn>(2));
+        benchmark::DoNotOptimize(hdu.get<kw::EXPTIME>());
+    }
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * 4));
+}
+
+BENCHMARK(BM_lib_fits_keyword_lookup_handle);
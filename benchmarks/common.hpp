@@ -0,0 +1,308 @@
+/**
+ * @file common.hpp
+ * @brief Shared helpers for the lib_fits and CFITSIO benchmarks.
+ *
+ * Both benchmark families use the same scenarios, file layouts and data so
+ * that their results in the JSON report can be compared row by row.
+ */
+
+#pragma once
+
+// STL
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// POSIX
+#if defined(__unix__)
+#include <unistd.h>
+#endif
+
+// Google Benchmark
+#include <benchmark/benchmark.h>
+
+namespace bench
+{
+    /**
+     * @brief Image sides (in pixels) used by the size sweeps.
+     */
+    inline const std::vector<std::int64_t> kImageSides = {256, 1024, 4096};
+
+    /**
+     * @brief Queue depths used by the asynchronous sweeps.
+     */
+    inline const std::vector<std::int64_t> kQueueDepths = {1, 4, 16, 64};
+
+    /**
+     * @brief Number of frames in the cubes used by the queue depth sweeps.
+     */
+    constexpr std::size_t kCubeFrames = 64;
+
+    /**
+     * @brief Side of the images used by the HDU count sweeps.
+     */
+    constexpr std::size_t kHduSide = 512;
+
+    /**
+     * @brief Shapes of the read-path scenarios.
+     */
+    namespace read
+    {
+        constexpr std::size_t kCubeFrames = 64;         // Frames of the sequentially read cube
+        constexpr std::size_t kCubeSide = 512;          // Side of the frames of that cube
+        constexpr std::size_t kPixels = 1024;           // Random single-pixel reads per iteration
+        constexpr std::size_t kMosaicSide = 4096;       // Side of the mosaic cut into cutouts
+        constexpr std::size_t kCutoutSide = 256;        // Side of one cutout
+        constexpr std::size_t kCutouts = 64;            // Cutouts per iteration
+        constexpr std::size_t kSmallFiles = 256;        // Files opened by the header-only scenario
+        constexpr std::size_t kSmallSide = 64;          // Side of the images in those files
+        constexpr std::size_t kTableRows = 1 << 20;     // Rows of the scanned table
+        constexpr std::size_t kTableChunk = 4096;       // Rows read per call in the column scan
+
+        /**
+         * @brief Row of the scanned table (RA, DEC, MAG, ID - TFORM 1D 1D 1E 1J).
+         */
+        constexpr std::size_t kRowSize = 8 + 8 + 4 + 4;
+
+        /**
+         * @brief Byte offset of the scanned MAG column in a row.
+         */
+        constexpr std::size_t kMagOffset = 16;
+    } // namespace read
+
+    /**
+     * @brief Deterministic pseudo-random positions.
+     *
+     * @param count Number of positions
+     * @param limit Exclusive upper bound of the positions
+     * @param seed Seed, distinct per axis
+     * @return Vector with @p count positions in [0, @p limit)
+     */
+    inline std::vector<std::size_t> random_positions(std::size_t count, std::size_t limit, std::uint64_t seed)
+    {
+        std::vector<std::size_t> positions(count);
+
+        std::uint64_t x = seed * 0x9e3779b97f4a7c15ull + 1;
+        for (auto &position : positions)
+        {
+            // xorshift64*
+            x ^= x >> 12;
+            x ^= x << 25;
+            x ^= x >> 27;
+            position = static_cast<std::size_t>((x * 0x2545f4914f6cdd1dull) >> 11) % limit;
+        }
+        return positions;
+    }
+
+    /**
+     * @brief Directory for the files produced by the benchmarks.
+     *
+     * Defaults to the system temporary directory and can be overridden with
+     * the LIB_FITS_BENCH_DIR environment variable (e.g. to benchmark a
+     * specific disk).
+     *
+     * @return Path to an existing directory
+     */
+    inline std::filesystem::path scratch_dir()
+    {
+        const char *env = std::getenv("LIB_FITS_BENCH_DIR");
+
+        std::filesystem::path dir = env ? std::filesystem::path(env) : std::filesystem::temp_directory_path() / "lib_fits_bench";
+
+        std::filesystem::create_directories(dir);
+
+        return dir;
+    }
+
+    /**
+     * @brief Path of a scratch file inside scratch_dir()
+     *
+     * Any previous file with the same name is removed: ofits does not
+     * truncate, and stale trailing bytes would be parsed as extra HDUs.
+     *
+     * @param name File name
+     * @return Full path of the file
+     */
+    inline std::filesystem::path scratch_file(const std::string &name)
+    {
+        auto path = scratch_dir() / name;
+
+        std::filesystem::remove(path);
+
+        return path;
+    }
+
+    /**
+     * @brief Deterministic pixel data for the benchmarks.
+     *
+     * The same seedless pattern is used by every scenario so that runs are
+     * reproducible and both libraries write identical payloads.
+     *
+     * @tparam T Pixel type
+     * @param size Number of pixels
+     * @return Vector with @p size pixels
+     */
+    template <class T>
+    std::vector<T> make_pixels(std::size_t size)
+    {
+        std::vector<T> data(size);
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            data[i] = static_cast<T>((i * 2654435761u) % 251);
+        }
+        return data;
+    }
+
+    /**
+     * @brief Report bytes and pixels processed by one benchmark run.
+     *
+     * @param state Benchmark state
+     * @param pixels Number of pixels processed per iteration
+     * @param pixel_size Size of one pixel in bytes
+     */
+    inline void set_processed(benchmark::State &state, std::size_t pixels, std::size_t pixel_size)
+    {
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * pixels * pixel_size));
+        state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * pixels));
+    }
+
+    /**
+     * @brief Number of read and write system calls issued by the process so far.
+     *
+     * Taken from the syscr and syscw fields of /proc/self/io. Operations
+     * submitted through io_uring are not system calls and are not counted.
+     * Returns 0 where /proc is not available.
+     *
+     * @return Sum of read and write system calls
+     */
+    inline std::uint64_t io_syscalls()
+    {
+        std::ifstream io("/proc/self/io");
+
+        std::uint64_t total = 0;
+        std::string key;
+        std::uint64_t value = 0;
+        while (io >> key >> value)
+        {
+            if (key == "syscr:" || key == "syscw:")
+            {
+                total += value;
+            }
+        }
+        return total;
+    }
+
+    /**
+     * @brief Resident set size of the process in bytes.
+     *
+     * Taken from /proc/self/statm. Returns 0 where /proc is not available.
+     *
+     * @return Resident bytes
+     */
+    inline std::uint64_t resident_bytes()
+    {
+#if defined(__unix__)
+        std::ifstream statm("/proc/self/statm");
+
+        std::uint64_t size = 0, resident = 0;
+        statm >> size >> resident;
+
+        return resident * static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+#else
+        return 0;
+#endif
+    }
+
+    /**
+     * @brief Counts the I/O system calls issued between start() and stop().
+     *
+     * The calls made by io_syscalls() itself are measured once and subtracted.
+     */
+    class syscall_counter
+    {
+    public:
+        syscall_counter()
+        {
+            const auto first = io_syscalls();
+            overhead_ = io_syscalls() - first;
+        }
+
+        void start()
+        {
+            start_ = io_syscalls();
+        }
+
+        void stop()
+        {
+            total_ += io_syscalls() - start_ - overhead_;
+        }
+
+        /**
+         * @brief Report the average number of system calls per iteration.
+         *
+         * @param state Benchmark state
+         */
+        void report(benchmark::State &state) const
+        {
+            state.counters["syscalls"] = benchmark::Counter(static_cast<double>(total_), benchmark::Counter::kAvgIterations);
+        }
+
+    private:
+        std::uint64_t overhead_ = 0; // System calls made by one io_syscalls() call
+        std::uint64_t start_ = 0;    // Counter value at start()
+        std::uint64_t total_ = 0;    // System calls accumulated over all iterations
+    };
+
+    /**
+     * @brief Collects per-operation latencies and reports p50/p99.
+     */
+    class latency_recorder
+    {
+        using clock = std::chrono::steady_clock;
+
+    public:
+        /**
+         * @brief Time one operation.
+         *
+         * @param operation Callable to time
+         */
+        template <class Operation>
+        void time(Operation &&operation)
+        {
+            const auto start = clock::now();
+            operation();
+            samples_.push_back(std::chrono::duration<double, std::micro>(clock::now() - start).count());
+        }
+
+        /**
+         * @brief Report the median and 99th percentile latency in microseconds.
+         *
+         * @param state Benchmark state
+         */
+        void report(benchmark::State &state)
+        {
+            if (samples_.empty())
+            {
+                return;
+            }
+
+            state.counters["p50_us"] = percentile(0.50);
+            state.counters["p99_us"] = percentile(0.99);
+        }
+
+    private:
+        double percentile(double q)
+        {
+            auto nth = samples_.begin() + static_cast<std::ptrdiff_t>(q * (samples_.size() - 1));
+            std::nth_element(samples_.begin(), nth, samples_.end());
+            return *nth;
+        }
+
+        std::vector<double> samples_; // Latencies in microseconds
+    };
+} // namespace bench
@@ -0,0 +1,8 @@
+// Entry point of the benchmark suite.
+//
+// Run with --benchmark_out=results.json --benchmark_out_format=json to store
+// the results for regression tracking (the run_benchmarks target does this).
+
+#include <benchmark/benchmark.h>
+
+BENCHMARK_MAIN();
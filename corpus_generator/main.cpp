@@ -0,0 +1,385 @@
+// Generator of deterministic synthetic FITS corpora.
+//
+// Writes --files files, each with --hdus image HDUs of the same --shape and
+// --bitpix, using ofits. Every HDU gets --header-cards extra keywords (large
+// values spill the header over several 2880-byte blocks). With --sparse only
+// the first chunk and the last pixel of each HDU are written, so multi-GB
+// files are created as sparse files in a fraction of a second.
+//
+// The pixel values only depend on --seed, the file, the HDU and the pixel
+// position, so the same command line always produces identical files.
+
+#include <lib_fits.hpp>
+
+// STL
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Boost
+#include <boost/asio.hpp>
+
+namespace
+{
+    /**
+     * @brief Maximum number of HDUs per file.
+     *
+     * ofits takes the HDU types as template arguments, so every supported
+     * count is instantiated.
+     */
+    constexpr std::size_t kMaxHdus = 16;
+
+    /**
+     * @brief Maximum number of axes per HDU.
+     */
+    constexpr std::size_t kMaxAxes = 4;
+
+    /**
+     * @brief Number of keywords in a header block.
+     */
+    constexpr std::size_t kCardsPerBlock = 2880 / 80;
+
+    /**
+     * @brief Size of the buffers written in one call.
+     */
+    constexpr std::size_t kChunkBytes = 4 << 20;
+
+    /**
+     * @brief Command line options.
+     */
+    struct options
+    {
+        std::filesystem::path output = "corpus";     // Output directory
+        std::string prefix = "corpus";               // File name prefix
+        std::size_t files = 1;                       // Number of files
+        std::size_t hdus = 1;                        // HDUs per file
+        std::vector<std::size_t> shape{1024, 1024};  // Shape of every HDU
+        int bitpix = -32;                            // BITPIX of every HDU
+        std::size_t header_cards = 0;                // Extra keywords per HDU
+        bool sparse = false;                         // Write only the first chunk and the last pixel
+        std::uint64_t seed = 0;                      // Seed of the pixel values
+    };
+
+    void usage()
+    {
+        std::cout << "Usage: corpus_generator [options]\n"
+                     "  --output DIR         output directory (default: corpus)\n"
+                     "  --prefix NAME        file name prefix (default: corpus)\n"
+                     "  --files N            number of files (default: 1)\n"
+                     "  --hdus N             HDUs per file, 1.." << kMaxHdus << " (default: 1)\n"
+                     "  --shape AxB[xC[xD]]  shape of every HDU, slowest axis first (default: 1024x1024)\n"
+                     "  --bitpix B           8, 16, 32, 64, -32 or -64 (default: -32)\n"
+                     "  --header-cards N     extra keywords per HDU (default: 0)\n"
+                     "  --sparse             write only the first chunk and the last pixel of each HDU\n"
+                     "  --seed S             seed of the pixel values (default: 0)\n";
+    }
+
+    std::vector<std::size_t> parse_shape(const std::string &text)
+    {
+        std::vector<std::size_t> shape;
+        std::istringstream iss(text);
+        std::string axis;
+        while (std::getline(iss, axis, 'x'))
+        {
+            shape.push_back(std::stoull(axis));
+        }
+        if (shape.empty() || shape.size() > kMaxAxes)
+        {
+            throw std::runtime_error("Shape must have 1 to " + std::to_string(kMaxAxes) + " axes: " + text);
+        }
+        return shape;
+    }
+
+    options parse_options(int argc, char **argv)
+    {
+        options opts;
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+
+            auto value = [&]() -> std::string
+            {
+                if (i + 1 >= argc)
+                {
+                    throw std::runtime_error("Missing value for " + arg);
+                }
+                return argv[++i];
+            };
+
+            if (arg == "--output")
+                opts.output = value();
+            else if (arg == "--prefix")
+                opts.prefix = value();
+            else if (arg == "--files")
+                opts.files = std::stoull(value());
+            else if (arg == "--hdus")
+                opts.hdus = std::stoull(value());
+            else if (arg == "--shape")
+                opts.shape = parse_shape(value());
+            else if (arg == "--bitpix")
+                opts.bitpix = std::stoi(value());
+            else if (arg == "--header-cards")
+                opts.header_cards = std::stoull(value());
+            else if (arg == "--sparse")
+                opts.sparse = true;
+            else if (arg == "--seed")
+                opts.seed = std::stoull(value());
+            else if (arg == "--help" || arg == "-h")
+            {
+                usage();
+                std::exit(0);
+            }
+            else
+                throw std::runtime_error("Unknown option: " + arg);
+        }
+
+        if (opts.hdus == 0 || opts.hdus > kMaxHdus)
+        {
+            throw std::runtime_error("--hdus must be in 1.." + std::to_string(kMaxHdus));
+        }
+        if (opts.header_cards > 99999)
+        {
+            throw std::runtime_error("--header-cards must be at most 99999");
+        }
+
+        return opts;
+    }
+
+    /**
+     * @brief SplitMix64 step, used as a stateless hash of the pixel position.
+     */
+    constexpr std::uint64_t mix(std::uint64_t x) noexcept
+    {
+        x += 0x9e3779b97f4a7c15ull;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    /**
+     * @brief Deterministic value of one pixel.
+     */
+    template <class T>
+    T pixel_value(std::uint64_t key, std::size_t position) noexcept
+    {
+        const std::uint64_t x = mix(key ^ mix(position));
+        if constexpr (std::is_floating_point_v<T>)
+        {
+            // Uniform in [0, 1000)
+            return static_cast<T>((x >> 11) * (1000.0 / 9007199254740992.0));
+        }
+        else
+        {
+            return static_cast<T>(x);
+        }
+    }
+
+    /**
+     * @brief Number of header blocks needed for the mandatory and extra keywords plus END.
+     */
+    std::size_t header_blocks(const options &opts)
+    {
+        // SIMPLE, BITPIX, NAXIS, NAXISn and EXTEND
+        const std::size_t cards = 4 + opts.shape.size() + opts.header_cards;
+
+        return (cards + 1 + kCardsPerBlock - 1) / kCardsPerBlock;
+    }
+
+    template <class T, std::size_t>
+    using repeat_t = T;
+
+    /**
+     * @brief Create an ofits with one HDU of the given shape per index in Is.
+     *
+     * ofits takes initializer lists, so the runtime number of axes is
+     * dispatched to a fixed-size list.
+     */
+    template <class File, std::size_t... Is>
+    std::unique_ptr<File> make_file(const std::filesystem::path &filename, const std::vector<std::size_t> &s, std::size_t blocks, std::index_sequence<Is...>)
+    {
+        using schema_t = std::array<std::initializer_list<std::size_t>, sizeof...(Is)>;
+
+        switch (s.size())
+        {
+        case 1:
+            return std::make_unique<File>(filename, schema_t{((void)Is, std::initializer_list<std::size_t>{s[0]})...}, blocks);
+        case 2:
+            return std::make_unique<File>(filename, schema_t{((void)Is, std::initializer_list<std::size_t>{s[0], s[1]})...}, blocks);
+        case 3:
+            return std::make_unique<File>(filename, schema_t{((void)Is, std::initializer_list<std::size_t>{s[0], s[1], s[2]})...}, blocks);
+        default:
+            return std::make_unique<File>(filename, schema_t{((void)Is, std::initializer_list<std::size_t>{s[0], s[1], s[2], s[3]})...}, blocks);
+        }
+    }
+
+    /**
+     * @brief Write a buffer starting at a flat pixel position of HDU N.
+     *
+     * The flat position is converted to a full index (slowest axis first),
+     * the data is contiguous from there on.
+     */
+    template <std::size_t N, class File, class T>
+    void write_at(File &file, const std::vector<std::size_t> &shape, std::size_t position, const std::vector<T> &data, std::size_t count)
+    {
+        std::array<std::size_t, kMaxAxes> index{};
+        for (std::size_t axis = shape.size(); axis-- > 0;)
+        {
+            index[axis] = position % shape[axis];
+            position /= shape[axis];
+        }
+
+        const auto buffer = boost::asio::buffer(data.data(), count * sizeof(T));
+
+        switch (shape.size())
+        {
+        case 1:
+            file.template write_data<N>({index[0]}, buffer);
+            break;
+        case 2:
+            file.template write_data<N>({index[0], index[1]}, buffer);
+            break;
+        case 3:
+            file.template write_data<N>({index[0], index[1], index[2]}, buffer);
+            break;
+        default:
+            file.template write_data<N>({index[0], index[1], index[2], index[3]}, buffer);
+            break;
+        }
+    }
+
+    /**
+     * @brief Write the extra keywords and the pixels of HDU N.
+     */
+    template <class T, std::size_t N, class File>
+    void fill_hdu(File &file, const options &opts, std::size_t file_index)
+    {
+        for (std::size_t card = 0; card < opts.header_cards; ++card)
+        {
+            char key[9];
+            std::snprintf(key, sizeof(key), "HDR%05zu", card);
+            file.template value_as<N>(key, std::to_string(mix(opts.seed + card) % 100000));
+        }
+
+        std::size_t pixels = 1;
+        for (auto axis : opts.shape)
+        {
+            pixels *= axis;
+        }
+
+        const std::uint64_t key = mix(opts.seed) ^ (static_cast<std::uint64_t>(file_index) << 20) ^ N;
+        const std::size_t chunk = std::max<std::size_t>(1, kChunkBytes / sizeof(T));
+
+        std::vector<T> data(std::min(chunk, pixels));
+
+        auto write_range = [&](std::size_t first, std::size_t count)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                data[i] = pixel_value<T>(key, first + i);
+            }
+            write_at<N>(file, opts.shape, first, data, count);
+        };
+
+        if (pixels == 0)
+        {
+            // A zero-length axis leaves the HDU without data
+            return;
+        }
+
+        if (opts.sparse)
+        {
+            // The first chunk and the last pixel fix the layout and the file size
+            write_range(0, std::min(chunk, pixels));
+            write_range(pixels - 1, 1);
+            return;
+        }
+
+        for (std::size_t first = 0; first < pixels; first += chunk)
+        {
+            write_range(first, std::min(chunk, pixels - first));
+        }
+    }
+
+    template <class T, std::size_t H>
+    void write_file(const options &opts, const std::filesystem::path &filename, std::size_t file_index)
+    {
+        [&]<std::size_t... Is>(std::index_sequence<Is...> is)
+        {
+            auto file = make_file<ofits<repeat_t<T, Is>...>>(filename, opts.shape, header_blocks(opts), is);
+            (fill_hdu<T, Is>(*file, opts, file_index), ...);
+        }(std::make_index_sequence<H>{});
+    }
+
+    template <class T>
+    void write_file(const options &opts, const std::filesystem::path &filename, std::size_t file_index)
+    {
+        // Dispatch the runtime HDU count to an ofits with that many HDUs
+        [&]<std::size_t... Hs>(std::index_sequence<Hs...>)
+        {
+            ((opts.hdus == Hs + 1 ? write_file<T, Hs + 1>(opts, filename, file_index) : void()), ...);
+        }(std::make_index_sequence<kMaxHdus>{});
+    }
+
+    void write_file(const options &opts, const std::filesystem::path &filename, std::size_t file_index)
+    {
+        switch (opts.bitpix)
+        {
+        case 8:
+            return write_file<std::uint8_t>(opts, filename, file_index);
+        case 16:
+            return write_file<std::int16_t>(opts, filename, file_index);
+        case 32:
+            return write_file<std::int32_t>(opts, filename, file_index);
+        case 64:
+            return write_file<std::int64_t>(opts, filename, file_index);
+        case -32:
+            return write_file<float>(opts, filename, file_index);
+        case -64:
+            return write_file<double>(opts, filename, file_index);
+        default:
+            throw std::runtime_error("Unsupported BITPIX value: " + std::to_string(opts.bitpix));
+        }
+    }
+} // namespace
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        const options opts = parse_options(argc, argv);
+
+        std::filesystem::create_directories(opts.output);
+
+        for (std::size_t i = 0; i < opts.files; ++i)
+        {
+            char name[32];
+            std::snprintf(name, sizeof(name), "_%06zu.fits", i);
+
+            const auto filename = opts.output / (opts.prefix + name);
+
+            // ofits does not truncate existing files
+            std::filesystem::remove(filename);
+
+            write_file(opts, filename, i);
+        }
+
+        std::cout << "Written " << opts.files << " file(s) to " << opts.output << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        usage();
+        return 1;
+    }
+
+    return 0;
+}
@@ -1,2 +1,8 @@
 #include "lib_fits/ofits.hpp"
-#include "lib_fits/ifits.hpp"
\ No newline at end of file
+#include "lib_fits/ifits.hpp"
+#include "lib_fits/pyramid.hpp"
+#include "lib_fits/tiles.hpp"
+#include "lib_fits/combine.hpp"
+#include "lib_fits/transpose.hpp"
+#include "lib_fits/reduce.hpp"
+#include "lib_fits/cutouts.hpp"
\ No newline at end of file
@@ -0,0 +1,218 @@
+/**
+ * @file combine.hpp
+ * @author Alina Gubeeva
+ * @brief Pixel by pixel combination of many images with bounded memory
+ * @version 0.1
+ * @date 2024-04-10
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "ifits.hpp"                 // ifits
+#include "details/region.hpp"        // image_region
+#include "details/statistics.hpp"    // nan_median
+#include "details/work_stealing.hpp" // work_stealing_pool
+
+/**
+ * @brief Combination of the values of a pixel in all the images.
+ */
+enum class combine_mode
+{
+    mean,      // Mean of the valid values
+    median,    // Median of the valid values
+    sigma_clip // Mean of the values within sigma standard deviations of the mean, iterated
+};
+
+/**
+ * @brief Parameters of combine_images.
+ */
+struct combine_options
+{
+    combine_mode mode = combine_mode::mean; // Combination of the values of a pixel
+    std::size_t band_rows = 64;             // Rows read from every image at a time
+    double sigma = 3.0;                     // Clipping threshold, in standard deviations
+    std::size_t iterations = 5;             // Maximum number of clipping iterations
+    std::size_t threads = 1;                // Threads reading the images and combining the pixels
+};
+
+/**
+ * @brief Combine the pixels of images of the same shape into one image
+ *
+ * The images are read band by band: the same rows of every image are read
+ * concurrently, converted to double with their scaling (see read_as), and
+ * combined into the rows of the output, written with one write per band.
+ * Only the band of every image is held in memory, band_rows x width x N
+ * doubles.
+ *
+ * NaN values are left out. Pixels without valid values are NaN. The mean
+ * and the sigma clipping accumulate the bands image after image over
+ * contiguous pixels, which the compiler vectorizes; the median selects the
+ * values of every pixel.
+ *
+ * @param inputs Image HDUs, e.g. the HDU 0 of every frame of a night
+ * @param dest HDU of an ofits file with the shape of the images, e.g. out.get_hdu<0>()
+ * @param options Combination, band height and number of threads
+ * @throw std::runtime_error if there are no images, they are not
+ * two-dimensional or their shapes differ
+ */
+template <class Output>
+void combine_images(std::span<ifits::hdu *const> inputs, Output &dest, const combine_options &options = {})
+{
+    if (inputs.empty())
+    {
+        throw std::runtime_error("No images to combine");
+    }
+
+    const auto shape = inputs.front()->get_shape();
+    if (shape.size() != 2)
+    {
+        throw std::runtime_error("Combined images must be two-dimensional");
+    }
+    for (const auto *input : inputs)
+    {
+        if (input->get_shape() != shape)
+        {
+            throw std::runtime_error("Combined images must have the same shape");
+        }
+    }
+    if (dest.get_shape() != shape)
+    {
+        throw std::runtime_error("Output shape does not match the images");
+    }
+
+    const std::size_t height = shape[0], width = shape[1];
+    const std::size_t images = inputs.size();
+    const std::size_t band_rows = std::clamp<std::size_t>(options.band_rows, 1, std::max<std::size_t>(height, 1));
+    const std::size_t threads = std::max<std::size_t>(options.threads, 1);
+
+    std::vector<double> band(images * band_rows * width); // Band of every image, image after image
+    std::vector<double> result(band_rows * width);
+
+    // Combine the pixels [first, last) of a band of the given size
+    auto combine = [&](std::size_t pixels, std::size_t first, std::size_t last)
+    {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+
+        if (options.mode == combine_mode::median)
+        {
+            std::vector<double> values(images);
+            for (std::size_t p = first; p < last; ++p)
+            {
+                result[p] = nan_median(band.data() + p, images, pixels, values.data());
+            }
+            return;
+        }
+
+        const std::size_t n = last - first;
+        std::vector<double> low(n, -std::numeric_limits<double>::infinity());
+        std::vector<double> high(n, std::numeric_limits<double>::infinity());
+        std::vector<double> sums(n), squares(n), counts(n), previous(n, -1.0);
+        std::vector<double> previous_low(n), previous_high(n), previous_sums(n);
+
+        // Accumulate the values within the bounds, one image after the other
+        auto accumulate = [&](auto add)
+        {
+            for (std::size_t image = 0; image < images; ++image)
+            {
+                const double *values = band.data() + image * pixels + first;
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    const double value = values[i];
+                    add(i, value, value >= low[i] && value <= high[i]); // False for NaN
+                }
+            }
+        };
+
+        const std::size_t iterations = options.mode == combine_mode::sigma_clip ? options.iterations : 0;
+        for (std::size_t iteration = 0;; ++iteration)
+        {
+            std::fill(sums.begin(), sums.end(), 0.0);
+            std::fill(counts.begin(), counts.end(), 0.0);
+            accumulate([&](std::size_t i, double value, bool keep)
+                       {
+                sums[i] += keep ? value : 0.0;
+                counts[i] += keep ? 1.0 : 0.0; });
+
+            bool changed = false;
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                // Bounds rejecting every value, e.g. a deviation rounded to 0, are undone and the pixel stops
+                if (counts[i] == 0.0 && previous[i] > 0.0)
+                {
+                    low[i] = previous_low[i];
+                    high[i] = previous_high[i];
+                    sums[i] = previous_sums[i];
+                    counts[i] = previous[i];
+                }
+                changed |= counts[i] != previous[i];
+            }
+
+            if (iteration == iterations || !changed)
+            {
+                break;
+            }
+
+            // Deviations from the means in a second pass, exact for constant values
+            std::fill(squares.begin(), squares.end(), 0.0);
+            accumulate([&](std::size_t i, double value, bool keep)
+                       {
+                const double difference = value - sums[i] / counts[i];
+                squares[i] += keep ? difference * difference : 0.0; });
+
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                const double mean = sums[i] / counts[i];
+                const double deviation = std::sqrt(squares[i] / counts[i]);
+                previous_low[i] = low[i];
+                previous_high[i] = high[i];
+                previous_sums[i] = sums[i];
+                previous[i] = counts[i];
+                low[i] = mean - options.sigma * deviation;
+                high[i] = mean + options.sigma * deviation;
+            }
+        }
+
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            result[first + i] = counts[i] > 0.0 ? sums[i] / counts[i] : nan;
+        }
+    };
+
+    work_stealing_pool pool(threads);
+
+    for (std::size_t first_row = 0; first_row < height; first_row += band_rows)
+    {
+        const std::size_t rows = std::min(band_rows, height - first_row);
+        const std::size_t pixels = rows * width;
+
+        for (std::size_t image = 0; image < images; ++image)
+        {
+            pool.submit([&, image, first_row, rows, pixels]
+                        { inputs[image]->read_as(image_region{{first_row, 0}, {rows, width}},
+                                                 std::span(band.data() + image * pixels, pixels)); });
+        }
+        pool.wait();
+
+        const std::size_t parts = std::min(threads, pixels);
+        for (std::size_t part = 0; part < parts; ++part)
+        {
+            pool.submit([&, part, pixels, parts]
+                        { combine(pixels, part * pixels / parts, (part + 1) * pixels / parts); });
+        }
+        pool.wait();
+
+        dest.write_data({first_row, 0}, std::span<const double>(result.data(), pixels));
+    }
+}
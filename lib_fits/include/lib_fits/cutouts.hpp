@@ -0,0 +1,154 @@
+/**
+ * @file cutouts.hpp
+ * @author Alina Gubeeva
+ * @brief Batches of cutouts read in file order across many files
+ * @version 0.1
+ * @date 2024-04-10
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+// STL
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "ifits.hpp"                 // ifits
+#include "details/region.hpp"        // image_region
+#include "details/work_stealing.hpp" // work_stealing_pool
+
+/**
+ * @brief One cutout of a batch read by read_cutouts.
+ */
+struct cutout_request
+{
+    ifits::hdu *source;     // HDU the cutout is read from
+    image_region region;    // Pixels of the cutout
+    std::span<double> dest; // Destination of the region.size() values, in file order
+};
+
+/**
+ * @brief Merging and concurrency of read_cutouts.
+ */
+struct cutout_options
+{
+    std::size_t max_gap = 65536;                  // Largest gap between two runs read through, in bytes of the file
+    std::size_t max_span = std::size_t(16) << 20; // Largest merged read, in bytes of the file
+    std::size_t threads = 4;                      // Files read at the same time
+};
+
+/**
+ * @brief Read a batch of cutouts from many files and HDUs in the order of the files
+ *
+ * Every cutout is split into its contiguous runs, which are grouped by file
+ * and sorted by their offset in the file, whatever the order of the
+ * requests. Runs of the same HDU that overlap, or are separated by at most
+ * max_gap bytes, are merged into one read of at most max_span bytes, so the
+ * batch becomes one sweep of increasing offsets per file. The files are
+ * swept concurrently by up to threads workers, and every merged read is
+ * converted to double with the scaling of its HDU (see read_as) and
+ * scattered to the destinations of the runs it covers.
+ *
+ * @param requests Cutouts, in any order; several may overlap
+ * @param options Merging of the runs and number of files read at a time
+ * @throw std::runtime_error if a region is out of bounds or a destination is too small
+ * @throw The first exception thrown by a read
+ */
+inline void read_cutouts(std::span<const cutout_request> requests, const cutout_options &options = {})
+{
+    struct cutout_run
+    {
+        const ifits *file;   // File of the run, the key of the sweeps
+        std::uint64_t start; // Offset of the run in the file, in bytes
+        ifits::hdu *source;  // HDU of the run
+        std::size_t first;   // Index of the first element in the data of the HDU
+        std::size_t length;  // Number of elements
+        double *dest;        // Destination of the elements
+    };
+
+    std::vector<cutout_run> runs;
+    for (const auto &request : requests)
+    {
+        if (request.dest.size() < request.region.size())
+        {
+            throw std::runtime_error("Destination is too small for the cutout");
+        }
+
+        const std::uint64_t data_offset = request.source->get_data_offset();
+        const std::size_t element_size = request.source->get_element_size();
+        request.region.for_each_run(request.source->get_shape(), [&](std::size_t offset, std::size_t length, std::size_t position)
+                                    { runs.push_back({&request.source->get_parent_ifits(), data_offset + offset * element_size,
+                                                      request.source, offset, length, request.dest.data() + position}); });
+    }
+
+    // Elevator order: file after file, increasing offsets within a file
+    std::sort(runs.begin(), runs.end(), [](const cutout_run &a, const cutout_run &b)
+              { return a.file != b.file ? std::less<const ifits *>()(a.file, b.file) : a.start < b.start; });
+
+    // Runs [first, last) of one file, swept by one worker
+    struct cutout_sweep
+    {
+        std::size_t first;
+        std::size_t last;
+    };
+
+    std::vector<cutout_sweep> sweeps;
+    for (std::size_t i = 0; i < runs.size(); ++i)
+    {
+        if (sweeps.empty() || runs[i].file != runs[sweeps.back().last - 1].file)
+        {
+            sweeps.push_back({i, i + 1});
+        }
+        else
+        {
+            sweeps.back().last = i + 1;
+        }
+    }
+
+    work_stealing_pool pool(options.threads);
+
+    for (const auto &sweep : sweeps)
+    {
+        pool.submit([&, sweep]
+                    {
+            std::vector<double> buffer;
+
+            for (std::size_t i = sweep.first; i < sweep.last;)
+            {
+                // Merge the following runs of the same HDU while the gaps and the span stay small
+                ifits::hdu *source = runs[i].source;
+                const std::size_t element_size = source->get_element_size();
+                const std::size_t span_first = runs[i].first;
+                std::size_t span_end = span_first + runs[i].length;
+
+                std::size_t j = i + 1;
+                for (; j < sweep.last && runs[j].source == source; ++j)
+                {
+                    const std::size_t end = std::max(span_end, runs[j].first + runs[j].length);
+                    if (runs[j].first > span_end + options.max_gap / element_size ||
+                        (end - span_first) * element_size > options.max_span)
+                    {
+                        break;
+                    }
+                    span_end = end;
+                }
+
+                buffer.resize(span_end - span_first);
+                source->read_elements_as(span_first, std::span(buffer));
+
+                for (; i < j; ++i)
+                {
+                    std::memcpy(runs[i].dest, buffer.data() + (runs[i].first - span_first), runs[i].length * sizeof(double));
+                }
+            } });
+    }
+    pool.wait();
+}
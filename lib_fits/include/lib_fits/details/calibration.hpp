@@ -0,0 +1,118 @@
+/**
+ * @file calibration.hpp
+ * @author Alina Gubeeva
+ * @brief Bias, dark and flat calibration of frames
+ * @version 0.1
+ * @date 2024-04-10
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+// STL
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * @brief Master frames of a calibration, held in memory.
+ *
+ * Every master frame has one value per pixel of a frame, in file order, or
+ * is empty when that step is skipped. The flat is normalized by the caller.
+ */
+struct master_frames
+{
+    std::vector<double> bias; // Subtracted from every frame
+    std::vector<double> dark; // Dark signal, scaled by dark_scale and subtracted from every frame
+    double dark_scale = 1.0;  // E.g. exposure time of the frames over the exposure time of the dark
+    std::vector<double> flat; // Divides every frame after the subtractions
+};
+
+/**
+ * @brief Calibration of frames with master frames: (value - bias - dark_scale * dark) / flat.
+ *
+ * The masters are folded into one offset and one gain per pixel when the
+ * calibration is built, so applying it is one subtraction and one
+ * multiplication per pixel. Pixels with a flat of 0 or NaN become NaN.
+ * It is a transform for ifits::hdu::read_frames.
+ */
+class frame_calibration
+{
+public:
+    /**
+     * @brief Build the calibration of frames of the given size
+     *
+     * @param masters Master frames
+     * @param pixels Number of pixels of a frame
+     * @throw std::runtime_error if a master frame is neither empty nor of the size of a frame
+     */
+    frame_calibration(const master_frames &masters, std::size_t pixels)
+        : offset_(pixels, 0.0), gain_(pixels, 1.0)
+    {
+        for (const auto *master : {&masters.bias, &masters.dark, &masters.flat})
+        {
+            if (!master->empty() && master->size() != pixels)
+            {
+                throw std::runtime_error("Master frame size does not match the frames");
+            }
+        }
+
+        for (std::size_t i = 0; i < pixels; ++i)
+        {
+            if (!masters.bias.empty())
+            {
+                offset_[i] += masters.bias[i];
+            }
+            if (!masters.dark.empty())
+            {
+                offset_[i] += masters.dark_scale * masters.dark[i];
+            }
+            if (!masters.flat.empty())
+            {
+                const double flat = masters.flat[i];
+                gain_[i] = flat != 0.0 && flat == flat ? 1.0 / flat : std::numeric_limits<double>::quiet_NaN();
+            }
+        }
+    }
+
+    /**
+     * @brief Number of pixels of a frame.
+     */
+    std::size_t size() const noexcept
+    {
+        return offset_.size();
+    }
+
+    /**
+     * @brief Calibrate consecutive values of a frame, in place
+     *
+     * @param values Values to calibrate
+     * @param frame Index of the frame, unused
+     * @param pixel Index of the first value in the frame
+     * @throw std::runtime_error if the values go past the end of the frame
+     */
+    void operator()(std::span<double> values, std::size_t /*frame*/, std::size_t pixel) const
+    {
+        // Checked once per chunk, the loop stays free of checks
+        if (pixel > size() || values.size() > size() - pixel)
+        {
+            throw std::runtime_error("Calibrated values are out of the frame");
+        }
+
+
+        const double *offset = offset_.data() + pixel;
+        const double *gain = gain_.data() + pixel;
+        for (std::size_t i = 0; i < values.size(); ++i)
+        {
+            values[i] = (values[i] - offset[i]) * gain[i];
+        }
+    }
+
+private:
+    std::vector<double> offset_; // Bias and scaled dark of every pixel
+    std::vector<double> gain_;   // Inverse of the flat of every pixel
+};
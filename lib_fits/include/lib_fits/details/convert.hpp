@@ -0,0 +1,316 @@
+/**
+ * @file convert.hpp
+ * @author Alina Gubeeva
+ * @brief Conversion of pixel values between types, with scaling
+ * @version 0.1
+ * @date 2024-04-10
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+// STL
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+// Boost
+#include <boost/asio/buffer.hpp>
+
+/**
+ * @brief What to do with values outside the range of the destination type.
+ */
+enum class overflow_policy
+{
+    saturate, // Clamp to the nearest representable value, NaN becomes 0
+    error,    // Throw std::overflow_error
+    unchecked // Plain cast, the caller guarantees the range
+};
+
+/**
+ * @brief Linear scaling of the stored values: physical = bzero + bscale * stored.
+ */
+struct pixel_scaling
+{
+    double bscale = 1.0; // BSCALE keyword
+    double bzero = 0.0;  // BZERO keyword
+
+    /**
+     * @brief Whether the scaling leaves the values unchanged.
+     */
+    bool is_identity() const noexcept
+    {
+        return bscale == 1.0 && bzero == 0.0;
+    }
+};
+
+/**
+ * @brief Whether every value of From is exactly representable in To.
+ */
+template <class From, class To>
+inline constexpr bool is_lossless_pixel_v =
+    std::is_same_v<From, To> ||
+    (std::is_floating_point_v<To> && std::is_floating_point_v<From> && sizeof(To) >= sizeof(From)) ||
+    (std::is_floating_point_v<To> && std::is_integral_v<From> && std::numeric_limits<From>::digits <= std::numeric_limits<To>::digits) ||
+    (std::is_integral_v<To> && std::is_integral_v<From> && std::is_signed_v<To> == std::is_signed_v<From> && sizeof(To) >= sizeof(From)) ||
+    (std::is_integral_v<To> && std::is_integral_v<From> && std::is_signed_v<To> && !std::is_signed_v<From> && sizeof(To) > sizeof(From));
+
+/**
+ * @brief Smallest double above the range of the integral type To, a power of two.
+ */
+template <class To>
+inline constexpr double kPixelUpperBound = static_cast<double>((std::numeric_limits<To>::max() >> 1) + 1) * 2.0;
+
+/**
+ * @brief Largest double below the range of the integral type To once truncated.
+ *
+ * lowest() - 1 when it is exact, the double below lowest() of the 64-bit signed integers.
+ */
+template <class To>
+inline constexpr double kPixelLowerBound =
+    std::is_unsigned_v<To> || std::numeric_limits<To>::digits < std::numeric_limits<double>::digits
+        ? static_cast<double>(std::numeric_limits<To>::lowest()) - 1.0
+        : static_cast<double>(std::numeric_limits<To>::lowest()) * (1.0 + std::numeric_limits<double>::epsilon());
+
+/**
+ * @brief Whether a double is outside the range of To once rounded.
+ */
+template <class To>
+constexpr bool pixel_out_of_range(double value) noexcept
+{
+    if constexpr (std::is_floating_point_v<To>)
+    {
+        return value < static_cast<double>(std::numeric_limits<To>::lowest()) ||
+               value > static_cast<double>(std::numeric_limits<To>::max());
+    }
+    else
+    {
+        // The cast truncates the value rounded by pixel_round; NaN fails both comparisons
+        return !(value > kPixelLowerBound<To> && value < kPixelUpperBound<To>);
+    }
+}
+
+/**
+ * @brief Convert a rounded double to To, clamping out of range values.
+ */
+template <class To>
+constexpr To pixel_saturate(double value) noexcept
+{
+    if constexpr (std::is_floating_point_v<To>)
+    {
+        if (value < static_cast<double>(std::numeric_limits<To>::lowest()))
+        {
+            return std::numeric_limits<To>::lowest();
+        }
+        if (value > static_cast<double>(std::numeric_limits<To>::max()))
+        {
+            return std::numeric_limits<To>::max();
+        }
+        return static_cast<To>(value);
+    }
+    else
+    {
+        if (value >= kPixelUpperBound<To>)
+        {
+            return std::numeric_limits<To>::max();
+        }
+        if (value >= static_cast<double>(std::numeric_limits<To>::lowest()))
+        {
+            return static_cast<To>(value);
+        }
+        return value < 0.0 ? std::numeric_limits<To>::lowest() : To(0); // Below the range or NaN
+    }
+}
+
+/**
+ * @brief Round half away from zero for integral destinations, identity otherwise.
+ */
+template <class To>
+constexpr double pixel_round(double value) noexcept
+{
+    if constexpr (std::is_integral_v<To>)
+    {
+        // Truncation by the cast completes the rounding
+        return value < 0.0 ? value - 0.5 : value + 0.5;
+    }
+    else
+    {
+        return value;
+    }
+}
+
+/**
+ * @brief Convert pixel values from one type to another
+ *
+ * Every value is scaled, rounded to the nearest integer when To is integral
+ * and converted according to the overflow policy. The loops have no calls
+ * and no early exits so that the compiler vectorizes them; lossless
+ * conversions without scaling are plain casts and a copy when the types
+ * are the same.
+ *
+ * @tparam From Type of the source values
+ * @tparam To Type of the destination values
+ * @param src Source values
+ * @param dst Destination values, may not overlap the source
+ * @param n Number of values
+ * @param scaling Scaling applied to the source values
+ * @param policy What to do with values outside the range of To
+ * @throw std::overflow_error if policy is overflow_policy::error and a value is out of range
+ */
+template <class From, class To>
+void convert_pixels(const From *src, To *dst, std::size_t n, const pixel_scaling &scaling = {},
+                    overflow_policy policy = overflow_policy::saturate)
+{
+    static_assert(std::is_arithmetic_v<From> && std::is_arithmetic_v<To>, "Pixels are integral or floating point values");
+
+    if (scaling.is_identity())
+    {
+        if constexpr (std::is_same_v<From, To>)
+        {
+            std::memcpy(dst, src, n * sizeof(To));
+            return;
+        }
+        else if constexpr (is_lossless_pixel_v<From, To>)
+        {
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                dst[i] = static_cast<To>(src[i]);
+            }
+            return;
+        }
+        else if constexpr (std::is_integral_v<From> && std::is_integral_v<To>)
+        {
+            // Narrowing between integers, exact without going through double
+            bool overflow = false;
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                const From value = src[i];
+                const bool in_range = std::in_range<To>(value);
+                overflow |= !in_range;
+
+                if (policy == overflow_policy::saturate && !in_range)
+                {
+                    dst[i] = std::cmp_less(value, 0) ? std::numeric_limits<To>::lowest() : std::numeric_limits<To>::max();
+                }
+                else
+                {
+                    dst[i] = static_cast<To>(value);
+                }
+            }
+
+            if (overflow && policy == overflow_policy::error)
+            {
+                throw std::overflow_error("Pixel value out of range of the destination type");
+            }
+            return;
+        }
+    }
+
+    switch (policy)
+    {
+    case overflow_policy::saturate:
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            dst[i] = pixel_saturate<To>(pixel_round<To>(scaling.bzero + scaling.bscale * static_cast<double>(src[i])));
+        }
+        break;
+    case overflow_policy::error:
+    {
+        bool overflow = false;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            const double value = pixel_round<To>(scaling.bzero + scaling.bscale * static_cast<double>(src[i]));
+            overflow |= pixel_out_of_range<To>(value);
+            dst[i] = pixel_saturate<To>(value);
+        }
+
+        if (overflow)
+        {
+            throw std::overflow_error("Pixel value out of range of the destination type");
+        }
+        break;
+    }
+    case overflow_policy::unchecked:
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            dst[i] = static_cast<To>(pixel_round<To>(scaling.bzero + scaling.bscale * static_cast<double>(src[i])));
+        }
+        break;
+    }
+}
+
+/**
+ * @brief Whether T is stored with the FITS convention for unsigned integers.
+ *
+ * Unsigned 16, 32 and 64-bit values are stored as the signed integers of the
+ * same size with BZERO = 2^(bits - 1). Subtracting the offset is flipping the
+ * sign bit, so stored and unsigned values differ only by that bit.
+ */
+template <class T>
+inline constexpr bool is_offset_unsigned_v = std::is_integral_v<T> && std::is_unsigned_v<T> && sizeof(T) > 1;
+
+/**
+ * @brief BZERO of the unsigned integer convention for T, as written in the header.
+ */
+template <class T>
+inline constexpr std::string_view kUnsignedBzero = sizeof(T) == 2   ? "32768"
+                                                   : sizeof(T) == 4 ? "2147483648"
+                                                                    : "9223372036854775808";
+
+/**
+ * @brief Convert between unsigned values and their stored form, in place.
+ */
+template <class T>
+void flip_sign_bits(T *data, std::size_t n) noexcept
+{
+    static_assert(is_offset_unsigned_v<T>, "Only unsigned integers are stored with an offset");
+
+    constexpr T kSignBit = T(1) << (std::numeric_limits<T>::digits - 1);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        data[i] ^= kSignBit;
+    }
+}
+
+/**
+ * @brief Convert between unsigned values and their stored form in the first bytes of a buffer sequence
+ *
+ * The buffers may have any size and alignment.
+ *
+ * @param buffers Buffers holding the values
+ * @param size Number of bytes to convert, e.g. the number of bytes read
+ * @param first Position of the first byte of the buffers in the data, in bytes
+ */
+template <class T, class MutableBufferSequence>
+void flip_sign_bits(const MutableBufferSequence &buffers, std::size_t size, std::size_t first = 0) noexcept
+{
+    static_assert(is_offset_unsigned_v<T>, "Only unsigned integers are stored with an offset");
+
+    // Byte of every value holding the sign bit
+    constexpr std::size_t kSignByte = std::endian::native == std::endian::little ? sizeof(T) - 1 : 0;
+
+    std::size_t done = 0; // Bytes of the buffers before the current one
+    for (auto it = boost::asio::buffer_sequence_begin(buffers); it != boost::asio::buffer_sequence_end(buffers) && done < size; ++it)
+    {
+        const boost::asio::mutable_buffer buffer(*it);
+        auto *bytes = static_cast<unsigned char *>(buffer.data());
+        const std::size_t length = std::min(buffer.size(), size - done);
+        const std::size_t position = first + done;
+
+        for (std::size_t i = (kSignByte + sizeof(T) - position % sizeof(T)) % sizeof(T); i < length; i += sizeof(T))
+        {
+            bytes[i] ^= 0x80;
+        }
+
+        done += buffer.size();
+    }
+}
@@ -0,0 +1,187 @@
+/**
+ * @file display_limits.hpp
+ * @author Alina Gubeeva
+ * @brief Display limits of images estimated from a sample of their pixels
+ * @version 0.1
+ * @date 2024-04-10
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * @brief Range of values mapped to the darkest and brightest display levels.
+ */
+struct display_limits
+{
+    double low;  // Value displayed as black
+    double high; // Value displayed as white
+};
+
+/**
+ * @brief Parameters of the zscale algorithm.
+ *
+ * The defaults are those of IRAF and astropy.
+ */
+struct zscale_options
+{
+    std::size_t samples = 1000; // Number of pixels sampled from the image
+    double contrast = 0.25;     // Slope of the fitted line is divided by the contrast
+    double rejection = 2.5;     // Residuals above this number of sigmas are rejected
+    std::size_t iterations = 5; // Maximum number of fitting iterations
+    double max_reject = 0.5;    // Maximum fraction of the sample that can be rejected
+    std::size_t min_pixels = 5; // Minimum number of pixels left after rejection
+};
+
+/**
+ * @brief Value below which the given percentage of a sample lies
+ *
+ * Uses a selection instead of a full sort (expected linear time) and
+ * interpolates linearly between the two closest ranks, as
+ * numpy.percentile does.
+ *
+ * @param sample Sample of finite values, reordered by the call
+ * @param percent Percentage between 0 and 100
+ * @return The percentile
+ * @throw std::runtime_error if the sample is empty
+ */
+inline double sample_percentile(std::vector<float> &sample, double percent)
+{
+    if (sample.empty())
+    {
+        throw std::runtime_error("Empty sample");
+    }
+
+    const double rank = std::clamp(percent, 0.0, 100.0) / 100.0 * static_cast<double>(sample.size() - 1);
+    const auto lower = static_cast<std::size_t>(rank);
+
+    std::nth_element(sample.begin(), sample.begin() + lower, sample.end());
+    const double value = sample[lower];
+
+    if (lower + 1 == sample.size())
+    {
+        return value;
+    }
+
+    // The next rank is the minimum of the values above the selected one
+    const double next = *std::min_element(sample.begin() + lower + 1, sample.end());
+    return value + (rank - static_cast<double>(lower)) * (next - value);
+}
+
+/**
+ * @brief Display limits of the zscale algorithm from a sample of pixels
+ *
+ * Fits a line to the sorted sample with iterative rejection of outliers and
+ * returns the range of the line around the median, widened by the
+ * contrast and clipped to the range of the sample.
+ *
+ * @param sample Sample of finite values, sorted by the call
+ * @param options Parameters of the algorithm
+ * @return The display limits
+ * @throw std::runtime_error if the sample is empty
+ */
+inline display_limits zscale_limits(std::vector<float> &sample, const zscale_options &options = {})
+{
+    if (sample.empty())
+    {
+        throw std::runtime_error("Empty sample");
+    }
+
+    std::sort(sample.begin(), sample.end());
+
+    const std::size_t count = sample.size();
+    const std::size_t center = count / 2;
+    const double median = count % 2 ? sample[center] : 0.5 * (static_cast<double>(sample[center - 1]) + sample[center]);
+    const display_limits range{sample.front(), sample.back()};
+
+    const std::size_t min_pixels = std::max(options.min_pixels, static_cast<std::size_t>(count * options.max_reject));
+    const std::size_t grow = std::max<std::size_t>(1, count / 100); // Rejected pixels take their neighbours along
+
+    std::vector<char> rejected(count, 0), grown(count);
+    std::size_t good = count;
+    std::size_t last_good = count + 1;
+    double slope = 0.0;
+
+    for (std::size_t iteration = 0; iteration < options.iterations && good < last_good && good >= min_pixels; ++iteration)
+    {
+        // Least squares fit of value = intercept + slope * rank over the good pixels
+        double sx = 0, sy = 0, sxx = 0, sxy = 0;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (!rejected[i])
+            {
+                const double x = static_cast<double>(i), y = sample[i];
+                sx += x;
+                sy += y;
+                sxx += x * x;
+                sxy += x * y;
+            }
+        }
+
+        const double n = static_cast<double>(good);
+        const double denominator = n * sxx - sx * sx;
+        slope = denominator != 0.0 ? (n * sxy - sx * sy) / denominator : 0.0;
+        const double intercept = (sy - slope * sx) / n;
+
+        // Standard deviation of the residuals of the good pixels
+        double sum = 0, squares = 0;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (!rejected[i])
+            {
+                const double residual = sample[i] - (intercept + slope * static_cast<double>(i));
+                sum += residual;
+                squares += residual * residual;
+            }
+        }
+        const double threshold = options.rejection * std::sqrt(std::max(0.0, squares / n - (sum / n) * (sum / n)));
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const double residual = sample[i] - (intercept + slope * static_cast<double>(i));
+            if (residual < -threshold || residual > threshold)
+            {
+                rejected[i] = 1;
+            }
+        }
+
+        // Grow the rejected pixels by the window around them
+        std::fill(grown.begin(), grown.end(), 0);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (rejected[i])
+            {
+                const std::size_t first = i >= grow / 2 ? i - grow / 2 : 0;
+                const std::size_t last = std::min(count, i + (grow + 1) / 2);
+                std::fill(grown.begin() + first, grown.begin() + last, 1);
+            }
+        }
+        rejected.swap(grown);
+
+        last_good = good;
+        good = static_cast<std::size_t>(std::count(rejected.begin(), rejected.end(), 0));
+    }
+
+    if (good < min_pixels)
+    {
+        return range;
+    }
+
+    if (options.contrast > 0)
+    {
+        slope /= options.contrast;
+    }
+
+    const std::size_t center_pixel = (count - 1) / 2;
+    return {std::max(range.low, median - (static_cast<double>(center_pixel) - 1.0) * slope),
+            std::min(range.high, median + static_cast<double>(count - center_pixel) * slope)};
+}
@@ -0,0 +1,527 @@
+/**
+ * @file file_device.hpp
+ * @author Alina Gubeeva
+ * @brief Random access device through which ifits and ofits do all their I/O
+ * @version 0.1
+ * @date 2024-04-10
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+// STL
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// Boost
+#include <boost/asio.hpp>
+
+#include "hooks.hpp"        // io_hook, io_event, hdu_offsets
+#include "metrics.hpp"      // io_metrics
+#include "probes.hpp"       // LIB_FITS_PROBE*
+#include "io_scheduler.hpp" // io_scheduler, io_schedule
+
+/**
+ * @brief Random access device wrapping the file of an ifits or ofits object.
+ *
+ * Meets the requirements of the Boost.Asio (Async)RandomAccess(Read|Write)Device
+ * concepts, so the composed boost::asio::read_at/write_at operations can run
+ * on it. Every physical read or write goes through read_some_at/write_some_at
+ * and is recorded in the optional io_metrics, reported to the optional io_hook
+ * and fires the USDT probes. The read_at/write_at members are the logical
+ * operations of the public API and record their latency and the queue depth of
+ * asynchronous operations.
+ *
+ * With an io_schedule, the asynchronous logical operations go through the
+ * io_scheduler: their physical operations are split into chunks of at most
+ * max_chunk bytes, and every chunk waits for a slot of the scheduler with the
+ * priority class of the file and the deadline of its logical operation.
+ * Synchronous operations are not scheduled, since a thread running the
+ * io_context could otherwise wait for slots that only it can release.
+ *
+ * The device must outlive the asynchronous operations started on it, it is
+ * therefore a member of ifits and ofits next to the file itself.
+ *
+ * @tparam File Type of the underlying file, e.g. boost::asio::random_access_file
+ */
+template <class File>
+class file_device
+{
+public:
+    using executor_type = typename File::executor_type;
+
+    /**
+     * @brief Constructor
+     *
+     * @param file The wrapped file
+     * @param metrics Metrics to record into, or nullptr to disable recording
+     * @param hook Hook called after every operation, may be empty
+     * @param schedule Scheduler of the asynchronous operations, may be empty
+     */
+    file_device(File &file, io_metrics *metrics, io_hook hook = {}, io_schedule schedule = {}) noexcept
+        : file_(file), metrics_(metrics), hook_(std::move(hook)), schedule_(std::move(schedule))
+    {
+    }
+
+    file_device(const file_device &) = delete;
+    file_device &operator=(const file_device &) = delete;
+
+    /**
+     * @brief Get the executor of the underlying file.
+     */
+    executor_type get_executor() noexcept
+    {
+        return file_.get_executor();
+    }
+
+    /**
+     * @brief Get the metrics, nullptr if recording is disabled.
+     */
+    io_metrics *metrics() const noexcept
+    {
+        return metrics_;
+    }
+
+    /**
+     * @brief Get the scheduling of the asynchronous operations.
+     */
+    const io_schedule &schedule() const noexcept
+    {
+        return schedule_;
+    }
+
+    /**
+     * @brief Whether an io_hook is set (always false if hooks are compiled out).
+     */
+    bool has_hook() const noexcept
+    {
+        return kLibFitsHooks && static_cast<bool>(hook_);
+    }
+
+    /**
+     * @brief Heap bytes held by the device (the HDU offsets of the hook events).
+     */
+    std::size_t heap_bytes() const noexcept
+    {
+        return hdus_.heap_bytes();
+    }
+
+    /**
+     * @brief Register the next HDU of the file, so that events report its index.
+     *
+     * @param offset Offset of the header of the HDU
+     */
+    void add_hdu(std::uint64_t offset)
+    {
+        if (has_hook())
+        {
+            hdus_.add(offset);
+        }
+    }
+
+    /**
+     * @brief Report an operation to the hook, if any.
+     *
+     * @param operation Kind of operation
+     * @param offset Offset in the file
+     * @param length Number of bytes of the operation
+     * @param start When the operation was submitted
+     * @param ec Error of the operation
+     */
+    void report(io_operation operation, std::uint64_t offset, std::size_t length, io_event::clock::time_point start,
+                const boost::system::error_code &ec = {}) const
+    {
+        if (has_hook())
+        {
+            hook_(io_event{operation, hdus_.find(offset), offset, length, start, io_event::clock::now(), ec});
+        }
+    }
+
+    /**
+     * @brief Read some data at the given offset (one physical read).
+     */
+    template <class MutableBufferSequence>
+    std::size_t read_some_at(std::uint64_t offset, const MutableBufferSequence &buffers, boost::system::error_code &ec)
+    {
+        LIB_FITS_PROBE2(read_submit, offset, boost::asio::buffer_size(buffers));
+
+        const auto start = has_hook() ? io_event::clock::now() : io_event::clock::time_point{};
+        const std::size_t bytes = file_.read_some_at(offset, buffers, ec);
+
+        LIB_FITS_PROBE3(read_complete, offset, bytes, ec.value());
+
+        if (metrics_)
+        {
+            metrics_->record_read_syscall(bytes);
+        }
+
+        report(io_operation::read, offset, bytes, start, ec);
+
+        return bytes;
+    }
+
+    /**
+     * @brief Read some data at the given offset (one physical read), throwing on error.
+     */
+    template <class MutableBufferSequence>
+    std::size_t read_some_at(std::uint64_t offset, const MutableBufferSequence &buffers)
+    {
+        boost::system::error_code ec;
+        const std::size_t bytes = read_some_at(offset, buffers, ec);
+        if (ec)
+        {
+            throw boost::system::system_error(ec, "read_some_at");
+        }
+        return bytes;
+    }
+
+    /**
+     * @brief Write some data at the given offset (one physical write).
+     */
+    template <class ConstBufferSequence>
+    std::size_t write_some_at(std::uint64_t offset, const ConstBufferSequence &buffers, boost::system::error_code &ec)
+    {
+        LIB_FITS_PROBE2(write_submit, offset, boost::asio::buffer_size(buffers));
+
+        const auto start = has_hook() ? io_event::clock::now() : io_event::clock::time_point{};
+        const std::size_t bytes = file_.write_some_at(offset, buffers, ec);
+
+        LIB_FITS_PROBE3(write_complete, offset, bytes, ec.value());
+
+        if (metrics_)
+        {
+            metrics_->record_write_syscall(bytes);
+        }
+
+        report(io_operation::write, offset, bytes, start, ec);
+
+        return bytes;
+    }
+
+    /**
+     * @brief Write some data at the given offset (one physical write), throwing on error.
+     */
+    template <class ConstBufferSequence>
+    std::size_t write_some_at(std::uint64_t offset, const ConstBufferSequence &buffers)
+    {
+        boost::system::error_code ec;
+        const std::size_t bytes = write_some_at(offset, buffers, ec);
+        if (ec)
+        {
+            throw boost::system::system_error(ec, "write_some_at");
+        }
+        return bytes;
+    }
+
+    /**
+     * @brief Asynchronously read some data at the given offset (one physical read).
+     */
+    template <class MutableBufferSequence, class ReadToken>
+    auto async_read_some_at(std::uint64_t offset, const MutableBufferSequence &buffers, ReadToken &&token)
+    {
+        return boost::asio::async_initiate<ReadToken, void(boost::system::error_code, std::size_t)>(
+            [this](auto handler, std::uint64_t offset, const MutableBufferSequence &buffers)
+            {
+                if (!metrics_ && !kLibFitsProbes && !has_hook())
+                {
+                    file_.async_read_some_at(offset, buffers, std::move(handler));
+                    return;
+                }
+
+                LIB_FITS_PROBE2(read_submit, offset, boost::asio::buffer_size(buffers));
+
+                const auto start = has_hook() ? io_event::clock::now() : io_event::clock::time_point{};
+
+                auto executor = boost::asio::get_associated_executor(handler, get_executor());
+                file_.async_read_some_at(offset, buffers,
+                                         boost::asio::bind_executor(executor, [this, offset, start, handler = std::move(handler)](const boost::system::error_code &ec, std::size_t bytes) mutable
+                                                                    {
+                                                                        LIB_FITS_PROBE3(read_complete, offset, bytes, ec.value());
+                                                                        if (metrics_)
+                                                                        {
+                                                                            metrics_->record_read_syscall(bytes);
+                                                                        }
+                                                                        report(io_operation::read, offset, bytes, start, ec);
+                                                                        std::move(handler)(ec, bytes); }));
+            },
+            token, offset, buffers);
+    }
+
+    /**
+     * @brief Asynchronously write some data at the given offset (one physical write).
+     */
+    template <class ConstBufferSequence, class WriteToken>
+    auto async_write_some_at(std::uint64_t offset, const ConstBufferSequence &buffers, WriteToken &&token)
+    {
+        return boost::asio::async_initiate<WriteToken, void(boost::system::error_code, std::size_t)>(
+            [this](auto handler, std::uint64_t offset, const ConstBufferSequence &buffers)
+            {
+                if (!metrics_ && !kLibFitsProbes && !has_hook())
+                {
+                    file_.async_write_some_at(offset, buffers, std::move(handler));
+                    return;
+                }
+
+                LIB_FITS_PROBE2(write_submit, offset, boost::asio::buffer_size(buffers));
+
+                const auto start = has_hook() ? io_event::clock::now() : io_event::clock::time_point{};
+
+                auto executor = boost::asio::get_associated_executor(handler, get_executor());
+                file_.async_write_some_at(offset, buffers,
+                                          boost::asio::bind_executor(executor, [this, offset, start, handler = std::move(handler)](const boost::system::error_code &ec, std::size_t bytes) mutable
+                                                                     {
+                                                                         LIB_FITS_PROBE3(write_complete, offset, bytes, ec.value());
+                                                                         if (metrics_)
+                                                                         {
+                                                                             metrics_->record_write_syscall(bytes);
+                                                                         }
+                                                                         report(io_operation::write, offset, bytes, start, ec);
+                                                                         std::move(handler)(ec, bytes); }));
+            },
+            token, offset, buffers);
+    }
+
+    /**
+     * @brief Read all the buffers at the given offset (one logical read).
+     *
+     * @return Number of bytes read
+     */
+    template <class MutableBufferSequence>
+    std::size_t read_at(std::uint64_t offset, const MutableBufferSequence &buffers)
+    {
+        if (!metrics_)
+        {
+            return boost::asio::read_at(*this, offset, buffers);
+        }
+
+        const auto start = io_metrics::now();
+        const std::size_t bytes = boost::asio::read_at(*this, offset, buffers);
+        metrics_->record_read(io_metrics::elapsed_ns(start));
+
+        return bytes;
+    }
+
+    /**
+     * @brief Write all the buffers at the given offset (one logical write).
+     *
+     * @return Number of bytes written
+     */
+    template <class ConstBufferSequence>
+    std::size_t write_at(std::uint64_t offset, const ConstBufferSequence &buffers)
+    {
+        if (!metrics_)
+        {
+            return boost::asio::write_at(*this, offset, buffers);
+        }
+
+        const auto start = io_metrics::now();
+        const std::size_t bytes = boost::asio::write_at(*this, offset, buffers);
+        metrics_->record_write(io_metrics::elapsed_ns(start));
+
+        return bytes;
+    }
+
+    /**
+     * @brief Asynchronously read all the buffers at the given offset (one logical read).
+     */
+    template <class MutableBufferSequence, class ReadToken>
+    auto async_read_at(std::uint64_t offset, const MutableBufferSequence &buffers, ReadToken &&token)
+    {
+        return boost::asio::async_initiate<ReadToken, void(boost::system::error_code, std::size_t)>(
+            [this](auto handler, std::uint64_t offset, const MutableBufferSequence &buffers)
+            {
+                if (schedule_.scheduler)
+                {
+                    // The view lives as long as the composed operation, which owns the handler
+                    auto view = std::make_shared<scheduled_view>(*this);
+                    auto executor = boost::asio::get_associated_executor(handler, get_executor());
+                    start_read_at(*view, offset, buffers,
+                                  boost::asio::bind_executor(executor, [view, handler = std::move(handler)](const boost::system::error_code &ec, std::size_t bytes) mutable
+                                                             { std::move(handler)(ec, bytes); }));
+                    return;
+                }
+
+                start_read_at(*this, offset, buffers, std::move(handler));
+            },
+            token, offset, buffers);
+    }
+
+    /**
+     * @brief Asynchronously write all the buffers at the given offset (one logical write).
+     */
+    template <class ConstBufferSequence, class WriteToken>
+    auto async_write_at(std::uint64_t offset, const ConstBufferSequence &buffers, WriteToken &&token)
+    {
+        return boost::asio::async_initiate<WriteToken, void(boost::system::error_code, std::size_t)>(
+            [this](auto handler, std::uint64_t offset, const ConstBufferSequence &buffers)
+            {
+                if (schedule_.scheduler)
+                {
+                    // The view lives as long as the composed operation, which owns the handler
+                    auto view = std::make_shared<scheduled_view>(*this);
+                    auto executor = boost::asio::get_associated_executor(handler, get_executor());
+                    start_write_at(*view, offset, buffers,
+                                   boost::asio::bind_executor(executor, [view, handler = std::move(handler)](const boost::system::error_code &ec, std::size_t bytes) mutable
+                                                              { std::move(handler)(ec, bytes); }));
+                    return;
+                }
+
+                start_write_at(*this, offset, buffers, std::move(handler));
+            },
+            token, offset, buffers);
+    }
+
+private:
+    /**
+     * @brief View of the device whose physical operations wait for the scheduler.
+     *
+     * The composed operations of async_read_at and async_write_at run on a
+     * view, which gives all the chunks of a logical operation its deadline.
+     */
+    class scheduled_view
+    {
+    public:
+        using executor_type = typename File::executor_type;
+
+        explicit scheduled_view(file_device &device)
+            : device_(device),
+              deadline_(device.schedule_.deadline.count() > 0 ? io_scheduler::clock::now() + device.schedule_.deadline
+                                                              : io_scheduler::clock::time_point::max())
+        {
+        }
+
+        executor_type get_executor() noexcept
+        {
+            return device_.get_executor();
+        }
+
+        template <class MutableBufferSequence, class ReadToken>
+        auto async_read_some_at(std::uint64_t offset, const MutableBufferSequence &buffers, ReadToken &&token)
+        {
+            return device_.async_scheduled_some_at(offset, device_.first_chunk(buffers), deadline_, std::forward<ReadToken>(token),
+                                                   [&device = device_](std::uint64_t position, auto chunk, auto handler)
+                                                   { device.async_read_some_at(position, chunk, std::move(handler)); });
+        }
+
+        template <class ConstBufferSequence, class WriteToken>
+        auto async_write_some_at(std::uint64_t offset, const ConstBufferSequence &buffers, WriteToken &&token)
+        {
+            return device_.async_scheduled_some_at(offset, device_.first_chunk(buffers), deadline_, std::forward<WriteToken>(token),
+                                                   [&device = device_](std::uint64_t position, auto chunk, auto handler)
+                                                   { device.async_write_some_at(position, chunk, std::move(handler)); });
+        }
+
+    private:
+        file_device &device_;                      // The scheduled device
+        io_scheduler::clock::time_point deadline_; // Deadline of the logical operation
+    };
+
+    /**
+     * @brief Run a composed read on the device or on a view, recording its latency.
+     */
+    template <class Device, class MutableBufferSequence, class Handler>
+    void start_read_at(Device &device, std::uint64_t offset, const MutableBufferSequence &buffers, Handler handler)
+    {
+        if (!metrics_)
+        {
+            boost::asio::async_read_at(device, offset, buffers, std::move(handler));
+            return;
+        }
+
+        metrics_->async_submitted();
+
+        auto executor = boost::asio::get_associated_executor(handler, get_executor());
+        boost::asio::async_read_at(device, offset, buffers,
+                                   boost::asio::bind_executor(executor, [metrics = metrics_, start = io_metrics::now(), handler = std::move(handler)](const boost::system::error_code &ec, std::size_t bytes) mutable
+                                                              {
+                                                                  metrics->async_completed();
+                                                                  metrics->record_read(io_metrics::elapsed_ns(start));
+                                                                  std::move(handler)(ec, bytes); }));
+    }
+
+    /**
+     * @brief Run a composed write on the device or on a view, recording its latency.
+     */
+    template <class Device, class ConstBufferSequence, class Handler>
+    void start_write_at(Device &device, std::uint64_t offset, const ConstBufferSequence &buffers, Handler handler)
+    {
+        if (!metrics_)
+        {
+            boost::asio::async_write_at(device, offset, buffers, std::move(handler));
+            return;
+        }
+
+        metrics_->async_submitted();
+
+        auto executor = boost::asio::get_associated_executor(handler, get_executor());
+        boost::asio::async_write_at(device, offset, buffers,
+                                    boost::asio::bind_executor(executor, [metrics = metrics_, start = io_metrics::now(), handler = std::move(handler)](const boost::system::error_code &ec, std::size_t bytes) mutable
+                                                               {
+                                                                   metrics->async_completed();
+                                                                   metrics->record_write(io_metrics::elapsed_ns(start));
+                                                                   std::move(handler)(ec, bytes); }));
+    }
+
+    /**
+     * @brief First non-empty buffer of a sequence, cut to the chunk size of the scheduler.
+     */
+    template <class BufferSequence>
+    auto first_chunk(const BufferSequence &buffers) const
+    {
+        using buffer_t = std::decay_t<decltype(*boost::asio::buffer_sequence_begin(buffers))>;
+
+        for (auto it = boost::asio::buffer_sequence_begin(buffers); it != boost::asio::buffer_sequence_end(buffers); ++it)
+        {
+            if (it->size() > 0)
+            {
+                return buffer_t(boost::asio::buffer(*it, schedule_.scheduler->max_chunk()));
+            }
+        }
+        return buffer_t();
+    }
+
+    /**
+     * @brief Submit one physical operation on a chunk once the scheduler admits it.
+     *
+     * The operation is started on the executor of the file and releases its
+     * slot when it completes, before the handler runs. While it waits in the
+     * queue it keeps work on the executors of the file and of the handler,
+     * so that their run() does not return before it is started.
+     */
+    template <class Buffer, class Token, class Operation>
+    auto async_scheduled_some_at(std::uint64_t offset, Buffer chunk, io_scheduler::clock::time_point deadline, Token &&token, Operation operation)
+    {
+        return boost::asio::async_initiate<Token, void(boost::system::error_code, std::size_t)>(
+            [this, deadline, operation](auto handler, std::uint64_t offset, Buffer chunk)
+            {
+                auto executor = boost::asio::get_associated_executor(handler, get_executor());
+                auto state = std::make_shared<decltype(handler)>(std::move(handler));
+                auto scheduler = schedule_.scheduler;
+
+                auto work = boost::asio::make_work_guard(get_executor());
+                auto handler_work = boost::asio::make_work_guard(executor);
+
+                scheduler->submit(schedule_.priority, chunk.size(), deadline, [this, executor, scheduler, operation, offset, chunk, state, work, handler_work]() mutable
+                                  {
+                                      boost::asio::post(get_executor(), [executor, scheduler, operation, offset, chunk, state, handler_work]() mutable
+                                                        {
+                                                            operation(offset, chunk,
+                                                                      boost::asio::bind_executor(executor, [scheduler, state](const boost::system::error_code &ec, std::size_t bytes)
+                                                                                                 {
+                                                                                                     scheduler->release();
+                                                                                                     std::move(*state)(ec, bytes); }));
+                                                            handler_work.reset(); });
+                                      work.reset(); });
+            },
+            token, offset, chunk);
+    }
+
+    File &file_;           // The wrapped file
+    io_metrics *metrics_;  // Metrics to record into, nullptr if disabled
+    io_hook hook_;         // Hook called after every operation, may be empty
+    hdu_offsets hdus_;     // Header offsets of the HDUs, only filled with a hook
+    io_schedule schedule_; // Scheduler of the asynchronous operations, may be empty
+};
@@ -0,0 +1,108 @@
+/**
+ * @file hooks.hpp
+ * @author Alina Gubeeva
+ * @brief Per-operation hook called by ifits and ofits
+ * @version 0.1
+ * @date 2024-04-10
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+// STL
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Boost
+#include <boost/system/error_code.hpp>
+
+#include "memory.hpp" // memory_usage
+
+/*
+ * Hooks are compiled in unless LIB_FITS_DISABLE_HOOKS is defined (CMake
+ * option LIB_FITS_HOOKS=OFF). When compiled in, an ifits or ofits without a
+ * hook only pays one test of an empty std::function per operation.
+ */
+#if defined(LIB_FITS_DISABLE_HOOKS)
+inline constexpr bool kLibFitsHooks = false;
+#else
+inline constexpr bool kLibFitsHooks = true;
+#endif
+
+/**
+ * @brief Kind of operation reported to an io_hook.
+ */
+enum class io_operation
+{
+    read,         // One physical read
+    write,        // One physical write
+    header_parse, // Parsing of one HDU header by ifits
+    header_flush  // ofits wrote the END keyword of an HDU header
+};
+
+/**
+ * @brief Operation reported to an io_hook.
+ */
+struct io_event
+{
+    using clock = std::chrono::steady_clock;
+
+    io_operation operation;       // Kind of operation
+    std::size_t hdu;              // Index of the HDU the offset belongs to
+    std::uint64_t offset;         // Offset in the file
+    std::size_t length;           // Number of bytes transferred, or size of the header
+    clock::time_point start;      // When the operation was submitted
+    clock::time_point end;        // When the operation completed
+    boost::system::error_code ec; // Error of the operation, if any
+};
+
+/**
+ * @brief Hook called once per operation, after it completed.
+ *
+ * Asynchronous operations call the hook from the thread running the
+ * io_context, so a hook shared between files or used with several threads
+ * running the context must be thread-safe. The hook must not throw.
+ */
+using io_hook = std::function<void(const io_event &)>;
+
+/**
+ * @brief Maps file offsets to HDU indices for the events of an io_hook.
+ *
+ * The HDUs are added in file order with the offset of their header.
+ */
+class hdu_offsets
+{
+public:
+    /**
+     * @brief Add the next HDU, starting at the given offset.
+     */
+    void add(std::uint64_t offset)
+    {
+        offsets_.push_back(offset);
+    }
+
+    /**
+     * @brief Index of the HDU containing the given offset.
+     */
+    std::size_t find(std::uint64_t offset) const noexcept
+    {
+        const auto it = std::upper_bound(offsets_.begin(), offsets_.end(), offset);
+        return it == offsets_.begin() ? 0 : static_cast<std::size_t>(it - offsets_.begin() - 1);
+    }
+
+    /**
+     * @brief Heap bytes held by the offsets.
+     */
+    std::size_t heap_bytes() const noexcept
+    {
+        return memory_usage::heap_bytes(offsets_);
+    }
+
+private:
+    std::vector<std::uint64_t> offsets_; // Header offset of every HDU, in file order
+};
@@ -0,0 +1,252 @@
+/**
+ * @file io_scheduler.hpp
+ * @author Alina Gubeeva
+ * @brief Priority classes, deadlines and weighted fair queueing of asynchronous I/O
+ * @version 0.1
+ * @date 2024-04-10
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+// STL
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+/**
+ * @brief Priority class of the operations of a file.
+ */
+enum class io_priority
+{
+    interactive, // Latency-sensitive operations, e.g. cutouts for a viewer
+    bulk         // Throughput operations, e.g. reprocessing
+};
+
+/**
+ * @brief Parameters of an io_scheduler.
+ */
+struct io_scheduler_options
+{
+    std::size_t max_in_flight = 4;                // Physical operations submitted at a time
+    std::size_t max_chunk = std::size_t(1) << 20; // Largest physical operation in bytes, larger ones are split
+    double interactive_weight = 16.0;             // Share of the bandwidth of interactive operations
+    double bulk_weight = 1.0;                     // Share of the bandwidth of bulk operations
+};
+
+/**
+ * @brief Admission of asynchronous physical operations, shared by many files.
+ *
+ * At most max_in_flight operations are submitted at a time, the others wait
+ * in a queue. When a slot frees up:
+ *
+ * - a waiting operation past its deadline goes first, the earliest deadline
+ *   first;
+ * - otherwise the operations are taken in weighted fair queueing order: an
+ *   operation of n bytes of a class of weight w finishes at n / w in the
+ *   virtual time of its class, so while both classes are waiting the
+ *   interactive ones get interactive_weight / bulk_weight times the bytes of
+ *   the bulk ones, and a new interactive operation overtakes the waiting
+ *   bulk ones.
+ *
+ * Operations are split into chunks of max_chunk bytes by the devices, so an
+ * interactive operation waits for at most one chunk per slot. Waiting
+ * operations are started from the thread completing an operation, outside
+ * the lock of the scheduler.
+ *
+ * Pass the scheduler to the ifits and ofits constructors with an
+ * io_schedule. The io_context of every file with admitted operations must
+ * be running, or its slots are not released.
+ */
+class io_scheduler
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Constructor
+     *
+     * @param options Slots, chunk size and weights of the classes
+     */
+    explicit io_scheduler(const io_scheduler_options &options = {})
+        : options_(options)
+    {
+        options_.max_in_flight = std::max<std::size_t>(options_.max_in_flight, 1);
+        options_.max_chunk = std::max<std::size_t>(options_.max_chunk, 1);
+    }
+
+    io_scheduler(const io_scheduler &) = delete;
+    io_scheduler &operator=(const io_scheduler &) = delete;
+
+    /**
+     * @brief Largest physical operation, in bytes.
+     */
+    std::size_t max_chunk() const noexcept
+    {
+        return options_.max_chunk;
+    }
+
+    /**
+     * @brief Queue an operation, started at once if a slot is free
+     *
+     * @param priority Class of the operation
+     * @param bytes Size of the operation
+     * @param deadline When the operation should be started at the latest, clock::time_point::max() for none
+     * @param start Called once the operation is admitted; release() must be called when it completes
+     */
+    void submit(io_priority priority, std::size_t bytes, clock::time_point deadline, std::function<void()> start)
+    {
+        {
+            std::lock_guard lock(mutex_);
+
+            const std::size_t c = static_cast<std::size_t>(priority);
+            const double weight = priority == io_priority::interactive ? options_.interactive_weight : options_.bulk_weight;
+
+            auto operation = std::make_shared<queued_operation>();
+            operation->start = std::move(start);
+            operation->virtual_start = std::max(virtual_time_, finish_[c]);
+            finish_[c] = operation->virtual_start + static_cast<double>(bytes) / std::max(weight, 1e-9);
+
+            by_finish_.emplace(finish_[c], operation);
+            if (deadline != clock::time_point::max())
+            {
+                by_deadline_.emplace(deadline, operation);
+            }
+            ++queued_;
+        }
+
+        dispatch();
+    }
+
+    /**
+     * @brief Release the slot of an operation that completed, and start the next waiting ones.
+     */
+    void release()
+    {
+        {
+            std::lock_guard lock(mutex_);
+            --in_flight_;
+        }
+
+        dispatch();
+    }
+
+    /**
+     * @brief Number of operations waiting for a slot.
+     */
+    std::size_t queued() const
+    {
+        std::lock_guard lock(mutex_);
+        return queued_;
+    }
+
+    /**
+     * @brief Number of operations admitted and not released yet.
+     */
+    std::size_t in_flight() const
+    {
+        std::lock_guard lock(mutex_);
+        return in_flight_;
+    }
+
+private:
+    struct queued_operation
+    {
+        std::function<void()> start; // Submits the operation
+        double virtual_start = 0.0;  // Virtual time at which the operation starts in its class
+        bool admitted = false;       // Whether it was taken from one of the queues
+    };
+
+    using queue_t = std::multimap<double, std::shared_ptr<queued_operation>>;
+    using deadline_queue_t = std::multimap<clock::time_point, std::shared_ptr<queued_operation>>;
+
+    /**
+     * @brief Start waiting operations while there are free slots.
+     */
+    void dispatch()
+    {
+        while (true)
+        {
+            std::function<void()> start;
+            {
+                std::lock_guard lock(mutex_);
+                if (in_flight_ >= options_.max_in_flight)
+                {
+                    return;
+                }
+
+                auto operation = next(clock::now());
+                if (!operation)
+                {
+                    return;
+                }
+
+                operation->admitted = true;
+                virtual_time_ = std::max(virtual_time_, operation->virtual_start);
+                start = std::move(operation->start);
+                --queued_;
+                ++in_flight_;
+            }
+
+            start();
+        }
+    }
+
+    /**
+     * @brief Take the next operation to admit, nullptr if none is waiting. Called with the lock held.
+     */
+    std::shared_ptr<queued_operation> next(clock::time_point now)
+    {
+        // Entries of operations already taken from the other queue are dropped lazily
+        while (!by_deadline_.empty() && by_deadline_.begin()->second->admitted)
+        {
+            by_deadline_.erase(by_deadline_.begin());
+        }
+        if (!by_deadline_.empty() && by_deadline_.begin()->first <= now)
+        {
+            auto operation = std::move(by_deadline_.begin()->second);
+            by_deadline_.erase(by_deadline_.begin());
+            return operation;
+        }
+
+        while (!by_finish_.empty())
+        {
+            auto operation = std::move(by_finish_.begin()->second);
+            by_finish_.erase(by_finish_.begin());
+            if (!operation->admitted)
+            {
+                return operation;
+            }
+        }
+        return nullptr;
+    }
+
+    io_scheduler_options options_;   // Slots, chunk size and weights
+    mutable std::mutex mutex_;       // Protects the members below
+    queue_t by_finish_;              // Waiting operations by virtual finish time
+    deadline_queue_t by_deadline_;   // Waiting operations with a deadline, by deadline
+    std::array<double, 2> finish_{}; // Virtual finish time of the last operation of every class
+    double virtual_time_ = 0.0;      // Virtual start time of the last admitted operation
+    std::size_t queued_ = 0;         // Operations waiting for a slot
+    std::size_t in_flight_ = 0;      // Operations admitted and not released
+};
+
+/**
+ * @brief How the asynchronous operations of an ifits or ofits are scheduled.
+ *
+ * Without a scheduler the operations go straight to the io_context.
+ */
+struct io_schedule
+{
+    std::shared_ptr<io_scheduler> scheduler;  // Scheduler shared by the files, nullptr to disable scheduling
+    io_priority priority = io_priority::bulk; // Class of the operations of the file
+    std::chrono::nanoseconds deadline{0};     // Deadline of every operation after it is issued, 0 for none
+};
@@ -0,0 +1,470 @@
+/**
+ * @file keywords.hpp
+ * @author Alina Gubeeva
+ * @brief Compile-time handles of the reserved header keywords
+ * @version 0.1
+ * @date 2024-04-10
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+// STL
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Reserved keywords with a fixed name.
+ *
+ * Their position in this array is the slot of the keyword in a keyword_index.
+ */
+inline constexpr std::array<std::string_view, 44> kReservedKeywords = {
+    "SIMPLE", "XTENSION", "BITPIX", "NAXIS", "EXTEND", "PCOUNT", "GCOUNT", "GROUPS",
+    "TFIELDS", "THEAP", "BSCALE", "BZERO", "BUNIT", "BLANK", "DATAMIN", "DATAMAX",
+    "EXTNAME", "EXTVER", "EXTLEVEL", "INHERIT", "OBJECT", "TELESCOP", "INSTRUME", "OBSERVER",
+    "ORIGIN", "AUTHOR", "REFERENC", "DATE", "DATE-OBS", "MJD-OBS", "EXPTIME", "EQUINOX",
+    "EPOCH", "RADESYS", "FILTER", "AIRMASS", "GAIN", "RDNOISE", "ZIMAGE", "ZBITPIX",
+    "ZNAXIS", "ZCMPTYPE", "CHECKSUM", "DATASUM"};
+
+/**
+ * @brief Reserved keywords with an index suffix (NAXISn, TFORMn, ...).
+ *
+ * Their position in this array is the family of the keyword in a keyword_index.
+ */
+inline constexpr std::array<std::string_view, 16> kIndexedKeywords = {
+    "NAXIS", "TFORM", "TTYPE", "TUNIT", "TSCAL", "TZERO", "TNULL", "TDISP",
+    "TDIM", "CTYPE", "CRPIX", "CRVAL", "CDELT", "CUNIT", "CROTA", "ZNAXIS"};
+
+/**
+ * @brief Upper case of an ASCII character, header keywords are compared case-insensitively.
+ */
+constexpr char keyword_upper(char ch) noexcept
+{
+    return (ch >= 'a' && ch <= 'z') ? static_cast<char>(ch - 'a' + 'A') : ch;
+}
+
+/**
+ * @brief Case-insensitive comparison of two keywords.
+ */
+constexpr bool keyword_equal(std::string_view a, std::string_view b) noexcept
+{
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y)
+                                              { return keyword_upper(x) == keyword_upper(y); });
+}
+
+/**
+ * @brief Seeded case-insensitive FNV-1a hash of a keyword.
+ */
+constexpr std::uint32_t keyword_hash(std::string_view key, std::uint32_t seed) noexcept
+{
+    std::uint32_t hash = 2166136261u ^ (seed * 0x9e3779b9u);
+    for (char ch : key)
+    {
+        hash ^= static_cast<unsigned char>(keyword_upper(ch));
+        hash *= 16777619u;
+    }
+    return hash ^ (hash >> 15);
+}
+
+/**
+ * @brief Number of buckets of the perfect hash of the reserved keywords.
+ */
+inline constexpr std::size_t kKeywordBuckets = 256;
+
+/**
+ * @brief Seed for which keyword_hash() has no collision on kReservedKeywords.
+ *
+ * Found at compile time, the compilation fails if there is none.
+ */
+inline constexpr std::uint32_t kKeywordSeed = []
+{
+    for (std::uint32_t seed = 0;; ++seed)
+    {
+        std::array<bool, kKeywordBuckets> used{};
+        bool collision = false;
+        for (auto name : kReservedKeywords)
+        {
+            auto &bucket = used[keyword_hash(name, seed) % kKeywordBuckets];
+            collision = collision || bucket;
+            bucket = true;
+        }
+        if (!collision)
+        {
+            return seed;
+        }
+    }
+}();
+
+/**
+ * @brief Slot of the reserved keyword in every bucket of the perfect hash, kReservedKeywords.size() if empty.
+ */
+inline constexpr std::array<std::uint8_t, kKeywordBuckets> kKeywordBucketSlots = []
+{
+    std::array<std::uint8_t, kKeywordBuckets> slots{};
+    slots.fill(static_cast<std::uint8_t>(kReservedKeywords.size()));
+    for (std::size_t slot = 0; slot < kReservedKeywords.size(); ++slot)
+    {
+        slots[keyword_hash(kReservedKeywords[slot], kKeywordSeed) % kKeywordBuckets] = static_cast<std::uint8_t>(slot);
+    }
+    return slots;
+}();
+
+/**
+ * @brief Slot of a reserved keyword, kReservedKeywords.size() if it is not reserved.
+ *
+ * One hash and one comparison, used when a header is indexed.
+ */
+constexpr std::size_t reserved_keyword_slot(std::string_view key) noexcept
+{
+    const std::size_t slot = kKeywordBucketSlots[keyword_hash(key, kKeywordSeed) % kKeywordBuckets];
+    return (slot < kReservedKeywords.size() && keyword_equal(kReservedKeywords[slot], key)) ? slot : kReservedKeywords.size();
+}
+
+/**
+ * @brief Family and index of an indexed keyword, {kIndexedKeywords.size(), 0} if it is not one.
+ */
+constexpr std::pair<std::size_t, std::size_t> indexed_keyword_slot(std::string_view key) noexcept
+{
+    std::size_t digits = 0;
+    while (digits < key.size() && key[key.size() - 1 - digits] >= '0' && key[key.size() - 1 - digits] <= '9')
+    {
+        ++digits;
+    }
+
+    if (digits == 0 || digits > 3 || digits == key.size() || key[key.size() - digits] == '0')
+    {
+        return {kIndexedKeywords.size(), 0};
+    }
+
+    const auto prefix = key.substr(0, key.size() - digits);
+
+    std::size_t index = 0;
+    for (char ch : key.substr(key.size() - digits))
+    {
+        index = index * 10 + static_cast<std::size_t>(ch - '0');
+    }
+
+    for (std::size_t family = 0; family < kIndexedKeywords.size(); ++family)
+    {
+        if (keyword_equal(kIndexedKeywords[family], prefix))
+        {
+            return {family, index};
+        }
+    }
+    return {kIndexedKeywords.size(), 0};
+}
+
+/**
+ * @brief Name of a keyword as a template argument.
+ */
+template <std::size_t N>
+struct keyword_name
+{
+    constexpr keyword_name(const char (&name)[N]) noexcept
+    {
+        std::copy_n(name, N, chars);
+    }
+
+    constexpr std::string_view view() const noexcept
+    {
+        return {chars, N - 1};
+    }
+
+    char chars[N]{};
+};
+
+/**
+ * @brief Handle of a reserved keyword with a fixed name.
+ *
+ * @tparam Name Name of the keyword, must be in kReservedKeywords
+ * @tparam T Type of the value
+ */
+template <keyword_name Name, class T>
+struct keyword
+{
+    using value_type = T;
+
+    static constexpr std::string_view name = Name.view();
+    static constexpr std::size_t slot = reserved_keyword_slot(name);
+
+    static_assert(slot < kReservedKeywords.size(), "Not a reserved keyword, see kReservedKeywords");
+};
+
+/**
+ * @brief Handle of a family of reserved keywords with an index suffix.
+ *
+ * @tparam Prefix Name of the keyword without the index, must be in kIndexedKeywords
+ * @tparam T Type of the values
+ */
+template <keyword_name Prefix, class T>
+struct indexed_keyword
+{
+    using value_type = T;
+
+    static constexpr std::string_view name = Prefix.view();
+    static constexpr std::size_t family = []
+    {
+        const auto it = std::find(kIndexedKeywords.begin(), kIndexedKeywords.end(), Prefix.view());
+        return static_cast<std::size_t>(it - kIndexedKeywords.begin());
+    }();
+
+    static_assert(family < kIndexedKeywords.size(), "Not an indexed keyword, see kIndexedKeywords");
+};
+
+template <class T>
+inline constexpr bool is_indexed_keyword_v = false;
+
+template <keyword_name Prefix, class T>
+inline constexpr bool is_indexed_keyword_v<indexed_keyword<Prefix, T>> = true;
+
+/**
+ * @brief Handles of the reserved keywords, e.g. hdu.get<kw::EXPTIME>() or hdu.get<kw::NAXISn>(2).
+ */
+namespace kw
+{
+    using SIMPLE = keyword<"SIMPLE", bool>;
+    using XTENSION = keyword<"XTENSION", std::string>;
+    using BITPIX = keyword<"BITPIX", int>;
+    using NAXIS = keyword<"NAXIS", int>;
+    using EXTEND = keyword<"EXTEND", bool>;
+    using PCOUNT = keyword<"PCOUNT", std::size_t>;
+    using GCOUNT = keyword<"GCOUNT", std::size_t>;
+    using TFIELDS = keyword<"TFIELDS", int>;
+    using BSCALE = keyword<"BSCALE", double>;
+    using BZERO = keyword<"BZERO", double>;
+    using BUNIT = keyword<"BUNIT", std::string>;
+    using BLANK = keyword<"BLANK", std::int64_t>;
+    using DATAMIN = keyword<"DATAMIN", double>;
+    using DATAMAX = keyword<"DATAMAX", double>;
+    using EXTNAME = keyword<"EXTNAME", std::string>;
+    using EXTVER = keyword<"EXTVER", int>;
+    using OBJECT = keyword<"OBJECT", std::string>;
+    using TELESCOP = keyword<"TELESCOP", std::string>;
+    using INSTRUME = keyword<"INSTRUME", std::string>;
+    using DATE_OBS = keyword<"DATE-OBS", std::string>;
+    using MJD_OBS = keyword<"MJD-OBS", double>;
+    using EXPTIME = keyword<"EXPTIME", double>;
+    using EQUINOX = keyword<"EQUINOX", double>;
+    using FILTER = keyword<"FILTER", std::string>;
+    using AIRMASS = keyword<"AIRMASS", double>;
+    using GAIN = keyword<"GAIN", double>;
+
+    using NAXISn = indexed_keyword<"NAXIS", std::size_t>;
+    using TFORMn = indexed_keyword<"TFORM", std::string>;
+    using TTYPEn = indexed_keyword<"TTYPE", std::string>;
+    using TUNITn = indexed_keyword<"TUNIT", std::string>;
+    using TSCALn = indexed_keyword<"TSCAL", double>;
+    using TZEROn = indexed_keyword<"TZERO", double>;
+    using TNULLn = indexed_keyword<"TNULL", std::int64_t>;
+    using CTYPEn = indexed_keyword<"CTYPE", std::string>;
+    using CRPIXn = indexed_keyword<"CRPIX", double>;
+    using CRVALn = indexed_keyword<"CRVAL", double>;
+    using CDELTn = indexed_keyword<"CDELT", double>;
+    using CUNITn = indexed_keyword<"CUNIT", std::string>;
+} // namespace kw
+
+/**
+ * @brief Convert the text of a header value to the type of a keyword handle.
+ *
+ * Logical values are T or F, strings lose their quotes, floating-point
+ * values may use the Fortran D exponent.
+ *
+ * @tparam T Type of the value
+ * @param text Value as stored in the header
+ * @param name Name of the keyword, for the error message
+ */
+template <class T>
+T keyword_value(const std::string &text, std::string_view name)
+{
+    auto fail = [&]() -> T
+    {
+        throw std::runtime_error("Failed to convert value of " + std::string(name));
+    };
+
+    if constexpr (std::is_same_v<T, bool>)
+    {
+        if (text == "T")
+            return true;
+        if (text == "F")
+            return false;
+        return fail();
+    }
+    else if constexpr (std::is_same_v<T, std::string>)
+    {
+        if (text.size() >= 2 && text.front() == '\'' && text.back() == '\'')
+        {
+            return text.substr(1, text.size() - 2);
+        }
+        return text;
+    }
+    else if constexpr (std::is_floating_point_v<T>)
+    {
+        std::string copy = text;
+        std::replace_if(copy.begin(), copy.end(), [](char ch)
+                        { return ch == 'D' || ch == 'd'; }, 'E');
+
+        T value{};
+        const char *first = copy.data();
+        if (!copy.empty() && *first == '+')
+        {
+            ++first;
+        }
+        const auto [end, ec] = std::from_chars(first, copy.data() + copy.size(), value);
+        if (ec != std::errc() || end != copy.data() + copy.size())
+        {
+            return fail();
+        }
+        return value;
+    }
+    else
+    {
+        T value{};
+        const char *first = text.data();
+        if (!text.empty() && *first == '+')
+        {
+            ++first;
+        }
+        const auto [end, ec] = std::from_chars(first, text.data() + text.size(), value);
+        if (ec != std::errc() || end != text.data() + text.size())
+        {
+            return fail();
+        }
+        return value;
+    }
+}
+
+/**
+ * @brief Direct access to the values of the reserved keywords of one header.
+ *
+ * Built once from the header container, after which a keyword handle finds
+ * its value with array lookups only. The index points into the nodes of the
+ * container, which stay in place when it rehashes; a copy of the container
+ * needs a new index.
+ */
+class keyword_index
+{
+public:
+    keyword_index() noexcept
+    {
+        fixed_.fill(kNone);
+    }
+
+    /**
+     * @brief Index the reserved keywords of a header.
+     *
+     * When a keyword appears more than once, its first card in file order is
+     * indexed, whatever the order of the container.
+     *
+     * @tparam Cards Range of pointers to the (keyword, value) pairs of the header container
+     * @param cards Cards of the header, in file order
+     */
+    template <class Cards>
+    void build(const Cards &cards)
+    {
+        fixed_.fill(kNone);
+        ranges_.fill({0, 0});
+        entries_.clear();
+
+        struct indexed_entry
+        {
+            std::size_t family;
+            std::size_t index;
+            const std::string *value;
+        };
+        std::vector<indexed_entry> indexed;
+
+        for (const auto *card : cards)
+        {
+            const auto &[key, value] = *card;
+            const std::size_t slot = reserved_keyword_slot(key);
+            if (slot < kReservedKeywords.size())
+            {
+                if (fixed_[slot] == kNone)
+                {
+                    fixed_[slot] = static_cast<std::uint8_t>(entries_.size());
+                    entries_.push_back(&value);
+                }
+                continue;
+            }
+
+            const auto [family, index] = indexed_keyword_slot(key);
+            if (family < kIndexedKeywords.size())
+            {
+                indexed.push_back({family, index, &value});
+            }
+        }
+
+        if (indexed.empty())
+        {
+            return;
+        }
+
+        // One contiguous range per family, holes stay null
+        std::array<std::size_t, kIndexedKeywords.size()> counts{};
+        for (const auto &entry : indexed)
+        {
+            counts[entry.family] = std::max(counts[entry.family], entry.index);
+        }
+
+        for (std::size_t family = 0; family < kIndexedKeywords.size(); ++family)
+        {
+            ranges_[family] = {static_cast<std::uint16_t>(entries_.size()), static_cast<std::uint16_t>(counts[family])};
+            entries_.resize(entries_.size() + counts[family], nullptr);
+        }
+
+        for (const auto &entry : indexed)
+        {
+            auto &slot = entries_[ranges_[entry.family].first + entry.index - 1];
+            if (!slot)
+            {
+                slot = entry.value;
+            }
+        }
+    }
+
+    /**
+     * @brief Value of a reserved keyword, nullptr if the header does not have it.
+     */
+    const std::string *find(std::size_t slot) const noexcept
+    {
+        return fixed_[slot] == kNone ? nullptr : entries_[fixed_[slot]];
+    }
+
+    /**
+     * @brief Value of an indexed keyword, nullptr if the header does not have it.
+     *
+     * @param family Family of the keyword (position in kIndexedKeywords)
+     * @param index Index of the keyword, starting at 1
+     */
+    const std::string *find(std::size_t family, std::size_t index) const noexcept
+    {
+        const auto [first, count] = ranges_[family];
+        return (index == 0 || index > count) ? nullptr : entries_[first + index - 1];
+    }
+
+    /**
+     * @brief Heap bytes held by the index.
+     */
+    std::size_t heap_bytes() const noexcept
+    {
+        return entries_.capacity() * sizeof(const std::string *);
+    }
+
+private:
+    static constexpr std::uint8_t kNone = 0xff; // Slot of a keyword absent from the header
+
+    std::array<std::uint8_t, kReservedKeywords.size()> fixed_{};                               // Entry of every reserved keyword
+    std::array<std::pair<std::uint16_t, std::uint16_t>, kIndexedKeywords.size()> ranges_{}; // First entry and count of every family
+    std::vector<const std::string *> entries_;                                                // Values, fixed keywords first
+};
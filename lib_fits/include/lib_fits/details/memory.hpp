@@ -0,0 +1,85 @@
+/**
+ * @file memory.hpp
+ * @author Alina Gubeeva
+ * @brief Accounting of the memory held by ifits objects
+ * @version 0.1
+ * @date 2024-04-10
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+// STL
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Bytes of memory held by an ifits or one of its HDUs.
+ *
+ * Heap blocks are counted with an estimate of the allocator overhead (one
+ * pointer-sized chunk header, 16-byte granularity, as glibc malloc does), so
+ * the totals can be compared with the resident set size of a process.
+ */
+struct memory_usage
+{
+    std::size_t headers = 0; // Keywords and values of the headers, including the hash nodes
+    std::size_t index = 0;   // Bucket arrays and the other lookup structures
+    std::size_t caches = 0;  // Data cached to speed up repeated accesses
+    std::size_t objects = 0; // The objects themselves and their containers
+
+    /**
+     * @brief Total number of bytes.
+     */
+    std::size_t total() const noexcept
+    {
+        return headers + index + caches + objects;
+    }
+
+    memory_usage &operator+=(const memory_usage &other) noexcept
+    {
+        headers += other.headers;
+        index += other.index;
+        caches += other.caches;
+        objects += other.objects;
+        return *this;
+    }
+
+    /**
+     * @brief Estimated size of a heap block of the given size, including the allocator overhead.
+     */
+    static constexpr std::size_t heap_block(std::size_t size) noexcept
+    {
+        if (size == 0)
+        {
+            return 0;
+        }
+        const std::size_t block = (size + sizeof(void *) + 15) & ~std::size_t(15);
+        return block < 32 ? 32 : block;
+    }
+
+    /**
+     * @brief Heap bytes of a string, zero if it is stored in the object (small string optimization).
+     */
+    static std::size_t heap_bytes(const std::string &s) noexcept
+    {
+        const char *data = s.data();
+        const char *object = reinterpret_cast<const char *>(&s);
+        if (data >= object && data < object + sizeof(s))
+        {
+            return 0;
+        }
+        return heap_block(s.capacity() + 1);
+    }
+
+    /**
+     * @brief Heap bytes of a vector.
+     */
+    template <class T>
+    static std::size_t heap_bytes(const std::vector<T> &v) noexcept
+    {
+        return heap_block(v.capacity() * sizeof(T));
+    }
+};
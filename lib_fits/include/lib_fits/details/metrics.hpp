@@ -0,0 +1,373 @@
+/**
+ * @file metrics.hpp
+ * @author Alina Gubeeva
+ * @brief Opt-in I/O metrics: counters and latency histograms
+ * @version 0.1
+ * @date 2024-04-10
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+// STL
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * @brief Snapshot of a latency_histogram.
+ *
+ * Plain copy of the bucket counts that can be inspected without
+ * synchronization.
+ */
+struct latency_histogram_snapshot
+{
+    /**
+     * @brief Number of linear sub-buckets per power of two (as a power of two).
+     *
+     * 3 bits give 8 sub-buckets, i.e. a relative error of at most 12.5%.
+     */
+    static constexpr std::size_t kSubBucketBits = 3;
+
+    /**
+     * @brief Number of linear sub-buckets per power of two.
+     */
+    static constexpr std::size_t kSubBuckets = std::size_t{1} << kSubBucketBits;
+
+    /**
+     * @brief Total number of buckets, enough for any 64-bit value.
+     */
+    static constexpr std::size_t kBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+    std::array<std::uint64_t, kBuckets> counts{}; // Number of values per bucket
+    std::uint64_t total = 0;                      // Number of recorded values
+    std::uint64_t sum = 0;                        // Sum of recorded values, in nanoseconds
+    std::uint64_t max = 0;                        // Largest recorded value, in nanoseconds
+
+    /**
+     * @brief Bucket index of a value.
+     *
+     * Values below kSubBuckets get one bucket each. Larger values are split
+     * in powers of two, each divided in kSubBuckets linear sub-buckets.
+     *
+     * @param value Value in nanoseconds
+     * @return Index of the bucket
+     */
+    static constexpr std::size_t bucket_index(std::uint64_t value) noexcept
+    {
+        if (value < kSubBuckets)
+        {
+            return static_cast<std::size_t>(value);
+        }
+
+        const std::size_t shift = std::bit_width(value) - 1 - kSubBucketBits;
+
+        return (shift + 1) * kSubBuckets + static_cast<std::size_t>((value >> shift) & (kSubBuckets - 1));
+    }
+
+    /**
+     * @brief Largest value that falls into a bucket.
+     *
+     * @param index Index of the bucket
+     * @return Upper bound of the bucket, in nanoseconds
+     */
+    static constexpr std::uint64_t bucket_upper_bound(std::size_t index) noexcept
+    {
+        if (index < kSubBuckets)
+        {
+            return index;
+        }
+
+        const std::size_t shift = index / kSubBuckets - 1;
+        const std::uint64_t lower = (kSubBuckets + index % kSubBuckets) << shift;
+
+        return lower + ((std::uint64_t{1} << shift) - 1);
+    }
+
+    /**
+     * @brief Value below which the fraction @p q of the recorded values lie.
+     *
+     * @param q Quantile in [0, 1]
+     * @return Upper bound of the bucket containing the quantile, in nanoseconds (0 if empty)
+     */
+    std::uint64_t percentile(double q) const noexcept
+    {
+        if (total == 0)
+        {
+            return 0;
+        }
+
+        const auto rank = static_cast<std::uint64_t>(q * static_cast<double>(total - 1)) + 1;
+
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < kBuckets; ++i)
+        {
+            seen += counts[i];
+            if (seen >= rank)
+            {
+                return std::min(bucket_upper_bound(i), max);
+            }
+        }
+        return max;
+    }
+
+    /**
+     * @brief Mean of the recorded values.
+     *
+     * @return Mean in nanoseconds (0 if empty)
+     */
+    double mean() const noexcept
+    {
+        return total == 0 ? 0.0 : static_cast<double>(sum) / static_cast<double>(total);
+    }
+};
+
+/**
+ * @brief Lock-free latency histogram with logarithmic buckets.
+ *
+ * HDR-style layout: powers of two split into linear sub-buckets, see
+ * latency_histogram_snapshot. Recording is wait-free and may happen from
+ * several threads running the same io_context.
+ */
+class latency_histogram
+{
+public:
+    /**
+     * @brief Record one latency.
+     *
+     * @param nanoseconds Latency in nanoseconds
+     */
+    void record(std::uint64_t nanoseconds) noexcept
+    {
+        counts_[latency_histogram_snapshot::bucket_index(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+        total_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+        std::uint64_t max = max_.load(std::memory_order_relaxed);
+        while (nanoseconds > max && !max_.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    /**
+     * @brief Copy the current counts.
+     *
+     * @return Snapshot of the histogram
+     */
+    latency_histogram_snapshot snapshot() const noexcept
+    {
+        latency_histogram_snapshot result;
+        for (std::size_t i = 0; i < latency_histogram_snapshot::kBuckets; ++i)
+        {
+            result.counts[i] = counts_[i].load(std::memory_order_relaxed);
+        }
+        result.total = total_.load(std::memory_order_relaxed);
+        result.sum = sum_.load(std::memory_order_relaxed);
+        result.max = max_.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    /**
+     * @brief Reset all counts to zero.
+     */
+    void reset() noexcept
+    {
+        for (auto &count : counts_)
+        {
+            count.store(0, std::memory_order_relaxed);
+        }
+        total_.store(0, std::memory_order_relaxed);
+        sum_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::array<std::atomic<std::uint64_t>, latency_histogram_snapshot::kBuckets> counts_{}; // Number of values per bucket
+    std::atomic<std::uint64_t> total_{0};                                                   // Number of recorded values
+    std::atomic<std::uint64_t> sum_{0};                                                     // Sum of recorded values
+    std::atomic<std::uint64_t> max_{0};                                                     // Largest recorded value
+};
+
+/**
+ * @brief Snapshot of io_metrics.
+ */
+struct io_metrics_snapshot
+{
+    std::uint64_t bytes_read = 0;             // Bytes read from the file, headers included
+    std::uint64_t bytes_written = 0;          // Bytes written to the file, headers included
+    std::uint64_t read_ops = 0;               // read_data/async_read_data calls
+    std::uint64_t write_ops = 0;              // write_data/async_write_data calls
+    std::uint64_t read_syscalls = 0;          // Physical reads issued to the file
+    std::uint64_t write_syscalls = 0;         // Physical writes issued to the file
+    std::uint64_t hdus_parsed = 0;            // Number of HDU headers parsed
+    std::uint64_t header_parse_ns = 0;        // Total time spent parsing headers
+    std::uint64_t queue_depth = 0;            // Asynchronous operations in flight
+    std::uint64_t max_queue_depth = 0;        // Largest number of asynchronous operations in flight
+    latency_histogram_snapshot read_latency;  // Latency of read operations
+    latency_histogram_snapshot write_latency; // Latency of write operations
+};
+
+/**
+ * @brief Opt-in I/O metrics of an ifits or ofits object.
+ *
+ * Pass a shared instance to the ifits or ofits constructor to enable
+ * recording; the same instance may be shared by several files to aggregate
+ * them. Without it the only cost on the I/O paths is a null pointer check.
+ */
+class io_metrics
+{
+    using clock = std::chrono::steady_clock;
+
+public:
+    /**
+     * @brief Current time, used to measure latencies.
+     */
+    static clock::time_point now() noexcept
+    {
+        return clock::now();
+    }
+
+    /**
+     * @brief Nanoseconds elapsed since @p start.
+     */
+    static std::uint64_t elapsed_ns(clock::time_point start) noexcept
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count());
+    }
+
+    /**
+     * @brief Record one physical read.
+     *
+     * @param bytes Number of bytes transferred
+     */
+    void record_read_syscall(std::uint64_t bytes) noexcept
+    {
+        read_syscalls_.fetch_add(1, std::memory_order_relaxed);
+        bytes_read_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Record one physical write.
+     *
+     * @param bytes Number of bytes transferred
+     */
+    void record_write_syscall(std::uint64_t bytes) noexcept
+    {
+        write_syscalls_.fetch_add(1, std::memory_order_relaxed);
+        bytes_written_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Record one completed read operation.
+     *
+     * @param nanoseconds Latency of the operation
+     */
+    void record_read(std::uint64_t nanoseconds) noexcept
+    {
+        read_ops_.fetch_add(1, std::memory_order_relaxed);
+        read_latency_.record(nanoseconds);
+    }
+
+    /**
+     * @brief Record one completed write operation.
+     *
+     * @param nanoseconds Latency of the operation
+     */
+    void record_write(std::uint64_t nanoseconds) noexcept
+    {
+        write_ops_.fetch_add(1, std::memory_order_relaxed);
+        write_latency_.record(nanoseconds);
+    }
+
+    /**
+     * @brief Record the parsing of one HDU header.
+     *
+     * @param nanoseconds Time spent parsing the header
+     */
+    void record_header_parse(std::uint64_t nanoseconds) noexcept
+    {
+        hdus_parsed_.fetch_add(1, std::memory_order_relaxed);
+        header_parse_ns_.fetch_add(nanoseconds, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Record the submission of an asynchronous operation.
+     */
+    void async_submitted() noexcept
+    {
+        const auto depth = queue_depth_.fetch_add(1, std::memory_order_relaxed) + 1;
+
+        std::uint64_t max = max_queue_depth_.load(std::memory_order_relaxed);
+        while (depth > max && !max_queue_depth_.compare_exchange_weak(max, depth, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    /**
+     * @brief Record the completion of an asynchronous operation.
+     */
+    void async_completed() noexcept
+    {
+        queue_depth_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Copy the current values.
+     *
+     * @return Snapshot of the metrics
+     */
+    io_metrics_snapshot snapshot() const noexcept
+    {
+        io_metrics_snapshot result;
+        result.bytes_read = bytes_read_.load(std::memory_order_relaxed);
+        result.bytes_written = bytes_written_.load(std::memory_order_relaxed);
+        result.read_ops = read_ops_.load(std::memory_order_relaxed);
+        result.write_ops = write_ops_.load(std::memory_order_relaxed);
+        result.read_syscalls = read_syscalls_.load(std::memory_order_relaxed);
+        result.write_syscalls = write_syscalls_.load(std::memory_order_relaxed);
+        result.hdus_parsed = hdus_parsed_.load(std::memory_order_relaxed);
+        result.header_parse_ns = header_parse_ns_.load(std::memory_order_relaxed);
+        result.queue_depth = queue_depth_.load(std::memory_order_relaxed);
+        result.max_queue_depth = max_queue_depth_.load(std::memory_order_relaxed);
+        result.read_latency = read_latency_.snapshot();
+        result.write_latency = write_latency_.snapshot();
+        return result;
+    }
+
+    /**
+     * @brief Reset all counters and histograms, except the current queue depth.
+     */
+    void reset() noexcept
+    {
+        bytes_read_.store(0, std::memory_order_relaxed);
+        bytes_written_.store(0, std::memory_order_relaxed);
+        read_ops_.store(0, std::memory_order_relaxed);
+        write_ops_.store(0, std::memory_order_relaxed);
+        read_syscalls_.store(0, std::memory_order_relaxed);
+        write_syscalls_.store(0, std::memory_order_relaxed);
+        hdus_parsed_.store(0, std::memory_order_relaxed);
+        header_parse_ns_.store(0, std::memory_order_relaxed);
+        max_queue_depth_.store(queue_depth_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        read_latency_.reset();
+        write_latency_.reset();
+    }
+
+private:
+    std::atomic<std::uint64_t> bytes_read_{0};      // Bytes read from the file
+    std::atomic<std::uint64_t> bytes_written_{0};   // Bytes written to the file
+    std::atomic<std::uint64_t> read_ops_{0};        // Completed read operations
+    std::atomic<std::uint64_t> write_ops_{0};       // Completed write operations
+    std::atomic<std::uint64_t> read_syscalls_{0};   // Physical reads
+    std::atomic<std::uint64_t> write_syscalls_{0};  // Physical writes
+    std::atomic<std::uint64_t> hdus_parsed_{0};     // Parsed HDU headers
+    std::atomic<std::uint64_t> header_parse_ns_{0}; // Time spent parsing headers
+    std::atomic<std::uint64_t> queue_depth_{0};     // Asynchronous operations in flight
+    std::atomic<std::uint64_t> max_queue_depth_{0}; // Largest queue depth seen
+    latency_histogram read_latency_;                // Latency of read operations
+    latency_histogram write_latency_;               // Latency of write operations
+};
@@ -0,0 +1,65 @@
+/**
+ * @file probes.hpp
+ * @author Alina Gubeeva
+ * @brief Optional USDT (sys/sdt.h) static tracepoints
+ * @version 0.1
+ * @date 2024-04-10
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+/*
+ * Static tracepoints of the "lib_fits" provider, enabled by defining
+ * LIB_FITS_ENABLE_USDT (CMake option LIB_FITS_USDT) when <sys/sdt.h> is
+ * available. An enabled probe compiles to a single nop in the hot path and
+ * only costs something while a tracer (bpftrace, perf, SystemTap) is
+ * attached to it. Without LIB_FITS_ENABLE_USDT the probes expand to nothing.
+ *
+ * Probes and their arguments:
+ *   discovery_start(path)                  ifits starts reading the HDU headers
+ *   discovery_end(path, hdus)              ifits found all the HDUs
+ *   hdu_parse_start(offset)                parsing of one header starts at offset
+ *   hdu_parse_end(offset, data_offset, keywords)
+ *   read_submit(offset, size)              one physical read is issued
+ *   read_complete(offset, size, error)     size is the number of bytes read
+ *   write_submit(offset, size)             one physical write is issued
+ *   write_complete(offset, size, error)    size is the number of bytes written
+ *   header_flush(offset, keywords)         ofits wrote the header of the HDU at offset
+ *
+ * Example:
+ *   bpftrace -e 'usdt:./app:lib_fits:read_complete { @[arg1] = count(); }'
+ */
+
+#if defined(LIB_FITS_ENABLE_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define LIB_FITS_HAS_USDT 1
+#endif
+#endif
+
+#if defined(LIB_FITS_HAS_USDT)
+
+#define LIB_FITS_PROBE1(name, a) DTRACE_PROBE1(lib_fits, name, a)
+#define LIB_FITS_PROBE2(name, a, b) DTRACE_PROBE2(lib_fits, name, a, b)
+#define LIB_FITS_PROBE3(name, a, b, c) DTRACE_PROBE3(lib_fits, name, a, b, c)
+
+/**
+ * @brief Whether the USDT probes are compiled in.
+ */
+inline constexpr bool kLibFitsProbes = true;
+
+#else
+
+#define LIB_FITS_PROBE1(name, a) ((void)0)
+#define LIB_FITS_PROBE2(name, a, b) ((void)0)
+#define LIB_FITS_PROBE3(name, a, b, c) ((void)0)
+
+/**
+ * @brief Whether the USDT probes are compiled in.
+ */
+inline constexpr bool kLibFitsProbes = false;
+
+#endif
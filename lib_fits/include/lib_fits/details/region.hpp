@@ -0,0 +1,166 @@
+/**
+ * @file region.hpp
+ * @author Alina Gubeeva
+ * @brief Rectangular regions of an image
+ * @version 0.1
+ * @date 2024-04-10
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+// STL
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * @brief How the pixels of a bin are combined.
+ */
+enum class bin_mode
+{
+    sum, // Sum of the valid pixels
+    mean // Mean of the valid pixels, NaN when there are none
+};
+
+/**
+ * @brief Binning of the last two axes of an image.
+ *
+ * The bins at the end of the axes are partial when the sizes of the axes
+ * are not multiples of the bin sizes. NaN pixels are left out of the bins.
+ */
+struct binning
+{
+    std::size_t rows = 2;           // Bin size along the second to last axis
+    std::size_t columns = 2;        // Bin size along the last axis
+    bin_mode mode = bin_mode::mean; // Combination of the pixels of a bin
+    std::size_t threads = 1;        // Number of threads splitting the rows of bins
+};
+
+/**
+ * @brief Rectangular region of an image.
+ *
+ * Both vectors have one entry per axis, slowest axis first, as the index
+ * lists of ifits and ofits. The region {{2, 0}, {3, 100}} of a 200x300
+ * image is rows 2 to 4, first 100 elements of every row.
+ */
+struct image_region
+{
+    std::vector<std::size_t> start; // Index of the first element along every axis
+    std::vector<std::size_t> count; // Number of elements along every axis
+
+    /**
+     * @brief Region covering a whole image of the given shape.
+     */
+    static image_region whole(const std::vector<std::size_t> &shape)
+    {
+        return {std::vector<std::size_t>(shape.size(), 0), shape};
+    }
+
+    /**
+     * @brief Number of elements in the region.
+     */
+    std::size_t size() const noexcept
+    {
+        std::size_t size = 1;
+        for (auto n : count)
+        {
+            size *= n;
+        }
+        return size;
+    }
+
+    /**
+     * @brief Call a function for every contiguous run of elements of the region
+     *
+     * The trailing axes that the region covers completely are merged with the
+     * last partial one, so a region of whole rows is a single run. The runs
+     * are visited in the order of the elements in the file.
+     *
+     * @param shape Number of elements along every axis of the image, slowest first
+     * @param f Called as f(offset, length, position): offset of the first element
+     * of the run in the image, number of elements in the run and number of
+     * elements of the region before the run, all in elements
+     * @throw std::runtime_error if the region does not fit in the image
+     */
+    template <class Function>
+    void for_each_run(const std::vector<std::size_t> &shape, Function &&f) const
+    {
+        const std::size_t rank = shape.size();
+
+        if (start.size() != rank || count.size() != rank)
+        {
+            throw std::runtime_error("Region rank does not match NAXIS");
+        }
+
+        for (std::size_t axis = 0; axis < rank; ++axis)
+        {
+            if (start[axis] > shape[axis] || count[axis] > shape[axis] - start[axis])
+            {
+                throw std::runtime_error("Region is out of bounds");
+            }
+        }
+
+        if (size() == 0)
+        {
+            return;
+        }
+
+        // Row-major strides, in elements
+        std::vector<std::size_t> strides(rank, 1);
+        for (std::size_t axis = rank; axis-- > 1;)
+        {
+            strides[axis - 1] = strides[axis] * shape[axis];
+        }
+
+        // Merge the trailing axes covered completely into one run
+        std::size_t outer = rank; // Axes before outer are iterated, the others form a run
+        std::size_t run = 1;
+        while (outer > 0)
+        {
+            --outer;
+            run *= count[outer];
+            if (count[outer] != shape[outer])
+            {
+                break;
+            }
+        }
+
+        std::vector<std::size_t> index(outer, 0);
+        std::size_t position = 0;
+
+        while (true)
+        {
+            std::size_t offset = 0;
+            for (std::size_t axis = 0; axis < rank; ++axis)
+            {
+                offset += (start[axis] + (axis < outer ? index[axis] : 0)) * strides[axis];
+            }
+
+            f(offset, run, position);
+            position += run;
+
+            // Advance the index of the iterated axes, fastest first
+            std::size_t axis = outer;
+            while (axis > 0)
+            {
+                --axis;
+                if (++index[axis] < count[axis])
+                {
+                    break;
+                }
+                index[axis] = 0;
+                if (axis == 0)
+                {
+                    return;
+                }
+            }
+            if (outer == 0)
+            {
+                return;
+            }
+        }
+    }
+};
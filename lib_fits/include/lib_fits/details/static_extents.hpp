@@ -0,0 +1,112 @@
+/**
+ * @file static_extents.hpp
+ * @author Alina Gubeeva
+ * @brief Image shapes known at compile time
+ * @version 0.1
+ * @date 2024-04-10
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+// STL
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+
+/**
+ * @brief Shape of an image with the extents as template parameters.
+ *
+ * The extents are given slowest axis first, as the index lists of ifits and
+ * ofits, so static_extents<2048, 2048> is a 2048x2048 frame and
+ * static_extents<64, 512, 512> a cube of 64 such 512x512 frames. The strides
+ * are constants, an index is converted to an offset with a few
+ * multiply-adds that the compiler folds when the index is known.
+ *
+ * @tparam Extents Number of elements along every axis, slowest first
+ */
+template <std::size_t... Extents>
+struct static_extents
+{
+    static_assert(sizeof...(Extents) > 0, "An image has at least one axis");
+    static_assert(((Extents > 0) && ...), "Extents must be positive");
+
+    /**
+     * @brief Number of axes.
+     */
+    static constexpr std::size_t rank = sizeof...(Extents);
+
+    /**
+     * @brief Index of one element, slowest axis first.
+     */
+    using index_type = std::array<std::size_t, rank>;
+
+    /**
+     * @brief Number of elements along every axis.
+     */
+    static constexpr index_type extents{Extents...};
+
+    /**
+     * @brief Number of elements.
+     */
+    static constexpr std::size_t size = (Extents * ...);
+
+    /**
+     * @brief Distance in elements between neighbours along every axis.
+     */
+    static constexpr index_type strides = []
+    {
+        index_type strides{};
+        std::size_t stride = 1;
+        for (std::size_t axis = rank; axis-- > 0;)
+        {
+            strides[axis] = stride;
+            stride *= extents[axis];
+        }
+        return strides;
+    }();
+
+    /**
+     * @brief Offset of an element in elements, without bounds checking.
+     */
+    static constexpr std::size_t offset(const index_type &index) noexcept
+    {
+        std::size_t offset = 0;
+        for (std::size_t axis = 0; axis < rank; ++axis)
+        {
+            offset += index[axis] * strides[axis];
+        }
+        return offset;
+    }
+
+    /**
+     * @brief Whether every coordinate of an index is inside the extents.
+     */
+    static constexpr bool contains(const index_type &index) noexcept
+    {
+        for (std::size_t axis = 0; axis < rank; ++axis)
+        {
+            if (index[axis] >= extents[axis])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Offset of an element in elements.
+     *
+     * @throw std::runtime_error if the index is out of bounds
+     */
+    static constexpr std::size_t checked_offset(const index_type &index)
+    {
+        if (!contains(index))
+        {
+            throw std::runtime_error("Index is out of bounds");
+        }
+        return offset(index);
+    }
+};
@@ -0,0 +1,235 @@
+/**
+ * @file statistics.hpp
+ * @author Alina Gubeeva
+ * @brief Statistics of pixel values accumulated while they are read or written
+ * @version 0.1
+ * @date 2024-04-10
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <type_traits>
+
+// Boost
+#include <boost/asio/buffer.hpp>
+
+/**
+ * @brief Minimum, maximum, sum and sum of squares of pixel values.
+ *
+ * NaN values, and integers equal to BLANK, are counted apart and do not
+ * contribute to the other fields. The values are accumulated in double, so
+ * sums of 64-bit integers above 2^53 are rounded.
+ *
+ * An accumulator is not thread-safe: threads accumulate partial statistics
+ * of their own and merge them with operator+= at the end.
+ */
+struct image_statistics
+{
+    std::size_t count = 0;   // Number of valid values
+    std::size_t invalid = 0; // Number of NaN or BLANK values
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    double sum = 0.0;
+    double sum_squares = 0.0;
+
+    /**
+     * @brief Mean of the valid values, NaN if there are none.
+     */
+    double mean() const noexcept
+    {
+        return count ? sum / static_cast<double>(count) : std::numeric_limits<double>::quiet_NaN();
+    }
+
+    /**
+     * @brief Population variance of the valid values, NaN if there are none.
+     */
+    double variance() const noexcept
+    {
+        if (!count)
+        {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        const double mean = this->mean();
+        return std::max(0.0, sum_squares / static_cast<double>(count) - mean * mean);
+    }
+
+    /**
+     * @brief Population standard deviation of the valid values, NaN if there are none.
+     */
+    double stddev() const noexcept
+    {
+        return std::sqrt(variance());
+    }
+
+    /**
+     * @brief Merge the statistics of other values.
+     */
+    image_statistics &operator+=(const image_statistics &other) noexcept
+    {
+        count += other.count;
+        invalid += other.invalid;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+        sum += other.sum;
+        sum_squares += other.sum_squares;
+        return *this;
+    }
+
+    /**
+     * @brief Accumulate values
+     *
+     * The values are spread over independent lanes merged at the end, which
+     * lets the compiler vectorize the loop without reassociating floating
+     * point operations.
+     *
+     * @param values Values to accumulate
+     * @param n Number of values
+     * @param blank Value marking undefined integers (BLANK keyword)
+     */
+    template <class T>
+    void accumulate(const T *values, std::size_t n, std::optional<T> blank = std::nullopt) noexcept
+    {
+        accumulate_bytes(reinterpret_cast<const unsigned char *>(values), n, blank);
+    }
+
+    /**
+     * @brief Accumulate the values held by a buffer sequence
+     *
+     * Every buffer holds whole values of type T, at any alignment.
+     *
+     * @param buffers Buffers holding the values
+     * @param size Number of bytes to accumulate, e.g. the number of bytes read
+     * @param blank Value marking undefined integers (BLANK keyword)
+     */
+    template <class T, class BufferSequence>
+    void accumulate_buffers(const BufferSequence &buffers, std::size_t size, std::optional<T> blank = std::nullopt) noexcept
+    {
+        std::size_t done = 0;
+        for (auto it = boost::asio::buffer_sequence_begin(buffers); it != boost::asio::buffer_sequence_end(buffers) && done < size; ++it)
+        {
+            const boost::asio::const_buffer buffer(*it);
+            const std::size_t length = std::min(buffer.size(), size - done);
+
+            accumulate_bytes(static_cast<const unsigned char *>(buffer.data()), length / sizeof(T), blank);
+
+            done += buffer.size();
+        }
+    }
+
+private:
+    /**
+     * @brief Number of independent accumulators.
+     */
+    static constexpr std::size_t kLanes = 8;
+
+    template <class T>
+    void accumulate_bytes(const unsigned char *bytes, std::size_t n, std::optional<T> blank) noexcept
+    {
+        static_assert(std::is_arithmetic_v<T>, "Pixels are integral or floating point values");
+
+        double lane_min[kLanes], lane_max[kLanes], lane_sum[kLanes], lane_squares[kLanes];
+        std::size_t lane_invalid[kLanes];
+        for (std::size_t lane = 0; lane < kLanes; ++lane)
+        {
+            lane_min[lane] = std::numeric_limits<double>::infinity();
+            lane_max[lane] = -std::numeric_limits<double>::infinity();
+            lane_sum[lane] = lane_squares[lane] = 0.0;
+            lane_invalid[lane] = 0;
+        }
+
+        const bool has_blank = blank.has_value();
+        const T blank_value = blank.value_or(T{});
+
+        auto add = [&](std::size_t i, std::size_t lane)
+        {
+            T raw;
+            std::memcpy(&raw, bytes + i * sizeof(T), sizeof(T));
+
+            bool valid;
+            if constexpr (std::is_floating_point_v<T>)
+            {
+                valid = raw == raw; // False for NaN
+            }
+            else
+            {
+                valid = !has_blank || raw != blank_value;
+            }
+
+            const double value = static_cast<double>(raw);
+            lane_min[lane] = valid && value < lane_min[lane] ? value : lane_min[lane];
+            lane_max[lane] = valid && value > lane_max[lane] ? value : lane_max[lane];
+            lane_sum[lane] += valid ? value : 0.0;
+            lane_squares[lane] += valid ? value * value : 0.0;
+            lane_invalid[lane] += !valid;
+        };
+
+        std::size_t i = 0;
+        for (; i + kLanes <= n; i += kLanes)
+        {
+            for (std::size_t lane = 0; lane < kLanes; ++lane)
+            {
+                add(i + lane, lane);
+            }
+        }
+        for (std::size_t lane = 0; i < n; ++i, ++lane)
+        {
+            add(i, lane);
+        }
+
+        std::size_t skipped = 0;
+        for (std::size_t lane = 0; lane < kLanes; ++lane)
+        {
+            min = std::min(min, lane_min[lane]);
+            max = std::max(max, lane_max[lane]);
+            sum += lane_sum[lane];
+            sum_squares += lane_squares[lane];
+            skipped += lane_invalid[lane];
+        }
+        count += n - skipped;
+        invalid += skipped;
+    }
+};
+
+/**
+ * @brief Median of the valid values among count values stride apart
+ *
+ * NaN values are left out. The valid values are copied to the scratch
+ * buffer and partially sorted there.
+ *
+ * @param values First value
+ * @param count Number of values
+ * @param stride Distance between two consecutive values, in values
+ * @param scratch Buffer of at least count values, overwritten
+ * @return The median, the mean of the two middle values for an even number of valid values, NaN if there are none
+ */
+inline double nan_median(const double *values, std::size_t count, std::size_t stride, double *scratch) noexcept
+{
+    std::size_t valid = 0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const double value = values[i * stride];
+        if (value == value) // False for NaN
+        {
+            scratch[valid++] = value;
+        }
+    }
+
+    if (!valid)
+    {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    double *middle = scratch + valid / 2;
+    std::nth_element(scratch, middle, scratch + valid);
+    return valid % 2 ? *middle : 0.5 * (*middle + *std::max_element(scratch, middle));
+}
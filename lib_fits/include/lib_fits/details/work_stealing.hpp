@@ -0,0 +1,266 @@
+/**
+ * @file work_stealing.hpp
+ * @author Alina Gubeeva
+ * @brief Thread pool balancing its tasks by work stealing
+ * @version 0.1
+ * @date 2024-04-10
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Thread pool where idle workers steal the tasks of busy ones.
+ *
+ * Every worker has its own queue. Tasks submitted by a worker go to its
+ * queue and are run last in, first out, while cache-warm; tasks submitted
+ * by other threads are spread over the queues in turn. A worker with an
+ * empty queue takes the oldest task of another queue. The first exception
+ * thrown by a task is kept and rethrown by wait(), the tasks submitted
+ * after it are dropped until then; the pool accepts tasks again once
+ * wait() returned or threw.
+ */
+class work_stealing_pool
+{
+public:
+    /**
+     * @brief Start the workers
+     *
+     * @param threads Number of workers, at least one
+     */
+    explicit work_stealing_pool(std::size_t threads)
+        : queues_(std::max<std::size_t>(threads, 1))
+    {
+        for (auto &queue : queues_)
+        {
+            queue = std::make_unique<task_queue>();
+        }
+
+        for (std::size_t worker = 0; worker < queues_.size(); ++worker)
+        {
+            workers_.emplace_back([this, worker]
+                                  { run(worker); });
+        }
+    }
+
+    work_stealing_pool(const work_stealing_pool &) = delete;
+    work_stealing_pool &operator=(const work_stealing_pool &) = delete;
+
+    /**
+     * @brief Finish the submitted tasks and stop the workers.
+     */
+    ~work_stealing_pool()
+    {
+        {
+            std::lock_guard lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+
+        for (auto &worker : workers_)
+        {
+            worker.join();
+        }
+    }
+
+    /**
+     * @brief Number of workers.
+     */
+    std::size_t size() const noexcept
+    {
+        return queues_.size();
+    }
+
+    /**
+     * @brief Index of the worker running the calling thread
+     *
+     * Lets tasks use per-worker buffers without locking.
+     *
+     * @return The index, size() when called from another thread
+     */
+    std::size_t worker() const noexcept
+    {
+        return current_pool_ == this ? current_worker_ : queues_.size();
+    }
+
+    /**
+     * @brief Queue a task
+     *
+     * @param task Task to run on one of the workers
+     */
+    void submit(std::function<void()> task)
+    {
+        if (failed())
+        {
+            return;
+        }
+
+        const std::size_t queue = current_pool_ == this ? current_worker_ : next_queue_++ % queues_.size();
+
+        // Counted first, so that pending_ never misses a task that is already running
+        {
+            std::lock_guard lock(mutex_);
+            ++pending_;
+            ++queued_;
+        }
+        {
+            std::lock_guard lock(queues_[queue]->mutex);
+            queues_[queue]->tasks.push_back(std::move(task));
+        }
+        wake_.notify_one();
+    }
+
+    /**
+     * @brief Wait until all the submitted tasks have run
+     *
+     * Clears the failure, so that the pool can be reused.
+     *
+     * @throw The first exception thrown by a task
+     */
+    void wait()
+    {
+        std::unique_lock lock(mutex_);
+        done_.wait(lock, [this]
+                   { return pending_ == 0; });
+
+        failed_ = false;
+        if (error_)
+        {
+            std::rethrow_exception(std::exchange(error_, nullptr));
+        }
+    }
+
+    /**
+     * @brief Whether a task has thrown an exception.
+     */
+    bool failed() const noexcept
+    {
+        return failed_.load(std::memory_order_relaxed);
+    }
+
+private:
+    /**
+     * @brief Queue of the tasks of one worker.
+     */
+    struct task_queue
+    {
+        std::mutex mutex;                        // Protects tasks
+        std::deque<std::function<void()>> tasks; // Own tasks are taken from the back, stolen ones from the front
+    };
+
+    /**
+     * @brief Take a task, from the own queue first
+     */
+    bool take(std::size_t worker, std::function<void()> &task)
+    {
+        {
+            auto &own = *queues_[worker];
+            std::lock_guard lock(own.mutex);
+            if (!own.tasks.empty())
+            {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+
+        for (std::size_t i = 1; i < queues_.size(); ++i)
+        {
+            auto &victim = *queues_[(worker + i) % queues_.size()];
+            std::lock_guard lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Loop of a worker
+     */
+    void run(std::size_t worker)
+    {
+        current_worker_ = worker;
+        current_pool_ = this;
+
+        while (true)
+        {
+            {
+                std::unique_lock lock(mutex_);
+                wake_.wait(lock, [this]
+                           { return stopping_ || queued_ > 0; });
+                if (queued_ == 0)
+                {
+                    return; // Stopping
+                }
+                --queued_; // Reserve one of the queued tasks
+            }
+
+            // The reserved task may be counted by submit() and not in its queue yet
+            std::function<void()> task;
+            while (!take(worker, task))
+            {
+                std::this_thread::yield();
+            }
+
+            if (!failed())
+            {
+                try
+                {
+                    task();
+                }
+                catch (...)
+                {
+                    std::lock_guard lock(mutex_);
+                    if (!error_)
+                    {
+                        error_ = std::current_exception();
+                    }
+                    failed_ = true;
+                }
+            }
+
+            std::lock_guard lock(mutex_);
+            if (--pending_ == 0)
+            {
+                done_.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<task_queue>> queues_; // One queue per worker
+    std::vector<std::thread> workers_;                // Threads of the workers
+    std::atomic<std::size_t> next_queue_{0};          // Queue of the next task submitted from outside
+    std::atomic<bool> failed_{false};                 // Whether a task has thrown
+
+    std::mutex mutex_;             // Protects the fields below
+    std::condition_variable wake_; // Notified when a task is queued or the pool stops
+    std::condition_variable done_; // Notified when no task is pending
+    std::size_t pending_ = 0;      // Tasks queued or running
+    std::size_t queued_ = 0;       // Tasks not reserved by a worker yet
+    bool stopping_ = false;        // Set by the destructor
+    std::exception_ptr error_;     // First exception thrown by a task
+
+    static inline thread_local std::size_t current_worker_ = 0;             // Worker running on this thread
+    static inline thread_local work_stealing_pool *current_pool_ = nullptr; // Pool of that worker
+};
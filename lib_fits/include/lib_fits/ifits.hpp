@@ -9,6 +9,8 @@
  *
  */
 
+#pragma once
+
 // STL
 #include <string>
 #include <unordered_map>
@@ -18,13 +20,34 @@
 #include <string_view>
 #include <list>
 #include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <exception>
 
 // Boost
 #include <boost/asio.hpp>
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/algorithm/string/erase.hpp>
 
-#include "details/search.hpp" // CaseInsensitiveHash, CaseInsensitiveEqual
+#include "details/search.hpp"         // CaseInsensitiveHash, CaseInsensitiveEqual
+#include "details/metrics.hpp"        // io_metrics
+#include "details/hooks.hpp"          // io_hook
+#include "details/memory.hpp"         // memory_usage
+#include "details/keywords.hpp"       // kw, keyword_index
+#include "details/file_device.hpp"    // file_device, io_schedule
+#include "details/probes.hpp"         // LIB_FITS_PROBE*
+#include "details/static_extents.hpp" // static_extents
+#include "details/region.hpp"         // image_region, binning
+#include "details/convert.hpp"        // convert_pixels, pixel_scaling, overflow_policy
+#include "details/statistics.hpp"     // image_statistics
+#include "details/display_limits.hpp" // zscale_limits, sample_percentile
+#include "details/calibration.hpp"    // frame_calibration
+#include "details/work_stealing.hpp"  // work_stealing_pool
 
 // Check if BOOST_ASIO_HAS_FILE is defined
 #if !defined(BOOST_ASIO_HAS_FILE)
@@ -52,21 +75,40 @@ public:
      * This constructor opens the FITS file at the given path and extracts the headers and data from the individual HDUs.
      *
      * @param filename The path to the FITS file
+     * @param metrics Optional metrics recording the I/O of this file (see io_metrics)
+     * @param hook Optional hook called after every physical I/O and header parse (see io_hook)
+     * @param schedule Optional scheduler of the asynchronous reads (see io_scheduler)
      */
-    explicit ifits(const std::filesystem::path &filename)
+    explicit ifits(const std::filesystem::path &filename, std::shared_ptr<io_metrics> metrics = nullptr, io_hook hook = {},
+                   io_schedule schedule = {})
         : io_context_(),
-          file_(io_context_.get_executor(), filename.string(), boost::asio::random_access_file::read_only)
+          file_(io_context_.get_executor(), filename.string(), boost::asio::random_access_file::read_only),
+          metrics_(std::move(metrics)),
+          device_(file_, metrics_.get(), std::move(hook), std::move(schedule))
     {
         std::uint64_t next_hdu_offset = 0; // The offset of the next HDU
 
+        LIB_FITS_PROBE1(discovery_start, filename.c_str());
+
         try
         {
             // Loop until we reach the end of the file
             while (true)
             {
+                device_.add_hdu(next_hdu_offset);
+
+                const auto parse_start = io_metrics::now();
+
                 // Extract the next HDU and its offset
                 auto res = hdu(*this).extract_next_HDU(next_hdu_offset);
 
+                if (metrics_)
+                {
+                    metrics_->record_header_parse(io_metrics::elapsed_ns(parse_start));
+                }
+
+                device_.report(io_operation::header_parse, next_hdu_offset, res.second - next_hdu_offset, parse_start);
+
                 auto new_hdu = res.first; // The extracted HDU
 
                 hdus_.push_back(new_hdu); // Add the HDU to the list of HDUs
@@ -84,13 +126,16 @@ public:
         {
             throw std::runtime_error("Error while reading FITS file: " + filename.string() + " - " + e.what());
         }
+
+        LIB_FITS_PROBE2(discovery_end, filename.c_str(), hdus_.size());
     }
 
     /**
      * @brief Run the io_context.
      *
      * This function runs the io_context, which is necessary to read any data from the file asynchronously.
-     * The function blocks until the io_context is stopped.
+     * The function blocks until the io_context is stopped. Once run() has returned, call restart() before
+     * issuing and running another batch of reads.
      */
     void run() noexcept
     {
@@ -98,6 +143,17 @@ public:
         io_context_.run();
     }
 
+    /**
+     * @brief Restart the io_context.
+     *
+     * This function prepares the io_context for another run() after a previous run() has returned, because
+     * it ran out of work or stop() was called.
+     */
+    void restart() noexcept
+    {
+        io_context_.restart();
+    }
+
     /**
      * @brief Stop the io_context.
      *
@@ -133,6 +189,28 @@ public:
          */
         static constexpr std::size_t kSizeHeaderBlock = 2880;
 
+        /**
+         * @brief Number of values converted per read by read_as.
+         *
+         * Keeps the staging buffer of the stored type in the L2 cache.
+         */
+        static constexpr std::size_t kConversionChunk = 16384;
+
+        /**
+         * @brief Number of segments read from every sampled row.
+         */
+        static constexpr std::size_t kSampleSegments = 8;
+
+        /**
+         * @brief Number of threads reading the runs of a sample concurrently.
+         */
+        static constexpr std::size_t kSampleThreads = 8;
+
+        /**
+         * @brief Default number of pixels sampled to estimate percentiles.
+         */
+        static constexpr std::size_t kPercentileSamples = 100000;
+
     public:
         /**
          * @brief Construct a new HDU object
@@ -147,6 +225,29 @@ public:
         {
         }
 
+        /**
+         * @brief Copy constructor
+         *
+         * The keyword index points into the header container, so the copy
+         * inserts the cards into its own container in file order and indexes
+         * them.
+         *
+         * @param other HDU to copy
+         */
+        hdu(const hdu &other)
+            : parent_ifits_(other.parent_ifits_), offset_(other.offset_)
+        {
+            headers_.reserve(other.headers_.size());
+            cards_.reserve(other.cards_.size());
+            for (const auto *card : other.cards_)
+            {
+                cards_.push_back(&*headers_.emplace(card->first, card->second));
+            }
+            keywords_.build(cards_);
+        }
+
+        hdu(hdu &&other) = default;
+
         /**
          * @brief Calculate the offset in the HDU data block
          *
@@ -163,25 +264,20 @@ public:
 
             int naxis_size = (*this).get_NAXIS(); // Get the number of axes
 
-            if (index.size() > naxis_size) // Check if the size of the index is valid
+            if (index.size() > static_cast<std::size_t>(naxis_size)) // Check if the size of the index is valid
             {
                 throw std::runtime_error("Index size is greater than NAXIS size");
             }
 
             auto it = index.begin();
-            int i = naxis_size;
-            for (; it != index.end(); ++it, --i)
+            int i = 1; // NAXISn of the current axis
+            for (; it != index.end(); ++it, ++i)
             {
                 std::size_t product = *it; // Get the value of the current element
 
-                for (auto j = i; j != 1; --j) // Iterate over the axes backwards from the current one
+                for (auto j = i + 1; j <= naxis_size; ++j) // Iterate over the faster axes
                 {
-                    auto naxis_j = headers_.find("NAXIS" + std::to_string(j)); // Find the header keyword for the current axis
-                    if (naxis_j == headers_.end())
-                    {
-                        throw std::out_of_range("NAXIS" + std::to_string(j) + " not found");
-                    }
-                    product *= std::stoi(naxis_j->second); // Multiply the product by the size of the current axis
+                    product *= get<kw::NAXISn>(j); // Multiply the product by the size of the axis
                 }
 
                 offset += product;
@@ -205,10 +301,13 @@ public:
         {
             char buffer[81]; // Buffer to read header into
 
+            LIB_FITS_PROBE1(hdu_parse_start, offset);
+            [[maybe_unused]] const std::uint64_t header_offset = offset;
+
             // Read the header until we find the "END" keyword
             while (true)
             {
-                boost::asio::read_at(parent_ifits_.file_, offset, boost::asio::buffer(buffer, 80));
+                boost::asio::read_at(parent_ifits_.device_, offset, boost::asio::buffer(buffer, 80));
                 buffer[80] = '\0'; // Null-terminate the buffer
 
                 std::string key = std::string(buffer, 8); // Extract the 8-character key from the buffer
@@ -232,12 +331,16 @@ public:
                     break;
                 }
 
-                headers_.emplace(key, value); // Insert the key-value pair into the header container
+                cards_.push_back(&*headers_.emplace(key, value)); // Insert the key-value pair into the header container
 
                 offset += 80; // Increment the offset to the next 80-byte block
             }
 
-            offset_ = round_offset(offset); // Set the current HDU's offset
+            offset_ = round_offset(offset + 80); // Set the current HDU's offset, the END keyword belongs to the header
+
+            keywords_.build(cards_); // Index the reserved keywords
+
+            LIB_FITS_PROBE3(hdu_parse_end, header_offset, offset_, headers_.size());
 
             return std::make_pair(hdu(*this), round_offset(offset_));
         }
@@ -268,247 +371,914 @@ public:
          */
         int get_NAXIS() const
         {
-            auto it = headers_.find("NAXIS");
-            if (it == headers_.end())
-            {
-                throw std::out_of_range("NAXIS not found");
-            }
-            return std::stoi(it->second); // Convert the string to int
+            return get<kw::NAXIS>();
         }
 
-    private:
         /**
-         * @brief Round up the offset to the nearest multiple of the size of the header block.
+         * @brief Get the number of elements along every axis
          *
-         * @param offset The offset to be rounded
-         * @return The rounded offset
+         * @return NAXIS1 to NAXISn, in the order of the index lists
          */
-        static std::size_t round_offset(const std::size_t &offset) noexcept
+        std::vector<std::size_t> get_shape() const
         {
-            return (offset % kSizeHeaderBlock == 0) ? offset : (offset / kSizeHeaderBlock + 1) * kSizeHeaderBlock;
+            std::vector<std::size_t> shape(get_NAXIS());
+            for (std::size_t axis = 0; axis < shape.size(); ++axis)
+            {
+                shape[axis] = get<kw::NAXISn>(axis + 1);
+            }
+            return shape;
         }
 
         /**
-         * @brief Calculates the product of sizes of all axes of the current HDU
-         *
-         * The calculation is based on the values of keywords "NAXIS" and "NAXISi"
-         * for all i from 1 to the value of "NAXIS".
+         * @brief Get the file the HDU belongs to
          *
-         * @return The product of sizes of all axes of the current HDU
+         * @return The parent IFITS object
          */
-        std::size_t get_NAXIS_product() const
+        ifits &get_parent_ifits() const noexcept
         {
-            // Get the number of axes
-            auto it = headers_.find("NAXIS");
-            if (it == headers_.end())
-            {
-                throw std::out_of_range("NAXIS not found");
-            }
-
-            int NAXIS = std::stoi(it->second);
-
-            // Calculate the product of sizes of all axes
-            int product = 1;
-            for (int i = 1; i <= NAXIS; i++)
-            {
-                // Get the size of the axis
-                std::string key = "NAXIS" + std::to_string(i);
-                auto it = headers_.find(key);
-                if (it == headers_.end())
-                {
-                    throw std::out_of_range(key + " not found");
-                }
-                product *= std::stoi(it->second);
-            }
-
-            return product;
+            return parent_ifits_;
         }
 
         /**
-         * @brief Get the number of bits per pixel for the current HDU
-         *
-         * This function retrieves the value of the "BITPIX" header keyword.
-         * The value is returned as an integer.
+         * @brief Get the position of the data of the HDU in the file
          *
-         * @return Number of bits per pixel for the current HDU
+         * @return Offset of the first element of the data, in bytes
          */
-        int get_BITPIX() const
+        std::uint64_t get_data_offset() const noexcept
         {
-            auto it = headers_.find("BITPIX");
-            if (it == headers_.end())
-            {
-                throw std::out_of_range("BITPIX not found");
-            }
-
-            return std::stoi(it->second); // Convert the string to int
+            return offset_;
         }
 
         /**
-         * @brief 
-         * 
-         * @return header_container_t::const_iterator 
+         * @brief Get the size of a stored element
+         *
+         * @return |BITPIX| / 8, in bytes
          */
-        header_container_t::const_iterator cbegin() const
+        std::size_t get_element_size() const
         {
-            return headers_.cbegin();
+            return static_cast<std::size_t>(std::abs(get_BITPIX())) / 8;
         }
 
         /**
-         * @brief 
-         * 
-         * @return header_container_t::const_iterator 
+         * @brief Whether the image holds unsigned integers
+         *
+         * FITS stores unsigned 16, 32 and 64-bit integers as signed ones with
+         * BSCALE = 1 and BZERO = 2^(BITPIX - 1). apply() and read_as() return
+         * the unsigned values of such images.
+         *
+         * @return true if BITPIX, BSCALE and BZERO follow the unsigned convention
          */
-        header_container_t::const_iterator begin() const
+        bool is_unsigned() const
         {
-            return headers_.begin();
+            const int bitpix = get_BITPIX();
+            if (bitpix != 16 && bitpix != 32 && bitpix != 64)
+            {
+                return false;
+            }
+
+            const auto bzero = get_optional<kw::BZERO>();
+            return bzero && *bzero == std::ldexp(1.0, bitpix - 1) && get_optional<kw::BSCALE>().value_or(1.0) == 1.0;
         }
 
         /**
-         * @brief 
-         * 
-         * @return header_container_t::const_iterator 
+         * @brief Get the scaling of the values returned by apply() and read_data()
+         *
+         * The BZERO of unsigned images is part of their type (see
+         * is_unsigned) and is not included.
+         *
+         * @return BSCALE and BZERO, 1 and 0 when absent or for unsigned images
          */
-        header_container_t::const_iterator cend() const
+        pixel_scaling get_scaling() const
         {
-            return headers_.cend();
+            if (is_unsigned())
+            {
+                return {};
+            }
+            return {get_optional<kw::BSCALE>().value_or(1.0), get_optional<kw::BZERO>().value_or(0.0)};
         }
 
         /**
-         * @brief 
-         * 
-         * @return header_container_t::const_iterator 
+         * @brief Read a region of the image converted to another type
+         *
+         * The stored values are read whatever their BITPIX, scaled with BSCALE
+         * and BZERO when present (see get_scaling) and converted to U in a single pass over a
+         * bounded staging buffer, so no visitor and no full-frame buffer of the
+         * stored type are needed. When U is the stored type and there is no
+         * scaling the data is read directly into @p dest.
+         *
+         * @tparam U Type of the destination values
+         * @param region Region of the image to read
+         * @param dest Destination of the region.size() values, in file order
+         * @param policy What to do with values outside the range of U
+         * @throw std::runtime_error if the region is out of bounds or dest is too small
+         * @throw std::overflow_error if policy is overflow_policy::error and a value is out of range
          */
-        header_container_t::const_iterator end() const
+        template <class U>
+        void read_as(const image_region &region, std::span<U> dest, overflow_policy policy = overflow_policy::saturate)
         {
-            return headers_.end();
+            read_as(region, dest, get_scaling(), policy);
         }
 
-    public:
         /**
-         * @brief Get the headers object
-         * 
-         * @return const header_container_t& 
+         * @brief Read a region of the image converted to another type, with the given scaling
+         *
+         * Same as read_as(region, dest, policy) with the scaling given by the
+         * caller instead of BSCALE and BZERO; pass pixel_scaling{} for the
+         * stored values.
+         *
+         * @tparam U Type of the destination values
+         * @param region Region of the image to read
+         * @param dest Destination of the region.size() values, in file order
+         * @param scaling Scaling applied to the stored values
+         * @param policy What to do with values outside the range of U
          */
-        const header_container_t &get_headers() const noexcept
+        template <class U>
+        void read_as(const image_region &region, std::span<U> dest, const pixel_scaling &scaling,
+                     overflow_policy policy = overflow_policy::saturate)
         {
-            return headers_;
+            if (dest.size() < region.size())
+            {
+                throw std::runtime_error("Destination is too small for the region");
+            }
+
+            apply([&](auto image)
+                  {
+                using T = typename decltype(image)::value_type;
+
+                if constexpr (std::is_same_v<T, U>)
+                {
+                    if (scaling.is_identity())
+                    {
+                        region.for_each_run(get_shape(), [&](std::size_t offset, std::size_t length, std::size_t position)
+                                            {
+                            parent_ifits_.device_.read_at(offset_ + offset * sizeof(T),
+                                                          boost::asio::buffer(dest.data() + position, length * sizeof(T)));
+
+                            if constexpr (is_offset_unsigned_v<T>)
+                            {
+                                flip_sign_bits(dest.data() + position, length);
+                            } });
+                        return;
+                    }
+                }
+
+                // Runs longer than the staging buffer are converted in chunks
+                std::vector<T> staging(std::min(region.size(), kConversionChunk));
+
+                region.for_each_run(get_shape(), [&](std::size_t offset, std::size_t length, std::size_t position)
+                                    {
+                    for (std::size_t done = 0; done < length; done += staging.size())
+                    {
+                        const std::size_t chunk = std::min(staging.size(), length - done);
+
+                        parent_ifits_.device_.read_at(offset_ + (offset + done) * sizeof(T),
+                                                      boost::asio::buffer(staging.data(), chunk * sizeof(T)));
+
+                        if constexpr (is_offset_unsigned_v<T>)
+                        {
+                            flip_sign_bits(staging.data(), chunk);
+                        }
+
+                        convert_pixels(staging.data(), dest.data() + position + done, chunk, scaling, policy);
+                    } }); });
         }
 
         /**
-         * @brief Get the value of a header keyword
+         * @brief Read consecutive elements of the data converted to another type
          *
-         * This function retrieves the value of the specified header keyword
-         * from the current HDU. The value is returned as the type T,
-         * which must be convertible from std::string.
+         * The elements [first, first + dest.size()) in file order, whatever
+         * the axes they belong to, are read with one read and converted as by
+         * read_as. It is the building block of readers that merge the runs of
+         * several regions into larger reads, such as read_cutouts.
          *
-         * @tparam T The type of the return value
-         * @param key The name of the header keyword
-         * @return The value of the header keyword
+         * @tparam U Type of the destination values
+         * @param first Index of the first element in the data
+         * @param dest Destination of the elements
+         * @param policy What to do with values outside the range of U
+         * @throw std::runtime_error if the elements are out of the data
          */
-        template <class T>
-        T value_as(std::string_view key) const
+        template <class U>
+        void read_elements_as(std::size_t first, std::span<U> dest, overflow_policy policy = overflow_policy::saturate)
         {
-            auto it = headers_.find(std::string(key));
-            if (it == headers_.end())
+            const std::size_t total = get_NAXIS_product();
+            if (first > total || dest.size() > total - first)
             {
-                throw std::out_of_range("Header keyword not found");
+                throw std::runtime_error("Elements are out of the data");
             }
-
-            std::istringstream iss(it->second);
-            T value;
-            if (!(iss >> value))
+            if (dest.empty())
             {
-                throw std::runtime_error("Failed to convert value of " +
-                                         std::string(key));
+                return;
             }
 
-            return value;
+            const pixel_scaling scaling = get_scaling();
+            apply([&](auto image)
+                  {
+                using T = typename decltype(image)::value_type;
+
+                if constexpr (std::is_same_v<T, U>)
+                {
+                    if (scaling.is_identity())
+                    {
+                        parent_ifits_.device_.read_at(offset_ + first * sizeof(T), boost::asio::buffer(dest.data(), dest.size() * sizeof(T)));
+
+                        if constexpr (is_offset_unsigned_v<T>)
+                        {
+                            flip_sign_bits(dest.data(), dest.size());
+                        }
+                        return;
+                    }
+                }
+
+                std::vector<T> staging(dest.size());
+                parent_ifits_.device_.read_at(offset_ + first * sizeof(T), boost::asio::buffer(staging));
+
+                if constexpr (is_offset_unsigned_v<T>)
+                {
+                    flip_sign_bits(staging.data(), staging.size());
+                }
+
+                convert_pixels(staging.data(), dest.data(), staging.size(), scaling, policy); });
         }
 
         /**
-         * @brief Get the value of a header keyword (optional)
+         * @brief Read consecutive frames of a cube, transformed while they are converted
          *
-         * This function retrieves the value of the specified header keyword
-         * from the current HDU. If the header keyword is not found,
-         * std::nullopt is returned. Otherwise, the value is returned as the type
-         * T, which must be convertible from std::string.
+         * A frame is one index of the first (slowest) axis. The frames are
+         * read in chunks of the staging buffer of read_as that never span two
+         * frames; every chunk is scaled to double, passed to the transform and
+         * converted to U while it is in the cache, so the transform adds no
+         * pass over the frames in memory. When U is double the transform runs
+         * directly on @p dest.
          *
-         * @tparam T The type of the return value
-         * @param key The name of the header keyword
-         * @return The value of the header keyword, or std::nullopt if not found
+         * The transform is called as transform(values, frame, pixel), with
+         * values a std::span<double> to modify in place, frame the index of
+         * the frame in the cube and pixel the index of values[0] in the frame,
+         * e.g. a frame_calibration.
+         *
+         * @tparam U Type of the destination values
+         * @param first Index of the first frame
+         * @param count Number of frames
+         * @param dest Destination of the frames, in file order
+         * @param transform Transform of the physical values of the frames
+         * @param policy What to do with transformed values outside the range of U
+         * @throw std::runtime_error if there are less than two axes, the frames are out of bounds or dest is too small
+         * @throw The exceptions of the transform, e.g. of a frame_calibration of smaller frames
          */
-        template <class T>
-        std::optional<T> value_as_optional(std::string_view key) const
+        template <class U, class Transform>
+        void read_frames(std::size_t first, std::size_t count, std::span<U> dest, Transform &&transform,
+                         overflow_policy policy = overflow_policy::saturate)
         {
-            auto it = headers_.find(std::string(key));
-            if (it != headers_.end())
+            const auto shape = get_shape();
+            if (shape.size() < 2)
             {
-                std::istringstream iss(it->second);
-                T value;
-                if (!(iss >> value))
-                {
-                    throw std::runtime_error("Failed to convert value of " +
-                                             std::string(key));
-                }
-                return value;
+                throw std::runtime_error("Frames need at least two axes");
             }
-            return std::nullopt;
+            if (first > shape[0] || count > shape[0] - first)
+            {
+                throw std::runtime_error("Frames are out of bounds");
+            }
+
+            std::size_t frame_size = 1;
+            for (std::size_t axis = 1; axis < shape.size(); ++axis)
+            {
+                frame_size *= shape[axis];
+            }
+
+            const std::size_t total = count * frame_size;
+            if (dest.size() < total)
+            {
+                throw std::runtime_error("Destination is too small for the frames");
+            }
+            if (total == 0)
+            {
+                return;
+            }
+
+            const pixel_scaling scaling = get_scaling();
+
+            apply([&](auto image)
+                  {
+                using T = typename decltype(image)::value_type;
+
+                std::vector<T> staging(std::min(total, kConversionChunk));
+                std::vector<double> values(std::is_same_v<U, double> ? 0 : staging.size());
+
+                const std::uint64_t start = offset_ + first * frame_size * sizeof(T);
+
+                for (std::size_t done = 0; done < total;)
+                {
+                    const std::size_t pixel = done % frame_size;
+                    const std::size_t chunk = std::min(staging.size(), frame_size - pixel);
+
+                    parent_ifits_.device_.read_at(start + done * sizeof(T), boost::asio::buffer(staging.data(), chunk * sizeof(T)));
+
+                    if constexpr (is_offset_unsigned_v<T>)
+                    {
+                        flip_sign_bits(staging.data(), chunk);
+                    }
+
+                    double *physical = values.data();
+                    if constexpr (std::is_same_v<U, double>)
+                    {
+                        physical = dest.data() + done;
+                    }
+                    convert_pixels(staging.data(), physical, chunk, scaling);
+
+                    transform(std::span<double>(physical, chunk), first + done / frame_size, pixel);
+
+                    if constexpr (!std::is_same_v<U, double>)
+                    {
+                        convert_pixels(physical, dest.data() + done, chunk, pixel_scaling{}, policy);
+                    }
+
+                    done += chunk;
+                } });
         }
 
         /**
-         * @brief Apply a function to the current HDU, based on its BITPIX value
-         *
-         * This function applies the function @p f to the current HDU, using the
-         * appropriate specialization of image_hdu. The return value of @p f is
-         * returned by this function.
+         * @brief Get the shape of the image binned with the given bins
          *
-         * @tparam Functor The type of the function to apply
-         * @param f The function to apply
-         * @return The return value of @p f
+         * @param bins Bin sizes along the last two axes
+         * @return The shape, the leading axes are unchanged
+         * @throw std::runtime_error if there are less than two axes or a bin size is 0
          */
-        template <typename Functor>
-        auto apply(Functor f)
+        std::vector<std::size_t> get_binned_shape(const binning &bins) const
         {
-            switch (get_BITPIX())
+            auto shape = get_shape();
+            if (shape.size() < 2)
             {
-            case 8:
-                return f(image_hdu<std::uint8_t>(*this));
-            case 16:
-                return f(image_hdu<std::int16_t>(*this));
-            case 32:
-                return f(image_hdu<std::int32_t>(*this));
-            case 64:
-                return f(image_hdu<std::int64_t>(*this));
-            case -32:
-                return f(image_hdu<float>(*this));
-            case -64:
-                return f(image_hdu<double>(*this));
-            default:
-                throw std::runtime_error("Unsupported BITPIX value");
+                throw std::runtime_error("Binning needs at least two axes");
+            }
+            if (bins.rows == 0 || bins.columns == 0)
+            {
+                throw std::runtime_error("Bin sizes must be positive");
             }
+
+            shape[shape.size() - 2] = (shape[shape.size() - 2] + bins.rows - 1) / bins.rows;
+            shape[shape.size() - 1] = (shape[shape.size() - 1] + bins.columns - 1) / bins.columns;
+            return shape;
         }
 
         /**
-         * @brief Image HDU class
+         * @brief Read the image binned along its last two axes
          *
-         * This class represents an image HDU in a FITS file. The template parameter T specifies the type of the image
-         * data. The class provides functions to read and write image data at specific indices.
+         * The rows of one row of bins are read together, converted to double
+         * (with the scaling of read_as) and accumulated into the bins, so only
+         * bins.rows input rows per thread are held in memory. With several
+         * threads every thread reads a contiguous range of rows of bins. The
+         * bins are converted to U as by convert_pixels.
+         *
+         * @tparam U Type of the destination values
+         * @param bins Bin sizes, combination of the pixels and number of threads
+         * @param dest Destination of the binned image (see get_binned_shape), in file order
+         * @throw std::runtime_error if the bins are invalid or dest is too small
          */
-        template <class T>
-        class image_hdu
+        template <class U>
+        void read_binned(const binning &bins, std::span<U> dest)
         {
-        public:
-            /**
-             * @brief Constructor
-             *
-             * @param parent_hdu The parent HDU
-             */
-            image_hdu(hdu &parent_hdu)
-                : parent_hdu_(parent_hdu)
+            const auto shape = get_shape();
+            const auto binned = get_binned_shape(bins);
+            const std::size_t rank = shape.size();
+
+            const std::size_t height = shape[rank - 2], width = shape[rank - 1];
+            const std::size_t binned_height = binned[rank - 2], binned_width = binned[rank - 1];
+
+            std::size_t planes = 1;
+            for (std::size_t axis = 0; axis + 2 < rank; ++axis)
             {
+                planes *= shape[axis];
             }
 
-            /**
+            if (dest.size() < planes * binned_height * binned_width)
+            {
+                throw std::runtime_error("Destination is too small for the binned image");
+            }
+
+            // Bin the rows of bins [first, last) of all the planes
+            auto bin_rows = [&](std::size_t first, std::size_t last)
+            {
+                std::vector<double> rows(bins.rows * width);
+                std::vector<double> values(binned_width);
+                std::vector<std::size_t> counts(binned_width);
+
+                image_region region{std::vector<std::size_t>(rank, 0), std::vector<std::size_t>(rank, 1)};
+                region.count[rank - 1] = width;
+
+                for (std::size_t task = first; task < last; ++task)
+                {
+                    std::size_t plane = task / binned_height;
+                    for (std::size_t axis = rank - 2; axis-- > 0;)
+                    {
+                        region.start[axis] = plane % shape[axis];
+                        plane /= shape[axis];
+                    }
+
+                    const std::size_t y = (task % binned_height) * bins.rows;
+                    region.start[rank - 2] = y;
+                    region.count[rank - 2] = std::min(bins.rows, height - y);
+
+                    read_as(region, std::span(rows.data(), region.count[rank - 2] * width));
+
+                    std::fill(values.begin(), values.end(), 0.0);
+                    std::fill(counts.begin(), counts.end(), 0);
+
+                    for (std::size_t row = 0; row < region.count[rank - 2]; ++row)
+                    {
+                        const double *pixels = rows.data() + row * width;
+                        for (std::size_t bin = 0; bin < binned_width; ++bin)
+                        {
+                            const std::size_t end = std::min(width, (bin + 1) * bins.columns);
+
+                            double sum = 0.0;
+                            std::size_t count = 0;
+                            for (std::size_t x = bin * bins.columns; x < end; ++x)
+                            {
+                                const bool valid = pixels[x] == pixels[x]; // False for NaN
+                                sum += valid ? pixels[x] : 0.0;
+                                count += valid;
+                            }
+
+                            values[bin] += sum;
+                            counts[bin] += count;
+                        }
+                    }
+
+                    if (bins.mode == bin_mode::mean)
+                    {
+                        for (std::size_t bin = 0; bin < binned_width; ++bin)
+                        {
+                            values[bin] = counts[bin] ? values[bin] / static_cast<double>(counts[bin]) : std::numeric_limits<double>::quiet_NaN();
+                        }
+                    }
+
+                    convert_pixels(values.data(), dest.data() + task * binned_width, binned_width);
+                }
+            };
+
+            const std::size_t tasks = planes * binned_height;
+            const std::size_t threads = std::clamp<std::size_t>(bins.threads, 1, std::max<std::size_t>(tasks, 1));
+
+            if (threads == 1)
+            {
+                bin_rows(0, tasks);
+                return;
+            }
+
+            work_stealing_pool pool(threads);
+            for (std::size_t t = 0; t < threads; ++t)
+            {
+                pool.submit([&, t]
+                            { bin_rows(t * tasks / threads, (t + 1) * tasks / threads); });
+            }
+            pool.wait();
+        }
+
+        /**
+         * @brief Read a stratified sample of the pixels of the image
+         *
+         * The rows (the last axis, all the others flattened) are split into
+         * about sqrt(count) strata; the middle row of every stratum is sampled
+         * with kSampleSegments short reads spread along it, so the sample
+         * covers the whole image with a few hundred small reads instead of
+         * the full data. Adjacent segments are merged, and the reads are
+         * issued as one batch by kSampleThreads threads. Values are scaled as
+         * by read_as and non-finite ones are dropped.
+         *
+         * @param count Number of pixels to sample, the whole image if it is smaller
+         * @return The finite sampled values
+         */
+        std::vector<float> sample_pixels(std::size_t count)
+        {
+            const auto shape = get_shape();
+            const image_region whole = image_region::whole(shape);
+
+            std::vector<float> sample;
+            if (shape.empty() || whole.size() == 0 || count == 0)
+            {
+                return sample;
+            }
+
+            if (count >= whole.size())
+            {
+                sample.resize(whole.size());
+                read_as(whole, std::span(sample));
+            }
+            else
+            {
+                const std::size_t width = shape.back();
+                const std::size_t height = whole.size() / width;
+
+                const std::size_t rows = std::clamp<std::size_t>(static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(count)))), 1, height);
+                const std::size_t per_row = std::min(width, (count + rows - 1) / rows);
+                const std::size_t segments = std::min(per_row, kSampleSegments);
+                const std::size_t length = per_row / segments;
+
+                sample.resize(rows * segments * length);
+
+                // Runs of the sample in file order, adjacent segments merged
+                struct sample_run
+                {
+                    std::size_t first;    // Index of the first element in the data
+                    std::size_t length;   // Number of elements
+                    std::size_t position; // Index of the first element in the sample
+                };
+
+                std::vector<sample_run> runs;
+                std::size_t position = 0;
+                for (std::size_t r = 0; r < rows; ++r)
+                {
+                    // Middle row of the stratum along the flattened leading axes
+                    const std::size_t row = (2 * r + 1) * height / (2 * rows);
+
+                    for (std::size_t s = 0; s < segments; ++s)
+                    {
+                        const std::size_t middle = (2 * s + 1) * width / (2 * segments);
+                        const std::size_t first = row * width + std::min(middle - std::min(middle, length / 2), width - length);
+
+                        if (!runs.empty() && runs.back().first + runs.back().length == first)
+                        {
+                            runs.back().length += length;
+                        }
+                        else
+                        {
+                            runs.push_back({first, length, position});
+                        }
+                        position += length;
+                    }
+                }
+
+                // The runs are read concurrently, so that the storage sees a queue of requests instead of one at a time
+                const std::size_t threads = std::min(kSampleThreads, runs.size());
+                work_stealing_pool pool(threads);
+                for (std::size_t t = 0; t < threads; ++t)
+                {
+                    pool.submit([&, t]
+                                {
+                        for (std::size_t i = t * runs.size() / threads; i < (t + 1) * runs.size() / threads; ++i)
+                        {
+                            read_elements_as(runs[i].first, std::span(sample.data() + runs[i].position, runs[i].length));
+                        } });
+                }
+                pool.wait();
+            }
+
+            sample.erase(std::remove_if(sample.begin(), sample.end(), [](float value)
+                                        { return !std::isfinite(value); }),
+                         sample.end());
+            return sample;
+        }
+
+        /**
+         * @brief Estimate display limits with the zscale algorithm
+         *
+         * The algorithm of IRAF and astropy's ZScaleInterval, run on a sample
+         * read by sample_pixels.
+         *
+         * @param options Parameters of the algorithm and size of the sample
+         * @return The display limits
+         * @throw std::runtime_error if the image has no finite pixels
+         */
+        display_limits zscale(const zscale_options &options = {})
+        {
+            auto sample = sample_pixels(options.samples);
+            if (sample.empty())
+            {
+                throw std::runtime_error("No finite pixels to sample");
+            }
+            return zscale_limits(sample, options);
+        }
+
+        /**
+         * @brief Estimate display limits as two percentiles of the pixels
+         *
+         * The percentiles of a sample read by sample_pixels, found by
+         * selection, e.g. percentile_limits(0.5, 99.5) for a 99% interval.
+         *
+         * @param low Percentage of the pixels below the low limit, between 0 and 100
+         * @param high Percentage of the pixels below the high limit, between 0 and 100
+         * @param samples Number of pixels to sample
+         * @return The display limits
+         * @throw std::runtime_error if the image has no finite pixels
+         */
+        display_limits percentile_limits(double low, double high, std::size_t samples = kPercentileSamples)
+        {
+            auto sample = sample_pixels(samples);
+            if (sample.empty())
+            {
+                throw std::runtime_error("No finite pixels to sample");
+            }
+            return {sample_percentile(sample, low), sample_percentile(sample, high)};
+        }
+
+    private:
+        /**
+         * @brief Round up the offset to the nearest multiple of the size of the header block.
+         *
+         * @param offset The offset to be rounded
+         * @return The rounded offset
+         */
+        static std::size_t round_offset(const std::size_t &offset) noexcept
+        {
+            return (offset % kSizeHeaderBlock == 0) ? offset : (offset / kSizeHeaderBlock + 1) * kSizeHeaderBlock;
+        }
+
+        /**
+         * @brief Calculates the product of sizes of all axes of the current HDU
+         *
+         * The calculation is based on the values of keywords "NAXIS" and "NAXISi"
+         * for all i from 1 to the value of "NAXIS".
+         *
+         * @return The product of sizes of all axes of the current HDU
+         */
+        std::size_t get_NAXIS_product() const
+        {
+            // Get the number of axes
+            int NAXIS = get<kw::NAXIS>();
+
+            // Calculate the product of sizes of all axes (may exceed 2^31 for multi-GB data)
+            std::size_t product = 1;
+            for (int i = 1; i <= NAXIS; i++)
+            {
+                product *= get<kw::NAXISn>(i); // Get the size of the axis
+            }
+
+            return product;
+        }
+
+        /**
+         * @brief Get the number of bits per pixel for the current HDU
+         *
+         * This function retrieves the value of the "BITPIX" header keyword.
+         * The value is returned as an integer.
+         *
+         * @return Number of bits per pixel for the current HDU
+         */
+        int get_BITPIX() const
+        {
+            return get<kw::BITPIX>();
+        }
+
+        /**
+         * @brief 
+         * 
+         * @return header_container_t::const_iterator 
+         */
+        header_container_t::const_iterator cbegin() const
+        {
+            return headers_.cbegin();
+        }
+
+        /**
+         * @brief 
+         * 
+         * @return header_container_t::const_iterator 
+         */
+        header_container_t::const_iterator begin() const
+        {
+            return headers_.begin();
+        }
+
+        /**
+         * @brief 
+         * 
+         * @return header_container_t::const_iterator 
+         */
+        header_container_t::const_iterator cend() const
+        {
+            return headers_.cend();
+        }
+
+        /**
+         * @brief 
+         * 
+         * @return header_container_t::const_iterator 
+         */
+        header_container_t::const_iterator end() const
+        {
+            return headers_.end();
+        }
+
+    public:
+        /**
+         * @brief Get the headers object
+         * 
+         * @return const header_container_t& 
+         */
+        const header_container_t &get_headers() const noexcept
+        {
+            return headers_;
+        }
+
+        /**
+         * @brief Get the memory held by the HDU
+         *
+         * Counts the header keywords and values with their hash nodes, the
+         * bucket array of the header and the HDU object itself.
+         *
+         * @return memory_usage of the HDU
+         */
+        memory_usage get_memory_usage() const noexcept
+        {
+            // Node of the hash map: next pointer, key/value pair and cached hash
+            constexpr std::size_t kNodeSize = sizeof(void *) + sizeof(header_container_t::value_type) + sizeof(std::size_t);
+
+            memory_usage usage;
+
+            for (const auto &[key, value] : headers_)
+            {
+                usage.headers += memory_usage::heap_block(kNodeSize) + memory_usage::heap_bytes(key) + memory_usage::heap_bytes(value);
+            }
+
+            usage.index = memory_usage::heap_block(headers_.bucket_count() * sizeof(void *)) + memory_usage::heap_block(keywords_.heap_bytes()) +
+                          memory_usage::heap_bytes(cards_);
+            usage.objects = sizeof(hdu);
+
+            return usage;
+        }
+
+        /**
+         * @brief Get the value of a header keyword
+         *
+         * This function retrieves the value of the specified header keyword
+         * from the current HDU. The value is returned as the type T,
+         * which must be convertible from std::string.
+         *
+         * @tparam T The type of the return value
+         * @param key The name of the header keyword
+         * @return The value of the header keyword
+         */
+        template <class T>
+        T value_as(std::string_view key) const
+        {
+            auto it = headers_.find(std::string(key));
+            if (it == headers_.end())
+            {
+                throw std::out_of_range("Header keyword not found");
+            }
+
+            std::istringstream iss(it->second);
+            T value;
+            if (!(iss >> value))
+            {
+                throw std::runtime_error("Failed to convert value of " +
+                                         std::string(key));
+            }
+
+            return value;
+        }
+
+        /**
+         * @brief Get the value of a reserved header keyword
+         *
+         * The keyword handle selects the value without hashing, e.g.
+         * get<kw::EXPTIME>() returns a double.
+         *
+         * @tparam Keyword Handle of the keyword (see namespace kw)
+         * @return The value of the header keyword
+         */
+        template <class Keyword>
+        typename Keyword::value_type get() const
+        {
+            static_assert(!is_indexed_keyword_v<Keyword>, "Indexed keywords take their index, e.g. get<kw::NAXISn>(1)");
+
+            const std::string *value = keywords_.find(Keyword::slot);
+            if (!value)
+            {
+                throw std::out_of_range(std::string(Keyword::name) + " not found");
+            }
+            return keyword_value<typename Keyword::value_type>(*value, Keyword::name);
+        }
+
+        /**
+         * @brief Get the value of a reserved indexed header keyword
+         *
+         * For example get<kw::NAXISn>(2) returns NAXIS2 as a std::size_t.
+         *
+         * @tparam Keyword Handle of the keyword family (see namespace kw)
+         * @param n Index of the keyword, starting at 1
+         * @return The value of the header keyword
+         */
+        template <class Keyword>
+        typename Keyword::value_type get(std::size_t n) const
+        {
+            static_assert(is_indexed_keyword_v<Keyword>, "Only indexed keywords take an index");
+
+            const std::string *value = keywords_.find(Keyword::family, n);
+            if (!value)
+            {
+                throw std::out_of_range(std::string(Keyword::name) + std::to_string(n) + " not found");
+            }
+            return keyword_value<typename Keyword::value_type>(*value, Keyword::name);
+        }
+
+        /**
+         * @brief Get the value of a reserved header keyword (optional)
+         *
+         * @tparam Keyword Handle of the keyword (see namespace kw)
+         * @return The value of the header keyword, or std::nullopt if not found
+         */
+        template <class Keyword>
+        std::optional<typename Keyword::value_type> get_optional() const
+        {
+            static_assert(!is_indexed_keyword_v<Keyword>, "Indexed keywords take their index");
+
+            const std::string *value = keywords_.find(Keyword::slot);
+            if (!value)
+            {
+                return std::nullopt;
+            }
+            return keyword_value<typename Keyword::value_type>(*value, Keyword::name);
+        }
+
+        /**
+         * @brief Get the value of a header keyword (optional)
+         *
+         * This function retrieves the value of the specified header keyword
+         * from the current HDU. If the header keyword is not found,
+         * std::nullopt is returned. Otherwise, the value is returned as the type
+         * T, which must be convertible from std::string.
+         *
+         * @tparam T The type of the return value
+         * @param key The name of the header keyword
+         * @return The value of the header keyword, or std::nullopt if not found
+         */
+        template <class T>
+        std::optional<T> value_as_optional(std::string_view key) const
+        {
+            auto it = headers_.find(std::string(key));
+            if (it != headers_.end())
+            {
+                std::istringstream iss(it->second);
+                T value;
+                if (!(iss >> value))
+                {
+                    throw std::runtime_error("Failed to convert value of " +
+                                             std::string(key));
+                }
+                return value;
+            }
+            return std::nullopt;
+        }
+
+        /**
+         * @brief Apply a function to the current HDU, based on its BITPIX value
+         *
+         * This function applies the function @p f to the current HDU, using the
+         * appropriate specialization of image_hdu. Images following the unsigned
+         * integer convention (see is_unsigned) use image_hdu<std::uint16_t>,
+         * image_hdu<std::uint32_t> or image_hdu<std::uint64_t>. The return value
+         * of @p f is returned by this function.
+         *
+         * @tparam Functor The type of the function to apply
+         * @param f The function to apply
+         * @return The return value of @p f
+         */
+        template <typename Functor>
+        auto apply(Functor f)
+        {
+            switch (get_BITPIX())
+            {
+            case 8:
+                return f(image_hdu<std::uint8_t>(*this));
+            case 16:
+                return is_unsigned() ? f(image_hdu<std::uint16_t>(*this)) : f(image_hdu<std::int16_t>(*this));
+            case 32:
+                return is_unsigned() ? f(image_hdu<std::uint32_t>(*this)) : f(image_hdu<std::int32_t>(*this));
+            case 64:
+                return is_unsigned() ? f(image_hdu<std::uint64_t>(*this)) : f(image_hdu<std::int64_t>(*this));
+            case -32:
+                return f(image_hdu<float>(*this));
+            case -64:
+                return f(image_hdu<double>(*this));
+            default:
+                throw std::runtime_error("Unsupported BITPIX value");
+            }
+        }
+
+        /**
+         * @brief Image HDU class
+         *
+         * This class represents an image HDU in a FITS file. The template parameter T specifies the type of the image
+         * data. The class provides functions to read and write image data at specific indices. For uint16_t, uint32_t
+         * and uint64_t the stored signed values are converted to unsigned ones as they are read.
+         */
+        template <class T>
+        class image_hdu
+        {
+        public:
+            using value_type = T; // Type of the stored values
+
+            /**
+             * @brief Constructor
+             *
+             * @param parent_hdu The parent HDU
+             */
+            image_hdu(hdu &parent_hdu)
+                : parent_hdu_(parent_hdu)
+            {
+            }
+
+            /**
              * @brief Asynchronously read image data at a specific index
              *
              * This function asynchronously reads image data from a specific index.
@@ -531,10 +1301,35 @@ public:
                     throw std::runtime_error("Index is out of bounds");
                 }
 
-                return boost::asio::async_read_at(parent_hdu_.parent_ifits_.file_, // Read from the file
-                                                  parent_hdu_.offset_ + offset,    // Starting from the offset
-                                                  buffers,                         // Into these buffers
-                                                  std::forward<ReadToken>(token)); // With this token
+                return async_read_stored(parent_hdu_.parent_ifits_, parent_hdu_.offset_ + offset, // Starting from the offset
+                                         buffers,                                                 // Into these buffers
+                                         std::forward<ReadToken>(token));                         // With this token
+            }
+
+            /**
+             * @brief Asynchronously read image data at a specific index and accumulate its statistics
+             *
+             * Same as async_read_data(index, buffers, token); the values read are
+             * added to @p statistics before the completion handler is called.
+             *
+             * @param index The initial position for reading data
+             * @param buffers A sequence of buffers holding whole values of type T
+             * @param statistics Statistics to accumulate into, must stay valid until completion
+             * @param token A token for the asynchronous operation
+             */
+            template <class MutableBufferSequence, class ReadToken>
+            auto async_read_data(const std::initializer_list<std::size_t> &index, const MutableBufferSequence &buffers,
+                                 image_statistics &statistics, ReadToken &&token)
+            {
+                std::size_t offset = sizeof(T) * parent_hdu_.calculate_offset(index);
+
+                if (offset > parent_hdu_.calculate_data_block_size() + parent_hdu_.offset_)
+                {
+                    throw std::runtime_error("Index is out of bounds");
+                }
+
+                return async_read_stored(parent_hdu_.parent_ifits_, parent_hdu_.offset_ + offset, buffers, std::forward<ReadToken>(token),
+                                         &statistics, get_blank());
             }
 
             /**
@@ -558,19 +1353,475 @@ public:
                     throw std::runtime_error("Index is out of bounds");
                 }
 
-                return boost::asio::read_at(parent_hdu_.parent_ifits_.file_, // Read from the file
-                                            parent_hdu_.offset_ + offset,    // Starting from the offset
-                                            buffers);                        // Into these buffers
+                return read_stored(parent_hdu_.parent_ifits_, parent_hdu_.offset_ + offset, // Starting from the offset
+                                   buffers);                                                // Into these buffers
+            }
+
+            /**
+             * @brief Synchronously read image data at a specific index and accumulate its statistics
+             *
+             * The values read are added to @p statistics in the same pass as the
+             * conversion of unsigned values. NaN and, for integers, the BLANK
+             * value of the header are counted as invalid. To read from several
+             * threads, give every thread its own statistics and merge them.
+             *
+             * @param index The initial position for reading data
+             * @param buffers A sequence of buffers holding whole values of type T
+             * @param statistics Statistics to accumulate into
+             * @return The number of bytes read
+             */
+            template <class MutableBufferSequence>
+            std::size_t read_data(std::initializer_list<std::size_t> index, const MutableBufferSequence &buffers,
+                                  image_statistics &statistics)
+            {
+                std::size_t offset = sizeof(T) * parent_hdu_.calculate_offset(index);
+
+                if (offset > parent_hdu_.calculate_data_block_size() + parent_hdu_.offset_)
+                {
+                    throw std::runtime_error("Index is out of bounds");
+                }
+
+                return read_stored(parent_hdu_.parent_ifits_, parent_hdu_.offset_ + offset, buffers, &statistics, get_blank());
+            }
+
+            /**
+             * @brief Read the image binned along its last two axes
+             *
+             * Same as hdu::read_binned.
+             *
+             * @param bins Bin sizes, combination of the pixels and number of threads
+             * @param dest Destination of the binned image, in file order
+             */
+            template <class U>
+            void read_binned(const binning &bins, std::span<U> dest)
+            {
+                parent_hdu_.read_binned(bins, dest);
+            }
+
+            /**
+             * @brief Read consecutive frames of a cube, transformed while they are converted
+             *
+             * Same as hdu::read_frames.
+             *
+             * @param first Index of the first frame
+             * @param count Number of frames
+             * @param dest Destination of the frames, in file order
+             * @param transform Transform of the physical values of the frames, e.g. a frame_calibration
+             * @param policy What to do with transformed values outside the range of U
+             */
+            template <class U, class Transform>
+            void read_frames(std::size_t first, std::size_t count, std::span<U> dest, Transform &&transform,
+                             overflow_policy policy = overflow_policy::saturate)
+            {
+                parent_hdu_.read_frames(first, count, dest, std::forward<Transform>(transform), policy);
+            }
+
+            /**
+             * @brief Read every k-th element of a region along every axis
+             *
+             * Samples elements start, start + step, start + 2 * step, ... of the
+             * region along every axis, e.g. every 8th pixel of every 8th row for
+             * a 1/64 quick look. The samples are read in the order of the file
+             * and grouped into spans: a gap of at most @p max_gap bytes between
+             * two samples is read through and the samples are gathered from the
+             * span, a larger gap ends the span, so sparse samples are read one
+             * by one and dense samples with large reads. Rows with a step of 1
+             * are contiguous runs, read directly into @p dest when they exceed a
+             * span.
+             *
+             * @param region Region of the image to sample
+             * @param steps Step along every axis, slowest first, at least 1
+             * @param dest Destination of the samples, (count + step - 1) / step
+             * per axis, in file order
+             * @param max_gap Largest gap between two samples read through, in bytes
+             * @throw std::runtime_error if the region is out of bounds, a step is 0 or dest is too small
+             */
+            void read_decimated(const image_region &region, const std::vector<std::size_t> &steps, std::span<T> dest,
+                                std::size_t max_gap = kDecimationGap)
+            {
+                const auto shape = parent_hdu_.get_shape();
+                const std::size_t rank = shape.size();
+
+                if (region.start.size() != rank || region.count.size() != rank || steps.size() != rank)
+                {
+                    throw std::runtime_error("Region rank does not match NAXIS");
+                }
+
+                std::vector<std::size_t> samples(rank), strides(rank, 1);
+                std::size_t total = 1;
+                for (std::size_t axis = 0; axis < rank; ++axis)
+                {
+                    if (region.start[axis] > shape[axis] || region.count[axis] > shape[axis] - region.start[axis])
+                    {
+                        throw std::runtime_error("Region is out of bounds");
+                    }
+                    if (steps[axis] == 0)
+                    {
+                        throw std::runtime_error("Steps must be positive");
+                    }
+                    samples[axis] = (region.count[axis] + steps[axis] - 1) / steps[axis];
+                    total *= samples[axis];
+                }
+                for (std::size_t axis = rank; axis-- > 1;)
+                {
+                    strides[axis - 1] = strides[axis] * shape[axis];
+                }
+
+                if (dest.size() < total)
+                {
+                    throw std::runtime_error("Destination is too small for the samples");
+                }
+                if (total == 0)
+                {
+                    return;
+                }
+
+                // Samples of the current span: position of the first one in the span, number and stride
+                struct piece
+                {
+                    std::size_t first;
+                    std::size_t count;
+                    std::size_t stride;
+                };
+                std::vector<piece> pieces;
+                std::vector<T> staging;
+                std::size_t span_first = 0, span_end = 0; // Elements [span_first, span_end) of the span
+                std::size_t written = 0;                  // Samples already in dest
+
+                const std::uint64_t data_offset = parent_hdu_.offset_;
+
+                // Read the span and gather its samples
+                auto flush = [&]
+                {
+                    if (pieces.empty())
+                    {
+                        return;
+                    }
+
+                    staging.resize(span_end - span_first);
+                    read_stored(parent_hdu_.parent_ifits_, data_offset + span_first * sizeof(T), boost::asio::buffer(staging));
+
+                    for (const auto &p : pieces)
+                    {
+                        const T *source = staging.data() + p.first;
+                        T *out = dest.data() + written;
+                        if (p.stride == 1)
+                        {
+                            std::memcpy(out, source, p.count * sizeof(T));
+                        }
+                        else
+                        {
+                            for (std::size_t i = 0; i < p.count; ++i)
+                            {
+                                out[i] = source[i * p.stride];
+                            }
+                        }
+                        written += p.count;
+                    }
+                    pieces.clear();
+                };
+
+                // Add count samples with the given stride, from the element offset
+                auto add = [&](std::size_t offset, std::size_t count, std::size_t stride)
+                {
+                    const std::size_t extent = (count - 1) * stride + 1;
+
+                    if (!pieces.empty() && ((offset - span_end) * sizeof(T) > max_gap || offset + extent - span_first > kDecimationSpan))
+                    {
+                        flush();
+                    }
+
+                    if (pieces.empty())
+                    {
+                        if (stride == 1 && extent > kDecimationSpan)
+                        {
+                            read_stored(parent_hdu_.parent_ifits_, data_offset + offset * sizeof(T),
+                                        boost::asio::buffer(dest.data() + written, count * sizeof(T)));
+                            written += count;
+                            return;
+                        }
+                        span_first = offset;
+                    }
+
+                    pieces.push_back({offset - span_first, count, stride});
+                    span_end = offset + extent;
+                };
+
+                const std::size_t last = rank - 1;
+                const std::size_t step = steps[last];
+
+                // Samples of the last axis per piece, so that a piece fits in a span
+                const std::size_t per_piece = step == 1 ? samples[last]
+                                              : step * sizeof(T) > max_gap ? 1
+                                                                           : std::max<std::size_t>(1, (kDecimationSpan - 1) / step + 1);
+
+                std::vector<std::size_t> index(rank, 0);
+                while (true)
+                {
+                    std::size_t row = 0;
+                    for (std::size_t axis = 0; axis < last; ++axis)
+                    {
+                        row += (region.start[axis] + index[axis] * steps[axis]) * strides[axis];
+                    }
+
+                    for (std::size_t sample = 0; sample < samples[last]; sample += per_piece)
+                    {
+                        add(row + region.start[last] + sample * step, std::min(per_piece, samples[last] - sample), step);
+                    }
+
+                    // Next row, the last of the other axes fastest
+                    std::size_t axis = last;
+                    while (axis > 0 && ++index[axis - 1] == samples[axis - 1])
+                    {
+                        index[--axis] = 0;
+                    }
+                    if (axis == 0)
+                    {
+                        break;
+                    }
+                }
+
+                flush();
+            }
+
+            /**
+             * @brief Get the value of undefined pixels
+             *
+             * @return BLANK as a value of type T, std::nullopt for floating point
+             * images and when BLANK is absent
+             */
+            std::optional<T> get_blank() const
+            {
+                if constexpr (std::is_integral_v<T>)
+                {
+                    const auto blank = parent_hdu_.template get_optional<kw::BLANK>();
+                    if (blank)
+                    {
+                        // BLANK is a stored value, unsigned values differ by the sign bit
+                        T value = static_cast<T>(*blank);
+                        if constexpr (is_offset_unsigned_v<T>)
+                        {
+                            flip_sign_bits(&value, 1);
+                        }
+                        return value;
+                    }
+                }
+                return std::nullopt;
+            }
+
+            /**
+             * @brief View of the image with a shape known at compile time
+             *
+             * Index-to-offset conversion uses the constant strides of the shape
+             * instead of looking up NAXISn. Created with static_view().
+             *
+             * @tparam Extents Number of elements along every axis, slowest first
+             */
+            template <std::size_t... Extents>
+            class static_image_view
+            {
+            public:
+                using extents_type = static_extents<Extents...>;
+                using index_type = typename extents_type::index_type;
+
+                /**
+                 * @brief Offset of an element from the start of the data block, in bytes.
+                 */
+                static constexpr std::size_t byte_offset(const index_type &index) noexcept
+                {
+                    return extents_type::offset(index) * sizeof(T);
+                }
+
+                /**
+                 * @brief Read data starting at the given index
+                 *
+                 * @param index Index of the first element to read, slowest axis first
+                 * @param buffers Buffer sequence to read into
+                 * @return Number of bytes read
+                 */
+                template <class MutableBufferSequence>
+                std::size_t read_data(const index_type &index, const MutableBufferSequence &buffers) const
+                {
+                    return read_stored(hdu_.parent_ifits_, checked_offset(index, boost::asio::buffer_size(buffers)), buffers);
+                }
+
+                /**
+                 * @brief Read one element
+                 *
+                 * @param index Index of the element, slowest axis first
+                 * @return Value of the element
+                 */
+                T read_pixel(const index_type &index) const
+                {
+                    T value;
+                    read_data(index, boost::asio::buffer(&value, sizeof(T)));
+                    return value;
+                }
+
+                /**
+                 * @brief Asynchronously read data starting at the given index
+                 *
+                 * @param index Index of the first element to read, slowest axis first
+                 * @param buffers Buffer sequence to read into, must stay valid until completion
+                 * @param token A token for the asynchronous operation
+                 */
+                template <class MutableBufferSequence, class ReadToken>
+                auto async_read_data(const index_type &index, const MutableBufferSequence &buffers, ReadToken &&token) const
+                {
+                    return async_read_stored(hdu_.parent_ifits_, checked_offset(index, boost::asio::buffer_size(buffers)), buffers,
+                                             std::forward<ReadToken>(token));
+                }
+
+            private:
+                friend class image_hdu;
+
+                explicit static_image_view(const hdu &hdu)
+                    : hdu_(hdu)
+                {
+                }
+
+                /**
+                 * @brief Offset in the file of a read of the given size at the given index.
+                 */
+                std::size_t checked_offset(const index_type &index, std::size_t size) const
+                {
+                    const std::size_t offset = extents_type::checked_offset(index) * sizeof(T);
+
+                    if (size > extents_type::size * sizeof(T) - offset)
+                    {
+                        throw std::runtime_error("Index is out of bounds");
+                    }
+
+                    return hdu_.offset_ + offset;
+                }
+
+                const hdu &hdu_; // The viewed HDU
+            };
+
+            /**
+             * @brief Get a view of the image with a shape known at compile time
+             *
+             * @tparam Extents Number of elements along every axis, slowest first.
+             * Must match NAXISn of the HDU.
+             * @return The view, valid as long as the ifits object
+             * @throw std::runtime_error if the extents differ from the shape of the HDU
+             */
+            template <std::size_t... Extents>
+            static_image_view<Extents...> static_view() const
+            {
+                constexpr std::array<std::size_t, sizeof...(Extents)> extents{Extents...};
+
+                if (parent_hdu_.get_NAXIS() != static_cast<int>(extents.size()))
+                {
+                    throw std::runtime_error("Static extents do not match NAXIS");
+                }
+
+                for (std::size_t axis = 0; axis < extents.size(); ++axis)
+                {
+                    if (parent_hdu_.template get<kw::NAXISn>(axis + 1) != extents[axis])
+                    {
+                        throw std::runtime_error("Static extents do not match NAXIS" + std::to_string(axis + 1));
+                    }
+                }
+
+                return static_image_view<Extents...>(parent_hdu_);
             }
 
         private:
+            /**
+             * @brief Default largest gap between samples read through by read_decimated, in bytes.
+             *
+             * Reading 32 KiB costs about as much as one more read on disks and SSDs.
+             */
+            static constexpr std::size_t kDecimationGap = 32768;
+
+            /**
+             * @brief Largest span read by read_decimated, in elements.
+             */
+            static constexpr std::size_t kDecimationSpan = 65536;
+
+            /**
+             * @brief Read stored values at an offset in the file and convert them to T
+             *
+             * @param statistics Statistics to accumulate the values read into, may be nullptr
+             * @param blank Value of undefined integers
+             */
+            template <class MutableBufferSequence>
+            static std::size_t read_stored(ifits &file, std::uint64_t offset, const MutableBufferSequence &buffers,
+                                           image_statistics *statistics = nullptr, std::optional<T> blank = std::nullopt)
+            {
+                const std::size_t bytes = file.device_.read_at(offset, buffers);
+
+                finish_read(buffers, bytes, statistics, blank);
+
+                return bytes;
+            }
+
+            /**
+             * @brief Asynchronously read stored values at an offset in the file and convert them to T
+             */
+            template <class MutableBufferSequence, class ReadToken>
+            static auto async_read_stored(ifits &file, std::uint64_t offset, const MutableBufferSequence &buffers, ReadToken &&token)
+            {
+                if constexpr (!is_offset_unsigned_v<T>)
+                {
+                    return file.device_.async_read_at(offset, buffers, std::forward<ReadToken>(token));
+                }
+                else
+                {
+                    return async_read_stored(file, offset, buffers, std::forward<ReadToken>(token), nullptr, std::nullopt);
+                }
+            }
+
+            /**
+             * @brief Asynchronously read stored values at an offset in the file, convert them to T and accumulate their statistics
+             *
+             * @param statistics Statistics to accumulate the values read into, may be nullptr
+             * @param blank Value of undefined integers
+             */
+            template <class MutableBufferSequence, class ReadToken>
+            static auto async_read_stored(ifits &file, std::uint64_t offset, const MutableBufferSequence &buffers, ReadToken &&token,
+                                          image_statistics *statistics, std::optional<T> blank)
+            {
+                return boost::asio::async_initiate<ReadToken, void(boost::system::error_code, std::size_t)>(
+                    [&file, statistics, blank](auto handler, std::uint64_t offset, const MutableBufferSequence &buffers)
+                    {
+                        auto executor = boost::asio::get_associated_executor(handler, file.device_.get_executor());
+                        file.device_.async_read_at(offset, buffers,
+                                                   boost::asio::bind_executor(executor, [buffers, statistics, blank, handler = std::move(handler)](const boost::system::error_code &ec, std::size_t bytes) mutable
+                                                                              {
+                                                                                  finish_read(buffers, bytes, statistics, blank);
+                                                                                  std::move(handler)(ec, bytes); }));
+                    },
+                    token, offset, buffers);
+            }
+
+            /**
+             * @brief Convert the stored values read to T and accumulate their statistics
+             */
+            template <class MutableBufferSequence>
+            static void finish_read(const MutableBufferSequence &buffers, std::size_t bytes, image_statistics *statistics, std::optional<T> blank)
+            {
+                if constexpr (is_offset_unsigned_v<T>)
+                {
+                    flip_sign_bits<T>(buffers, bytes);
+                }
+
+                if (statistics)
+                {
+                    statistics->accumulate_buffers<T>(buffers, bytes, blank);
+                }
+            }
+
             hdu &parent_hdu_; // The parent HDU
         };
 
     private:
-        ifits &parent_ifits_;        // The parent IFITS object
-        header_container_t headers_; // The HDU headers
-        std::uint64_t offset_;       // The current HDU's offset
+        ifits &parent_ifits_;                                       // The parent IFITS object
+        header_container_t headers_;                                // The HDU headers
+        std::vector<const header_container_t::value_type *> cards_; // Cards of headers_, in file order
+        std::uint64_t offset_;                                      // The current HDU's offset
+        keyword_index keywords_;                                    // Values of the reserved keywords in headers_
     };
 
 public:
@@ -593,6 +1844,22 @@ public:
         return *it;
     }
 
+    /**
+     * @brief Get the hdu object by an index known at run time
+     *
+     * @param index Index of the HDU in the file
+     * @return hdu&
+     */
+    hdu &get_hdu(std::size_t index)
+    {
+        if (index >= hdus_.size())
+        {
+            throw std::out_of_range("Index out of bounds");
+        }
+
+        return *std::next(hdus_.begin(), index);
+    }
+
     /**
      * @brief 
      * 
@@ -643,8 +1910,51 @@ public:
         return hdus_;
     }
 
+    /**
+     * @brief Get the metrics passed to the constructor
+     *
+     * Call io_metrics::snapshot() on the result to get the current values.
+     *
+     * @return The metrics, nullptr if recording is disabled
+     */
+    const std::shared_ptr<io_metrics> &get_metrics() const noexcept
+    {
+        return metrics_;
+    }
+
+    /**
+     * @brief Get the memory held by the ifits object
+     *
+     * Sum of the memory of all the HDUs, the nodes of the HDU list, the
+     * lookup structures of the device and the ifits object itself. The
+     * shared metrics and the internal state of the I/O context and of the
+     * operating system are not included.
+     *
+     * @return memory_usage of the ifits object
+     */
+    memory_usage get_memory_usage() const noexcept
+    {
+        // Node of the list: two pointers and the HDU
+        constexpr std::size_t kNodeSize = 2 * sizeof(void *) + sizeof(hdu);
+
+        memory_usage usage;
+
+        for (const auto &current : hdus_)
+        {
+            usage += current.get_memory_usage();
+            usage.objects += memory_usage::heap_block(kNodeSize) - sizeof(hdu);
+        }
+
+        usage.index += device_.heap_bytes();
+        usage.objects += sizeof(ifits);
+
+        return usage;
+    }
+
 private:
-    boost::asio::io_context io_context_;   // IO context to use for asynchronous operations
-    boost::asio::random_access_file file_; // The FITS file
-    std::list<hdu> hdus_;                  // The list of HDUs
+    boost::asio::io_context io_context_;                  // IO context to use for asynchronous operations
+    boost::asio::random_access_file file_;                // The FITS file
+    std::shared_ptr<io_metrics> metrics_;                 // Optional I/O metrics
+    file_device<boost::asio::random_access_file> device_; // Device through which the file is accessed
+    std::list<hdu> hdus_;                                 // The list of HDUs
 };
@@ -9,6 +9,8 @@
  *
  */
 
+#pragma once
+
 // STL
 #include <string>
 #include <tuple>
@@ -20,11 +22,26 @@
 #include <filesystem>
 #include <numeric>
 #include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <mutex>
 
 // Boost
 #include <boost/asio.hpp>
 #include <boost/asio/write_at.hpp>
 
+#include "details/metrics.hpp"        // io_metrics
+#include "details/hooks.hpp"          // io_hook
+#include "details/file_device.hpp"    // file_device, io_schedule
+#include "details/probes.hpp"         // LIB_FITS_PROBE*
+#include "details/static_extents.hpp" // static_extents
+#include "details/convert.hpp"        // convert_pixels, pixel_scaling, overflow_policy
+#include "details/statistics.hpp"     // image_statistics
+
 #if !defined(BOOST_ASIO_HAS_FILE)
 #error "BOOST_ASIO_HAS_FILE not defined"
 #endif
@@ -50,19 +67,47 @@ public:
      * @param filename Path to the file to create and write
      * @param schema Schema for HDUs. Each element of the array specifies the size of
      * the corresponding HDU.
+     * @param header_blocks Number of 2880-byte header blocks reserved for each HDU.
+     * Each block holds 36 header keywords, including END.
+     * @param metrics Optional metrics recording the I/O of this file (see io_metrics)
+     * @param hook Optional hook called after every physical I/O and header flush (see io_hook)
+     * @param schedule Optional scheduler of the asynchronous writes (see io_scheduler)
      */
-    ofits(const std::filesystem::path &filename, std::array<std::initializer_list<std::size_t>, sizeof...(Args)> schema)
+    ofits(const std::filesystem::path &filename, std::array<std::initializer_list<std::size_t>, sizeof...(Args)> schema, std::size_t header_blocks = 1,
+          std::shared_ptr<io_metrics> metrics = nullptr, io_hook hook = {}, io_schedule schedule = {})
         : io_context_(),
           file_(io_context_.get_executor(), filename.string(), boost::asio::random_access_file::write_only | boost::asio::random_access_file::create),
-          hdus_{make_hdu_tuple(*this, schema)}
+          metrics_(std::move(metrics)),
+          device_(file_, metrics_.get(), std::move(hook), std::move(schedule)),
+          hdus_{make_hdu_tuple(*this, schema, header_blocks)}
+    {
+    }
+
+    /**
+     * @brief Destructor
+     *
+     * Writes DATAMIN and DATAMAX of the HDUs tracking statistics (see
+     * track_statistics). Errors are ignored, call write_statistics() first
+     * to get them.
+     */
+    ~ofits()
     {
+        try
+        {
+            write_statistics();
+        }
+        catch (const std::exception &)
+        {
+        }
     }
 
     /**
      * @brief Run the I/O context.
      *
      * This function runs the I/O context until it is stopped. The function is
-     * usually called after all HDUs are written to the file.
+     * usually called after all HDUs are written to the file. Once run() has
+     * returned, call restart() before issuing and running another batch of
+     * writes.
      */
     void run() noexcept
     {
@@ -70,6 +115,18 @@ public:
         io_context_.run();
     }
 
+    /**
+     * @brief Restart the I/O context.
+     *
+     * This function prepares the I/O context for another run() after a
+     * previous run() has returned, because it ran out of work or stop() was
+     * called.
+     */
+    void restart() noexcept
+    {
+        io_context_.restart();
+    }
+
     /**
      * @brief Stop the I/O context.
      *
@@ -162,6 +219,94 @@ public:
         return std::get<N>(hdus_).async_write_data(index, buffers, std::forward<WriteToken>(token));
     }
 
+    /**
+     * @brief Write data of another type to a given HDU
+     *
+     * The values are converted to the type of the HDU with its scaling (see
+     * set_scaling), e.g. float frames into an int16 HDU.
+     *
+     * @tparam N Index of the HDU in the tuple of HDUs
+     * @param index The initial position for writing data
+     * @param source Values to write
+     * @param policy What to do with values outside the range of the HDU type
+     *
+     * @return Number of bytes written
+     */
+    template <std::size_t N, class S, std::size_t Extent>
+    std::size_t write_data(const std::initializer_list<std::size_t> &index,
+                           std::span<S, Extent> source,
+                           overflow_policy policy = overflow_policy::saturate)
+    {
+        return std::get<N>(hdus_).write_data(index, source, policy);
+    }
+
+    /**
+     * @brief Set the scaling of the stored values of a given HDU
+     *
+     * Writes BSCALE and BZERO to the header of the HDU.
+     *
+     * @tparam N Index of the HDU in the tuple of HDUs
+     * @param scaling Scaling of the stored values: physical = bzero + bscale * stored
+     */
+    template <std::size_t N>
+    void set_scaling(const pixel_scaling &scaling)
+    {
+        std::get<N>(hdus_).set_scaling(scaling);
+    }
+
+    /**
+     * @brief Accumulate the statistics of the data written to a given HDU
+     *
+     * Reserves DATAMIN and DATAMAX in the header of the HDU, their values are
+     * written by write_statistics() and by the destructor.
+     *
+     * @tparam N Index of the HDU in the tuple of HDUs
+     */
+    template <std::size_t N>
+    void track_statistics()
+    {
+        std::get<N>(hdus_).track_statistics();
+    }
+
+    /**
+     * @brief Get the statistics of the data written to a given HDU so far
+     *
+     * @tparam N Index of the HDU in the tuple of HDUs
+     * @return Statistics of the stored values, empty unless track_statistics was called
+     */
+    template <std::size_t N>
+    image_statistics get_statistics() const
+    {
+        return std::get<N>(hdus_).get_statistics();
+    }
+
+    /**
+     * @brief Write DATAMIN and DATAMAX of all the HDUs tracking statistics
+     */
+    void write_statistics() const
+    {
+        std::apply([](const auto &...hdus)
+                   { (hdus.write_statistics(), ...); },
+                   hdus_);
+    }
+
+    /**
+     * @brief Get a view of an image HDU with a shape known at compile time
+     *
+     * With the shape as template parameters, the index of every element is
+     * converted to an offset with constant strides, e.g.
+     * file.static_view<0, 2048, 2048>().write_pixel({y, x}, value).
+     *
+     * @tparam N Index of the HDU in the tuple of HDUs
+     * @tparam Extents Number of elements along every axis, slowest first
+     * @return The view, valid as long as the ofits object
+     */
+    template <std::size_t N, std::size_t... Extents>
+    auto static_view() const
+    {
+        return std::get<N>(hdus_).template static_view<Extents...>();
+    }
+
     /**
      * @brief Get a reference to an HDU
      *
@@ -177,6 +322,18 @@ public:
         return std::get<N>(hdus_);
     }
 
+    /**
+     * @brief Get the metrics passed to the constructor
+     *
+     * Call io_metrics::snapshot() on the result to get the current values.
+     *
+     * @return The metrics, nullptr if recording is disabled
+     */
+    const std::shared_ptr<io_metrics> &get_metrics() const noexcept
+    {
+        return metrics_;
+    }
+
     /**
      * @brief Class of HDU object
      * 
@@ -206,9 +363,10 @@ public:
          * @param parent_ofits Parent OFITS object
          * @param offset Offset of the HDU in the file
          * @param hdu_schema Schema of the HDU. Contains the size of each dimension of the HDU
+         * @param header_blocks Number of header blocks reserved for the HDU
          */
-        hdu(ofits &parent_ofits, std::size_t offset, const std::initializer_list<std::size_t> &hdu_schema) noexcept
-            : parent_ofits_(parent_ofits), headers_written_(0), header_block_(2880, ' '), offset_(offset)
+        hdu(ofits &parent_ofits, std::size_t offset, const std::initializer_list<std::size_t> &hdu_schema, std::size_t header_blocks = 1) noexcept
+            : parent_ofits_(parent_ofits), header_size_(header_blocks * kSizeHeaderBlock), headers_written_(0), offset_(offset)
         {
             write_header("SIMPLE", "T"); // Value is "T" because the HDU is simple
 
@@ -232,6 +390,13 @@ public:
                 write_header("NAXIS" + std::to_string(++i), std::to_string(size));
             }
 
+            // Unsigned integers are stored as signed ones shifted by BZERO
+            if constexpr (is_offset_unsigned_v<T>)
+            {
+                write_header("BSCALE", "1");
+                write_header("BZERO", std::string(kUnsignedBzero<T>));
+            }
+
             // Calculate the size of the data block of the HDU
             data_block_size_ = naxis_product * std::abs(bitpix) / 8;
 
@@ -252,14 +417,17 @@ public:
         template <class U>
         void value_as(const std::string_view &key, const U &value) const
         {
-            if (headers_written_ * 80 < header_block_.size())
+            // The new keyword and the END after it must fit in the header blocks
+            if ((headers_written_ + 1) * 80 < header_size_)
             {
+                const auto start = io_event::clock::now();
+
                 std::string header = std::string(key) + " = " + std::string(value);
                 header.resize(80, ' ');
 
                 // Calculate the position of the new header
                 size_t position = headers_written_ * 80 + offset_;
-                boost::asio::write_at(parent_ofits_.file_, position, boost::asio::buffer(header));
+                boost::asio::write_at(parent_ofits_.device_, position, boost::asio::buffer(header));
 
                 ++headers_written_;
 
@@ -268,7 +436,10 @@ public:
                 header.resize(80, ' ');
 
                 position = headers_written_ * 80 + offset_;
-                boost::asio::write_at(parent_ofits_.file_, position, boost::asio::buffer(header));
+                boost::asio::write_at(parent_ofits_.device_, position, boost::asio::buffer(header));
+
+                LIB_FITS_PROBE2(header_flush, offset_, headers_written_);
+                parent_ofits_.device_.report(io_operation::header_flush, offset_, (headers_written_ + 1) * 80, start);
             }
             else
             {
@@ -302,7 +473,216 @@ public:
                 throw std::runtime_error("Not enough space in the HDU");
             }
 
-            return boost::asio::write_at(parent_ofits_.file_, offset_ + kSizeHeaderBlock /*headers written*/ + offset, buffers);
+            return write_stored(offset_ + header_size_ /*headers written*/ + offset, buffers);
+        }
+
+        /**
+         * @brief Write data of another type to the HDU
+         *
+         * The physical values of @p source are converted to stored values of
+         * type T with the scaling of the HDU: stored = (physical - BZERO) /
+         * BSCALE, rounded to the nearest value for integral T and handled
+         * according to @p policy when out of range. The conversion runs in
+         * one pass over a bounded staging buffer, the data is written
+         * directly when S is T and there is no scaling.
+         *
+         * @tparam S Type of the source values
+         * @param index Index of the element to write to
+         * @param source Values to write
+         * @param policy What to do with values outside the range of T
+         * @return Number of bytes written
+         * @throw std::overflow_error if policy is overflow_policy::error and a value is out of range
+         */
+        template <class S, std::size_t Extent>
+        std::size_t write_data(const std::initializer_list<std::size_t> index, std::span<S, Extent> source,
+                               overflow_policy policy = overflow_policy::saturate) const
+        {
+            using source_type = std::remove_const_t<S>;
+
+            // Calculate the offset by index
+            std::size_t offset = calculate_offset(index);
+
+            // Check if there is enough space in the HDU data block
+            if (source.size() * sizeof(T) + offset > data_block_size_)
+            {
+                throw std::runtime_error("Not enough space in the HDU");
+            }
+
+            if constexpr (std::is_same_v<source_type, T> && !is_offset_unsigned_v<T>)
+            {
+                if (scaling_.is_identity())
+                {
+                    return parent_ofits_.device_.write_at(offset_ + header_size_ + offset, boost::asio::buffer(source.data(), source.size_bytes()));
+                }
+            }
+
+            // Inverse of the scaling, from physical to stored values
+            const pixel_scaling inverse{1.0 / scaling_.bscale, -scaling_.bzero / scaling_.bscale};
+
+            std::vector<T> staging(std::min(source.size(), kConversionChunk));
+
+            image_statistics partial;
+
+            std::size_t written = 0;
+            for (std::size_t done = 0; done < source.size(); done += staging.size())
+            {
+                const std::size_t chunk = std::min(staging.size(), source.size() - done);
+
+                convert_pixels<source_type, T>(source.data() + done, staging.data(), chunk, inverse, policy);
+
+                if (statistics_)
+                {
+                    partial.accumulate(staging.data(), chunk);
+                }
+
+                if constexpr (is_offset_unsigned_v<T>)
+                {
+                    flip_sign_bits(staging.data(), chunk);
+                }
+
+                written += parent_ofits_.device_.write_at(offset_ + header_size_ + offset + done * sizeof(T),
+                                                          boost::asio::buffer(staging.data(), chunk * sizeof(T)));
+            }
+
+            record_statistics(partial);
+
+            return written;
+        }
+
+        /**
+         * @brief Set the scaling of the stored values
+         *
+         * Writes BSCALE and BZERO to the header. The writes of data of another
+         * type that follow convert the physical values with this scaling,
+         * e.g. float frames stored as int16 with {0.01, 100} keep two decimals
+         * between -227.68 and 427.67.
+         *
+         * @param scaling Scaling of the stored values: physical = bzero + bscale * stored
+         * @throw std::runtime_error if the scaling is already set, BSCALE is 0,
+         * BSCALE or BZERO is not finite or T is unsigned (BZERO holds the
+         * offset of the stored values)
+         */
+        void set_scaling(const pixel_scaling &scaling)
+        {
+            if constexpr (is_offset_unsigned_v<T>)
+            {
+                throw std::runtime_error("Unsigned HDUs cannot be scaled");
+            }
+
+            if (!scaling_.is_identity())
+            {
+                throw std::runtime_error("Scaling of the HDU is already set");
+            }
+
+            if (scaling.bscale == 0.0)
+            {
+                throw std::runtime_error("BSCALE must not be 0");
+            }
+
+            if (!std::isfinite(scaling.bscale) || !std::isfinite(scaling.bzero))
+            {
+                throw std::runtime_error("BSCALE and BZERO must be finite");
+            }
+
+            value_as("BSCALE", format_value(scaling.bscale));
+            value_as("BZERO", format_value(scaling.bzero));
+
+            scaling_ = scaling;
+        }
+
+        /**
+         * @brief Accumulate the statistics of the data written to the HDU
+         *
+         * Reserves DATAMIN and DATAMAX in the header. Every write that follows
+         * adds its values to the statistics in the same pass as their
+         * conversion; concurrent writes accumulate partial statistics merged
+         * under a lock. NaN values are counted apart.
+         *
+         * @throw std::runtime_error if there is no room left in the header
+         */
+        void track_statistics()
+        {
+            if (statistics_)
+            {
+                return;
+            }
+
+            auto statistics = std::make_unique<statistics_state>();
+
+            statistics->min_card = headers_written_;
+            value_as("DATAMIN", std::string(kStatisticsWidth, ' '));
+            statistics->max_card = headers_written_;
+            value_as("DATAMAX", std::string(kStatisticsWidth, ' '));
+
+            statistics_ = std::move(statistics);
+        }
+
+        /**
+         * @brief Get the statistics of the data written so far
+         *
+         * @return Statistics of the stored values, empty unless track_statistics was called
+         */
+        image_statistics get_statistics() const
+        {
+            if (!statistics_)
+            {
+                return {};
+            }
+
+            std::lock_guard lock(statistics_->mutex);
+            return statistics_->total;
+        }
+
+        /**
+         * @brief Write DATAMIN and DATAMAX to the header
+         *
+         * The values are the physical minimum and maximum of the data written
+         * so far. Nothing is written unless track_statistics was called. While
+         * no valid values were written, or when the minimum or maximum is
+         * infinite, the reserved cards become COMMENT cards, since blank and
+         * infinite values do not read back as numbers.
+         */
+        void write_statistics() const
+        {
+            if (!statistics_)
+            {
+                return;
+            }
+
+            const image_statistics statistics = get_statistics();
+            const auto start = io_event::clock::now();
+
+            // Infinite values have no FITS representation either
+            if (!statistics.count || !std::isfinite(statistics.min) || !std::isfinite(statistics.max))
+            {
+                write_card(statistics_->min_card, "COMMENT DATAMIN unknown, no finite values written");
+                write_card(statistics_->max_card, "COMMENT DATAMAX unknown, no finite values written");
+            }
+            else
+            {
+                double min = scaling_.bzero + scaling_.bscale * statistics.min;
+                double max = scaling_.bzero + scaling_.bscale * statistics.max;
+                if (min > max)
+                {
+                    std::swap(min, max); // Negative BSCALE
+                }
+
+                write_card(statistics_->min_card, "DATAMIN = " + format_value(min));
+                write_card(statistics_->max_card, "DATAMAX = " + format_value(max));
+            }
+
+            LIB_FITS_PROBE2(header_flush, offset_, headers_written_);
+            parent_ofits_.device_.report(io_operation::header_flush, offset_, (headers_written_ + 1) * 80, start);
+        }
+
+        /**
+         * @brief Get the scaling of the stored values
+         *
+         * @return BSCALE and BZERO, 1 and 0 unless set_scaling was called
+         */
+        const pixel_scaling &get_scaling() const noexcept
+        {
+            return scaling_;
         }
 
         /**
@@ -334,7 +714,7 @@ public:
                 throw std::runtime_error("Not enough space in the HDU");
             }
 
-            return boost::asio::async_write_at(parent_ofits_.file_, offset_ + kSizeHeaderBlock /*headers written*/ + offset, buffers, std::forward<WriteToken>(token));
+            return async_write_stored(offset_ + header_size_ /*headers written*/ + offset, buffers, std::forward<WriteToken>(token));
         }
 
         /**
@@ -353,8 +733,6 @@ public:
 
             auto it = index.begin();
 
-            auto naxis_it = naxis_.rbegin();
-
             // Check if the first index is out of bounds
             if (*it > naxis_[0])
             {
@@ -369,15 +747,14 @@ public:
             }
 
             // Calculate the offset using the indices
-            for (; it != index.end(); ++it, ++naxis_it)
+            for (std::size_t axis = 0; it != index.end(); ++it, ++axis)
             {
                 std::size_t product = *it;
 
-                // Calculate the product of the indices for all dimensions
-                // except the first
-                for (auto naxis_it_j = naxis_it; naxis_it_j != naxis_.rend() - 1; ++naxis_it_j)
+                // Multiply by the sizes of all the faster axes
+                for (std::size_t j = axis + 1; j < naxis_.size(); ++j)
                 {
-                    product *= *naxis_it_j;
+                    product *= naxis_[j];
                 }
 
                 // Add the product to the offset
@@ -388,6 +765,114 @@ public:
             return offset * sizeof(T);
         }
 
+        /**
+         * @brief View of the image with a shape known at compile time
+         *
+         * Index-to-offset conversion uses the constant strides of the shape
+         * instead of walking the axes of the HDU. Created with static_view().
+         *
+         * @tparam Extents Number of elements along every axis, slowest first
+         */
+        template <std::size_t... Extents>
+        class static_image_view
+        {
+        public:
+            using extents_type = static_extents<Extents...>;
+            using index_type = typename extents_type::index_type;
+
+            /**
+             * @brief Offset of an element from the start of the data block, in bytes.
+             */
+            static constexpr std::size_t byte_offset(const index_type &index) noexcept
+            {
+                return extents_type::offset(index) * sizeof(T);
+            }
+
+            /**
+             * @brief Write data starting at the given index
+             *
+             * @param index Index of the first element to write, slowest axis first
+             * @param buffers Buffer sequence to write
+             * @return Number of bytes written
+             */
+            template <class ConstBufferSequence>
+            std::size_t write_data(const index_type &index, const ConstBufferSequence &buffers) const
+            {
+                return hdu_.write_stored(checked_offset(index, boost::asio::buffer_size(buffers)), buffers);
+            }
+
+            /**
+             * @brief Write one element
+             *
+             * @param index Index of the element, slowest axis first
+             * @param value Value of the element
+             * @return Number of bytes written
+             */
+            std::size_t write_pixel(const index_type &index, const T &value) const
+            {
+                return write_data(index, boost::asio::buffer(&value, sizeof(T)));
+            }
+
+            /**
+             * @brief Asynchronously write data starting at the given index
+             *
+             * @param index Index of the first element to write, slowest axis first
+             * @param buffers Buffer sequence to write, must stay valid until completion
+             * @param token The token to pass to the completion handler
+             */
+            template <class ConstBufferSequence, class WriteToken>
+            auto async_write_data(const index_type &index, const ConstBufferSequence &buffers, WriteToken &&token) const
+            {
+                return hdu_.async_write_stored(checked_offset(index, boost::asio::buffer_size(buffers)), buffers,
+                                                                 std::forward<WriteToken>(token));
+            }
+
+        private:
+            friend class hdu;
+
+            explicit static_image_view(const hdu &hdu)
+                : hdu_(hdu), data_offset_(hdu.offset_ + hdu.header_size_)
+            {
+            }
+
+            /**
+             * @brief Offset in the file of a write of the given size at the given index.
+             */
+            std::size_t checked_offset(const index_type &index, std::size_t size) const
+            {
+                const std::size_t offset = extents_type::checked_offset(index) * sizeof(T);
+
+                if (size > extents_type::size * sizeof(T) - offset)
+                {
+                    throw std::runtime_error("Not enough space in the HDU");
+                }
+
+                return data_offset_ + offset;
+            }
+
+            const hdu &hdu_;          // The viewed HDU
+            std::size_t data_offset_; // Offset of the data block in the file
+        };
+
+        /**
+         * @brief Get a view of the image with a shape known at compile time
+         *
+         * @tparam Extents Number of elements along every axis, slowest first.
+         * Must be the schema of the HDU.
+         * @return The view
+         * @throw std::runtime_error if the extents differ from the schema of the HDU
+         */
+        template <std::size_t... Extents>
+        static_image_view<Extents...> static_view() const
+        {
+            if (naxis_ != std::vector<std::size_t>{Extents...})
+            {
+                throw std::runtime_error("Static extents do not match the schema of the HDU");
+            }
+
+            return static_image_view<Extents...>(*this);
+        }
+
         /**
          * @brief Get the headers written object
          * 
@@ -398,7 +883,158 @@ public:
             return headers_written_;
         }
 
+        /**
+         * @brief Get the number of elements along every axis, slowest first
+         *
+         * @return const std::vector<std::size_t>&
+         */
+        const std::vector<std::size_t> &get_shape() const noexcept
+        {
+            return naxis_;
+        }
+
     private:
+        /**
+         * @brief Number of values converted per write by write_data.
+         *
+         * Keeps the staging buffer of the stored type in the L2 cache.
+         */
+        static constexpr std::size_t kConversionChunk = 16384;
+
+        /**
+         * @brief Characters reserved for the values of DATAMIN and DATAMAX.
+         *
+         * Enough for the shortest representation of any double.
+         */
+        static constexpr std::size_t kStatisticsWidth = 24;
+
+        /**
+         * @brief Statistics of the data written and the header cards they go to.
+         */
+        struct statistics_state
+        {
+            std::mutex mutex;       // Guards total
+            image_statistics total; // Statistics of the stored values written
+            std::size_t min_card;   // Index of the DATAMIN card
+            std::size_t max_card;   // Index of the DATAMAX card
+        };
+
+        /**
+         * @brief Write values of type T at an offset in the file, in their stored form
+         *
+         * Unsigned values are copied to a staging buffer to flip their sign bit.
+         */
+        template <class ConstBufferSequence>
+        std::size_t write_stored(std::uint64_t offset, const ConstBufferSequence &buffers) const
+        {
+            if (statistics_)
+            {
+                image_statistics partial;
+                partial.accumulate_buffers<T>(buffers, boost::asio::buffer_size(buffers));
+                record_statistics(partial);
+            }
+
+            if constexpr (!is_offset_unsigned_v<T>)
+            {
+                return parent_ofits_.device_.write_at(offset, buffers);
+            }
+            else
+            {
+                std::vector<unsigned char> staging(std::min(boost::asio::buffer_size(buffers), kConversionChunk * sizeof(T)));
+
+                std::size_t written = 0;
+                for (auto it = boost::asio::buffer_sequence_begin(buffers); it != boost::asio::buffer_sequence_end(buffers); ++it)
+                {
+                    const boost::asio::const_buffer buffer(*it);
+                    for (std::size_t done = 0; done < buffer.size(); done += staging.size())
+                    {
+                        const std::size_t chunk = std::min(staging.size(), buffer.size() - done);
+
+                        std::memcpy(staging.data(), static_cast<const unsigned char *>(buffer.data()) + done, chunk);
+                        flip_sign_bits<T>(boost::asio::buffer(staging.data(), chunk), chunk, written);
+
+                        written += parent_ofits_.device_.write_at(offset + written, boost::asio::buffer(staging.data(), chunk));
+                    }
+                }
+
+                return written;
+            }
+        }
+
+        /**
+         * @brief Asynchronously write values of type T at an offset in the file, in their stored form
+         *
+         * Unsigned values are copied to a staging buffer, owned by the operation, to flip their sign bit.
+         */
+        template <class ConstBufferSequence, class WriteToken>
+        auto async_write_stored(std::uint64_t offset, const ConstBufferSequence &buffers, WriteToken &&token) const
+        {
+            if (statistics_)
+            {
+                image_statistics partial;
+                partial.accumulate_buffers<T>(buffers, boost::asio::buffer_size(buffers));
+                record_statistics(partial);
+            }
+
+            if constexpr (!is_offset_unsigned_v<T>)
+            {
+                return parent_ofits_.device_.async_write_at(offset, buffers, std::forward<WriteToken>(token));
+            }
+            else
+            {
+                auto staging = std::make_shared<std::vector<unsigned char>>(boost::asio::buffer_size(buffers));
+                boost::asio::buffer_copy(boost::asio::buffer(*staging), buffers);
+                flip_sign_bits<T>(boost::asio::buffer(*staging), staging->size());
+
+                return boost::asio::async_initiate<WriteToken, void(boost::system::error_code, std::size_t)>(
+                    [this, staging](auto handler, std::uint64_t offset)
+                    {
+                        auto executor = boost::asio::get_associated_executor(handler, parent_ofits_.device_.get_executor());
+                        parent_ofits_.device_.async_write_at(offset, boost::asio::buffer(*staging),
+                                                             boost::asio::bind_executor(executor, [staging, handler = std::move(handler)](const boost::system::error_code &ec, std::size_t bytes) mutable
+                                                                                        { std::move(handler)(ec, bytes); }));
+                    },
+                    token, offset);
+            }
+        }
+
+        /**
+         * @brief Merge the statistics of one write into those of the HDU.
+         */
+        void record_statistics(const image_statistics &partial) const
+        {
+            if (statistics_)
+            {
+                std::lock_guard lock(statistics_->mutex);
+                statistics_->total += partial;
+            }
+        }
+
+        /**
+         * @brief Overwrite a header card that was already written
+         *
+         * @param card Index of the card in the header
+         * @param text New text of the card, padded to 80 characters
+         */
+        void write_card(std::size_t card, std::string text) const
+        {
+            std::string header = std::move(text);
+            header.resize(80, ' ');
+
+            boost::asio::write_at(parent_ofits_.device_, offset_ + card * 80, boost::asio::buffer(header));
+        }
+
+        /**
+         * @brief Shortest text that reads back as the same finite double, with the E exponent of FITS.
+         */
+        static std::string format_value(double value)
+        {
+            char buffer[32];
+            const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            std::replace(buffer, result.ptr, 'e', 'E');
+            return std::string(buffer, result.ptr);
+        }
+
         /**
          * @brief Write a header keyword to the HDU
          *
@@ -414,11 +1050,16 @@ public:
             {
                 // Write END to the HDU
 
+                const auto start = io_event::clock::now();
+
                 std::string header = key;
                 header.resize(80, ' ');
 
                 size_t position = headers_written_ * 80 + offset_;
-                boost::asio::write_at(parent_ofits_.file_, position, boost::asio::buffer(header));
+                boost::asio::write_at(parent_ofits_.device_, position, boost::asio::buffer(header));
+
+                LIB_FITS_PROBE2(header_flush, offset_, headers_written_);
+                parent_ofits_.device_.report(io_operation::header_flush, offset_, (headers_written_ + 1) * 80, start);
 
                 return;
             }
@@ -428,10 +1069,10 @@ public:
             std::string header = key + " = " + value;
             header.resize(80, ' ');
 
-            if (headers_written_ * 80 < header_block_.size())
+            if ((headers_written_ + 1) * 80 < header_size_)
             {
                 size_t position = headers_written_ * 80 + offset_;
-                boost::asio::write_at(parent_ofits_.file_, position, boost::asio::buffer(header));
+                boost::asio::write_at(parent_ofits_.device_, position, boost::asio::buffer(header));
 
                 ++headers_written_;
             }
@@ -456,17 +1097,17 @@ public:
             {
                 return 8; // 8-bit unsigned integer
             }
-            else if constexpr (std::is_same_v<T, std::int16_t>)
+            else if constexpr (std::is_same_v<T, std::int16_t> || std::is_same_v<T, std::uint16_t>)
             {
-                return 16; // 16-bit integer
+                return 16; // 16-bit integer, unsigned with BZERO = 2^15
             }
-            else if constexpr (std::is_same_v<T, std::int32_t>)
+            else if constexpr (std::is_same_v<T, std::int32_t> || std::is_same_v<T, std::uint32_t>)
             {
-                return 32; // 32-bit integer
+                return 32; // 32-bit integer, unsigned with BZERO = 2^31
             }
-            else if constexpr (std::is_same_v<T, std::int64_t>)
+            else if constexpr (std::is_same_v<T, std::int64_t> || std::is_same_v<T, std::uint64_t>)
             {
-                return 64; // 64-bit integer
+                return 64; // 64-bit integer, unsigned with BZERO = 2^63
             }
             else if constexpr (std::is_same_v<T, float>)
             {
@@ -483,12 +1124,14 @@ public:
         }
 
     private:
-        ofits &parent_ofits_;                 // Parent OFITS object
-        std::string header_block_;            // Header block of the HDU
-        mutable std::size_t headers_written_; // Number of headers written to the HDU
-        std::size_t offset_;                  // Offset of the HDU in the file
-        std::size_t data_block_size_;         // Size of the data block in the HDU
-        std::vector<std::size_t> naxis_;      // Number of elements in each dimension of the HDU
+        ofits &parent_ofits_;                          // Parent OFITS object
+        std::size_t header_size_;                      // Size of the header blocks of the HDU
+        mutable std::size_t headers_written_;          // Number of headers written to the HDU
+        std::size_t offset_;                           // Offset of the HDU in the file
+        std::size_t data_block_size_;                  // Size of the data block in the HDU
+        std::vector<std::size_t> naxis_;               // Number of elements in each dimension of the HDU
+        pixel_scaling scaling_;                        // BSCALE and BZERO of the stored values
+        std::unique_ptr<statistics_state> statistics_; // Statistics of the data written, nullptr unless tracked
     };
 
 private:
@@ -527,9 +1170,10 @@ private:
      *
      * @param parent_ofits Parent OFITS object
      * @param schema Schema specifying the number of elements in each dimension
+     * @param header_blocks Number of header blocks reserved for each HDU
      * @return Tuple of HDU objects
      */
-    static std::tuple<hdu<Args>...> make_hdu_tuple(ofits &parent_ofits, std::array<std::initializer_list<std::size_t>, sizeof...(Args)> schema) noexcept
+    static std::tuple<hdu<Args>...> make_hdu_tuple(ofits &parent_ofits, std::array<std::initializer_list<std::size_t>, sizeof...(Args)> schema, std::size_t header_blocks) noexcept
     {
         // Calculate the offsets of the HDUs in the file
         std::array<size_t, sizeof...(Args)> offset;
@@ -541,10 +1185,16 @@ private:
         {
             offset[i] = current_offset;
 
-            current_offset += kSizeHeaderBlock + round_offset(std::accumulate(schema[i].begin(), schema[i].end(), sizes[i], std::multiplies<std::size_t>()));
+            current_offset += header_blocks * kSizeHeaderBlock + round_offset(std::accumulate(schema[i].begin(), schema[i].end(), sizes[i], std::multiplies<std::size_t>()));
+        }
+
+        // Register the HDUs in file order: the order in which the elements of the tuple are built is unspecified
+        for (size_t i = 0; i < sizeof...(Args); ++i)
+        {
+            parent_ofits.device_.add_hdu(offset[i]);
         }
 
-        return make_hdu_tuple_impl(parent_ofits, schema, offset, std::make_index_sequence<sizeof...(Args)>{});
+        return make_hdu_tuple_impl(parent_ofits, schema, offset, header_blocks, std::make_index_sequence<sizeof...(Args)>{});
     }
 
     /**
@@ -560,18 +1210,21 @@ private:
      * @param parent_ofits Parent OFITS object
      * @param schema Schema of the HDUs
      * @param offset Offsets of the HDUs in the file
+     * @param header_blocks Number of header blocks reserved for each HDU
      * @param is_ Indices sequence
      * @return Tuple of HDU objects
      */
     template <size_t... Is>
-    static std::tuple<hdu<Args>...> make_hdu_tuple_impl(ofits &parent_ofits, std::array<std::initializer_list<std::size_t>, sizeof...(Args)> &schema, std::array<size_t, sizeof...(Args)> &offset, std::index_sequence<Is...> is_) noexcept
+    static std::tuple<hdu<Args>...> make_hdu_tuple_impl(ofits &parent_ofits, std::array<std::initializer_list<std::size_t>, sizeof...(Args)> &schema, std::array<size_t, sizeof...(Args)> &offset, std::size_t header_blocks, std::index_sequence<Is...> is_) noexcept
     {
         // Create tuple of HDUs from the schema
-        return std::make_tuple(hdu<Args>(parent_ofits, offset[Is], schema[Is])...);
+        return std::make_tuple(hdu<Args>(parent_ofits, offset[Is], schema[Is], header_blocks)...);
     }
 
 private:
-    boost::asio::io_context io_context_;   // IO context to use for asynchronous operations
-    boost::asio::random_access_file file_; // File to write to
-    std::tuple<hdu<Args>...> hdus_;        // HDUs of the file
+    boost::asio::io_context io_context_;                  // IO context to use for asynchronous operations
+    boost::asio::random_access_file file_;                // File to write to
+    std::shared_ptr<io_metrics> metrics_;                 // Optional I/O metrics
+    file_device<boost::asio::random_access_file> device_; // Device through which the file is accessed
+    std::tuple<hdu<Args>...> hdus_;                       // HDUs of the file
 };
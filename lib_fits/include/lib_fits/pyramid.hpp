@@ -0,0 +1,295 @@
+/**
+ * @file pyramid.hpp
+ * @author Alina Gubeeva
+ * @brief Multi-resolution pyramids of images stored in a sidecar FITS file
+ * @version 0.1
+ * @date 2024-04-10
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ifits.hpp"                 // ifits
+#include "ofits.hpp"                 // ofits
+#include "details/work_stealing.hpp" // work_stealing_pool
+
+/**
+ * @brief Type of the HDUs of the levels of a pyramid.
+ */
+template <class T, std::size_t Level>
+using pyramid_level_t = T;
+
+/**
+ * @brief Number of elements along an axis of a level of a pyramid.
+ *
+ * Every level halves the axes of the previous one, rounding up.
+ */
+constexpr std::size_t pyramid_extent(std::size_t extent, std::size_t level) noexcept
+{
+    return (extent + (std::size_t(1) << level) - 1) >> level;
+}
+
+/**
+ * @brief Write the levels of a pyramid of a two-dimensional image to a sidecar file
+ *
+ * HDU k of the sidecar file is level k + 1 of the pyramid: the image
+ * averaged over blocks of 2^(k + 1) x 2^(k + 1) pixels, with partial blocks
+ * at the edges and NaN pixels left out. Level 0 is the image itself. The
+ * header of every level holds its number in the PYRLEVEL keyword. Once the
+ * blocks cover the whole image, the remaining levels are 1 x 1.
+ *
+ * All the levels are produced in a single pass over the image. It is read
+ * in bands of 2^Levels rows, each band is reduced level by level as sums
+ * and counts of valid pixels, so the means are exact whatever the
+ * number of levels, and every level of the band is written with one write.
+ * The bands are taken in turn by the threads, each one holding one band.
+ *
+ * @tparam T Type of the pixels of the levels
+ * @tparam Levels Number of levels written to the sidecar file
+ * @param source Image HDU, read with its scaling (see read_as)
+ * @param sidecar Path to the sidecar file to write, replaced if it exists
+ * @param threads Number of threads reducing bands
+ * @throw std::runtime_error if the image is not two-dimensional or is empty
+ */
+template <class T = float, std::size_t Levels>
+void write_pyramid(ifits::hdu &source, const std::filesystem::path &sidecar, std::size_t threads = 1)
+{
+    static_assert(Levels > 0 && Levels < 16, "A pyramid has between 1 and 15 levels");
+
+    const auto shape = source.get_shape();
+    if (shape.size() != 2)
+    {
+        throw std::runtime_error("Pyramids need two-dimensional images");
+    }
+
+    const std::size_t height = shape[0], width = shape[1];
+    if (height == 0 || width == 0)
+    {
+        throw std::runtime_error("Pyramids need non-empty images");
+    }
+
+    // ofits does not truncate, the levels of a previous pyramid would remain after the new ones
+    std::filesystem::remove(sidecar);
+
+    [&]<std::size_t... Is>(std::index_sequence<Is...>)
+    {
+        ofits<pyramid_level_t<T, Is>...> file{sidecar, {{{pyramid_extent(height, Is + 1), pyramid_extent(width, Is + 1)}...}}};
+
+        (file.template value_as<Is>("PYRLEVEL", std::to_string(Is + 1)), ...);
+
+        // Write rows of a level, the HDU is selected at run time
+        auto write_level = [&](std::size_t level, std::size_t row, std::span<const double> values)
+        {
+            ((level == Is + 1 ? (file.template write_data<Is>({row, 0}, values), 0) : 0), ...);
+        };
+
+        constexpr std::size_t kBandRows = std::size_t(1) << Levels;
+        const std::size_t bands = (height + kBandRows - 1) / kBandRows;
+
+        std::atomic<std::size_t> next_band{0};
+
+        auto reduce_bands = [&]
+        {
+            std::vector<double> band(kBandRows * width);
+
+            // Sums and counts of the valid pixels of every level of the band
+            std::vector<std::vector<double>> sums(Levels + 1);
+            std::vector<std::vector<std::size_t>> counts(Levels + 1);
+            for (std::size_t level = 1; level <= Levels; ++level)
+            {
+                sums[level].resize((kBandRows >> level) * pyramid_extent(width, level));
+                counts[level].resize(sums[level].size());
+            }
+            std::vector<double> means(sums[1].size());
+
+            for (std::size_t index = next_band++; index < bands; index = next_band++)
+            {
+                const std::size_t first_row = index * kBandRows;
+                const std::size_t rows = std::min(kBandRows, height - first_row);
+
+                source.read_as(image_region{{first_row, 0}, {rows, width}}, std::span(band.data(), rows * width));
+
+                for (std::size_t level = 1; level <= Levels; ++level)
+                {
+                    const std::size_t in_width = pyramid_extent(width, level - 1), in_rows = pyramid_extent(rows, level - 1);
+                    const std::size_t out_width = pyramid_extent(width, level), out_rows = pyramid_extent(rows, level);
+
+                    auto &sum = sums[level];
+                    auto &count = counts[level];
+
+                    for (std::size_t y = 0; y < out_rows; ++y)
+                    {
+                        for (std::size_t x = 0; x < out_width; ++x)
+                        {
+                            double block_sum = 0.0;
+                            std::size_t block_count = 0;
+
+                            for (std::size_t j = 2 * y; j < std::min(2 * y + 2, in_rows); ++j)
+                            {
+                                for (std::size_t i = 2 * x; i < std::min(2 * x + 2, in_width); ++i)
+                                {
+                                    if (level == 1)
+                                    {
+                                        const double value = band[j * in_width + i];
+                                        const bool valid = value == value; // False for NaN
+                                        block_sum += valid ? value : 0.0;
+                                        block_count += valid;
+                                    }
+                                    else
+                                    {
+                                        block_sum += sums[level - 1][j * in_width + i];
+                                        block_count += counts[level - 1][j * in_width + i];
+                                    }
+                                }
+                            }
+
+                            sum[y * out_width + x] = block_sum;
+                            count[y * out_width + x] = block_count;
+                            means[y * out_width + x] = block_count ? block_sum / static_cast<double>(block_count)
+                                                                   : std::numeric_limits<double>::quiet_NaN();
+                        }
+                    }
+
+                    write_level(level, first_row >> level, std::span<const double>(means.data(), out_rows * out_width));
+                }
+            }
+        };
+
+        threads = std::clamp<std::size_t>(threads, 1, bands);
+        if (threads == 1)
+        {
+            reduce_bands();
+            return;
+        }
+
+        work_stealing_pool pool(threads);
+        for (std::size_t t = 0; t < threads; ++t)
+        {
+            pool.submit([&]
+                        {
+                try
+                {
+                    reduce_bands();
+                }
+                catch (...)
+                {
+                    next_band = bands; // Stop the other threads
+                    throw;
+                } });
+        }
+        pool.wait();
+    }(std::make_index_sequence<Levels>{});
+}
+
+/**
+ * @brief Reader of an image and the levels of its pyramid.
+ *
+ * Level 0 is the image itself, the other levels are the HDUs of the
+ * sidecar file written by write_pyramid. A viewer asks for the level
+ * matching the resolution it displays and reads it instead of the image.
+ */
+class pyramid
+{
+public:
+    /**
+     * @brief Open the sidecar file of an image
+     *
+     * @param source Image HDU, level 0 of the pyramid
+     * @param sidecar Path to the sidecar file written by write_pyramid
+     * @throw std::runtime_error if the sidecar file does not match the image
+     */
+    pyramid(ifits::hdu &source, const std::filesystem::path &sidecar)
+        : source_(source), sidecar_(sidecar)
+    {
+        const auto shape = source_.get_shape();
+        if (shape.size() != 2)
+        {
+            throw std::runtime_error("Pyramids need two-dimensional images");
+        }
+
+        std::size_t level = 1;
+        for (const auto &hdu : sidecar_.get_hdus())
+        {
+            if (hdu.get_shape() != std::vector<std::size_t>{pyramid_extent(shape[0], level), pyramid_extent(shape[1], level)})
+            {
+                throw std::runtime_error("Pyramid level " + std::to_string(level) + " does not match the image");
+            }
+            ++level;
+        }
+    }
+
+    /**
+     * @brief Number of levels, including the image itself.
+     */
+    std::size_t levels() const noexcept
+    {
+        return sidecar_.get_hdus().size() + 1;
+    }
+
+    /**
+     * @brief Get the HDU of a level
+     *
+     * @param level Level of the pyramid, 0 is the image itself
+     * @return ifits::hdu&
+     */
+    ifits::hdu &get_level(std::size_t level)
+    {
+        return level == 0 ? source_ : sidecar_.get_hdu(level - 1);
+    }
+
+    /**
+     * @brief Pick the level for a view of the image
+     *
+     * Returns the coarsest level with at least the requested number of
+     * pixels along both axes, i.e. the smallest read that is not upsampled
+     * by the viewer, and level 0 when no level is large enough.
+     *
+     * @param height Number of rows displayed for the whole image
+     * @param width Number of columns displayed for the whole image
+     * @return The level
+     */
+    std::size_t pick_level(std::size_t height, std::size_t width) const
+    {
+        const auto shape = source_.get_shape();
+
+        std::size_t level = 0;
+        while (level + 1 < levels() &&
+               pyramid_extent(shape[0], level + 1) >= height &&
+               pyramid_extent(shape[1], level + 1) >= width)
+        {
+            ++level;
+        }
+        return level;
+    }
+
+    /**
+     * @brief Read a region of a level (see ifits::hdu::read_as)
+     *
+     * @param level Level of the pyramid, 0 is the image itself
+     * @param region Region in the pixels of the level
+     * @param dest Destination of the values, in file order
+     */
+    template <class U>
+    void read_level(std::size_t level, const image_region &region, std::span<U> dest)
+    {
+        get_level(level).read_as(region, dest);
+    }
+
+private:
+    ifits::hdu &source_; // The image, level 0
+    ifits sidecar_;      // The other levels
+};
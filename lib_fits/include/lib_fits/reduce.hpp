@@ -0,0 +1,403 @@
+/**
+ * @file reduce.hpp
+ * @author Alina Gubeeva
+ * @brief Reductions of images along one axis
+ * @version 0.1
+ * @date 2024-04-10
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+// STL
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "ifits.hpp"                 // ifits
+#include "details/region.hpp"        // image_region
+#include "details/statistics.hpp"    // nan_median
+#include "details/work_stealing.hpp" // work_stealing_pool
+
+/**
+ * @brief Reduction of the values along the axis.
+ */
+enum class reduce_mode
+{
+    sum,   // Sum of the valid values, 0 if there are none
+    mean,  // Mean of the valid values
+    min,   // Smallest valid value
+    max,   // Largest valid value
+    median // Median of the valid values
+};
+
+/**
+ * @brief Parameters of reduce_axis.
+ */
+struct reduce_options
+{
+    reduce_mode mode = reduce_mode::sum;                // Reduction of the values along the axis
+    std::size_t memory_budget = std::size_t(256) << 20; // Bytes of the buffers of all the threads
+    std::size_t threads = 1;                            // Threads reading and reducing
+};
+
+/**
+ * @brief Shape of an image reduced along an axis
+ *
+ * @param shape Shape of the image, slowest axis first
+ * @param axis Reduced axis, 0 is the slowest
+ * @return The shape without the axis, {1} for a one-dimensional image
+ * @throw std::runtime_error if the axis does not exist
+ */
+inline std::vector<std::size_t> reduced_shape(const std::vector<std::size_t> &shape, std::size_t axis)
+{
+    if (axis >= shape.size())
+    {
+        throw std::runtime_error("Reduced axis does not exist");
+    }
+
+    std::vector<std::size_t> reduced;
+    for (std::size_t i = 0; i < shape.size(); ++i)
+    {
+        if (i != axis)
+        {
+            reduced.push_back(shape[i]);
+        }
+    }
+    return reduced.empty() ? std::vector<std::size_t>{1} : reduced;
+}
+
+/**
+ * @brief Reduce an image along one axis, e.g. a moment map of a spectral cube
+ *
+ * The image is seen as {outer, axis, inner}: the axes before the reduced
+ * one, the reduced one and the axes after it. Every value is read once, in
+ * contiguous runs in the order of the file:
+ *
+ * - when the values of a few outer indices fit in the share of the budget
+ *   of a thread, the threads take runs of outer indices and reduce them
+ *   completely;
+ * - otherwise every outer index is split into bands along the axis, the
+ *   threads accumulate their bands into partial planes of their own, in
+ *   blocks of the plane that stay in the cache, and the planes are merged.
+ *
+ * The median needs all the values of a pixel: when the values of an outer
+ * index fit in the share of a thread, the threads read whole runs of outer
+ * indices like above and gather the values of every pixel in memory;
+ * otherwise they take blocks of the inner axes, with one run per index of
+ * the reduced axis.
+ *
+ * NaN values are left out. The mean, minimum, maximum and median of pixels
+ * without valid values are NaN. The result is held in memory and written
+ * with one write.
+ *
+ * @param source Image HDU, read with its scaling (see read_as)
+ * @param axis Reduced axis, 0 is the slowest
+ * @param dest HDU of an ofits file of reduced_shape(source.get_shape(), axis), e.g. out.get_hdu<0>()
+ * @param options Reduction, memory budget and number of threads
+ * @throw std::runtime_error if the axis does not exist, the shapes differ or the budget is too small
+ */
+template <class Output>
+void reduce_axis(ifits::hdu &source, std::size_t axis, Output &dest, const reduce_options &options = {})
+{
+    const auto shape = source.get_shape();
+    if (dest.get_shape() != reduced_shape(shape, axis))
+    {
+        throw std::runtime_error("Output shape does not match the reduced image");
+    }
+
+    std::size_t outer = 1, inner = 1;
+    for (std::size_t i = 0; i < axis; ++i)
+    {
+        outer *= shape[i];
+    }
+    for (std::size_t i = axis + 1; i < shape.size(); ++i)
+    {
+        inner *= shape[i];
+    }
+    const std::size_t length = shape[axis];
+
+    const std::size_t threads = std::max<std::size_t>(options.threads, 1);
+    const std::size_t share = options.memory_budget / threads / sizeof(double); // Values per thread
+    const reduce_mode mode = options.mode;
+
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const double initial = mode == reduce_mode::min   ? std::numeric_limits<double>::infinity()
+                           : mode == reduce_mode::max ? -std::numeric_limits<double>::infinity()
+                                                      : 0.0;
+
+    std::vector<double> result(outer * inner, nan);
+    if (result.empty() || length == 0)
+    {
+        dest.write_data({0}, std::span<const double>(result));
+        return;
+    }
+
+    // Region of the rows [first, first + rows) of the axis at outer_count outer indices from index
+    auto region = [&](std::size_t index, std::size_t outer_count, std::size_t first, std::size_t rows)
+    {
+        image_region r{std::vector<std::size_t>(shape.size(), 0), shape};
+        for (std::size_t i = axis; i-- > 0;)
+        {
+            r.start[i] = index % shape[i];
+            r.count[i] = 1;
+            index /= shape[i];
+        }
+        if (axis > 0)
+        {
+            r.count[axis - 1] = outer_count;
+        }
+        r.start[axis] = first;
+        r.count[axis] = rows;
+        return r;
+    };
+
+    // Accumulate rows of inner values into a plane of values and counts
+    auto accumulate = [&](const double *rows, std::size_t count, double *values, double *counts)
+    {
+        // The reduction is a parameter so that every loop is branch-free
+        auto run = [&](auto combine)
+        {
+            constexpr std::size_t kBlock = 4096; // Values of a block of the plane, kept in the cache
+
+            for (std::size_t first = 0; first < inner; first += kBlock)
+            {
+                const std::size_t last = std::min(inner, first + kBlock);
+                for (std::size_t row = 0; row < count; ++row)
+                {
+                    const double *row_values = rows + row * inner;
+                    for (std::size_t i = first; i < last; ++i)
+                    {
+                        const double value = row_values[i];
+                        const bool valid = value == value; // False for NaN
+                        values[i] = combine(values[i], value, valid);
+                        counts[i] += valid ? 1.0 : 0.0;
+                    }
+                }
+            }
+        };
+
+        switch (mode)
+        {
+        case reduce_mode::min:
+            run([](double current, double value, bool valid)
+                { return valid && value < current ? value : current; });
+            break;
+        case reduce_mode::max:
+            run([](double current, double value, bool valid)
+                { return valid && value > current ? value : current; });
+            break;
+        default:
+            run([](double current, double value, bool valid)
+                { return current + (valid ? value : 0.0); });
+            break;
+        }
+    };
+
+    // Final values of a plane
+    auto finish = [&](const double *values, const double *counts, double *out)
+    {
+        for (std::size_t i = 0; i < inner; ++i)
+        {
+            switch (mode)
+            {
+            case reduce_mode::sum:
+                out[i] = values[i];
+                break;
+            case reduce_mode::mean:
+                out[i] = counts[i] > 0.0 ? values[i] / counts[i] : nan;
+                break;
+            default:
+                out[i] = counts[i] > 0.0 ? values[i] : nan;
+                break;
+            }
+        }
+    };
+
+    // Inner values below which the runs of the median blocks are too short to be read one by one
+    constexpr std::size_t kShortRun = 512;
+
+    work_stealing_pool pool(threads);
+
+    if (mode == reduce_mode::median && length * inner + length <= share && (outer >= threads || inner < kShortRun))
+    {
+        // Whole {outer, axis, inner} slabs per task, as for the other reductions, gathered in memory
+        const std::size_t per_task = std::max<std::size_t>(1, share / (length * inner + length));
+        const std::size_t run_length = axis > 0 ? shape[axis - 1] : 1;
+
+        for (std::size_t index = 0; index < outer;)
+        {
+            const std::size_t count = std::min({per_task, outer - index, run_length - index % run_length});
+
+            pool.submit([&, index, count]
+                        {
+                std::vector<double> rows(count * length * inner), pixel(length);
+
+                source.read_as(region(index, count, 0, length), std::span(rows));
+
+                for (std::size_t o = 0; o < count; ++o)
+                {
+                    for (std::size_t i = 0; i < inner; ++i)
+                    {
+                        result[(index + o) * inner + i] = nan_median(rows.data() + o * length * inner + i, length, inner, pixel.data());
+                    }
+                } });
+
+            index += count;
+        }
+        pool.wait();
+    }
+    else if (mode == reduce_mode::median)
+    {
+        // Blocks of inner values whose values along the axis fit in the share of a thread
+        const std::size_t block = std::min(inner, share / (length + 1));
+        if (block == 0)
+        {
+            throw std::runtime_error("Memory budget is too small for the reduced axis");
+        }
+
+        for (std::size_t index = 0; index < outer; ++index)
+        {
+            for (std::size_t first = 0; first < inner; first += block)
+            {
+                pool.submit([&, index, first]
+                            {
+                    const std::size_t count = std::min(block, inner - first);
+                    std::vector<double> values(length * count), pixel(length);
+
+                    // The block is the flattened inner axes [first, first + count), read one row of the axis at a time
+                    for (std::size_t row = 0; row < length; ++row)
+                    {
+                        std::size_t done = 0;
+                        while (done < count)
+                        {
+                            // Split the block into runs of the last inner axis
+                            auto r = region(index, 1, row, 1);
+                            std::size_t position = first + done;
+                            std::size_t run = count - done;
+                            if (axis + 1 < shape.size())
+                            {
+                                const std::size_t last_axis = shape.size() - 1;
+                                for (std::size_t i = last_axis; i > axis; --i)
+                                {
+                                    r.start[i] = position % shape[i];
+                                    r.count[i] = 1;
+                                    position /= shape[i];
+                                }
+                                run = std::min(run, shape[last_axis] - r.start[last_axis]);
+                                r.count[last_axis] = run;
+                            }
+
+                            source.read_as(r, std::span(values.data() + row * count + done, run));
+                            done += run;
+                        }
+                    }
+
+                    for (std::size_t i = 0; i < count; ++i)
+                    {
+                        result[index * inner + first + i] = nan_median(values.data() + i, length, count, pixel.data());
+                    } });
+            }
+        }
+        pool.wait();
+    }
+    else if (length * inner + 2 * inner <= share && outer >= threads)
+    {
+        // Whole outer indices per task, along the axis before the reduced one
+        const std::size_t per_task = std::max<std::size_t>(1, share / (length * inner + 2 * inner));
+        const std::size_t run_length = axis > 0 ? shape[axis - 1] : 1;
+
+        for (std::size_t index = 0; index < outer;)
+        {
+            const std::size_t count = std::min({per_task, outer - index, run_length - index % run_length});
+
+            pool.submit([&, index, count]
+                        {
+                std::vector<double> rows(count * length * inner);
+                std::vector<double> values(inner), counts(inner);
+
+                source.read_as(region(index, count, 0, length), std::span(rows));
+
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    std::fill(values.begin(), values.end(), initial);
+                    std::fill(counts.begin(), counts.end(), 0.0);
+                    accumulate(rows.data() + i * length * inner, length, values.data(), counts.data());
+                    finish(values.data(), counts.data(), result.data() + (index + i) * inner);
+                } });
+
+            index += count;
+        }
+        pool.wait();
+    }
+    else
+    {
+        // Bands along the axis accumulated into one partial plane per thread
+        if (share < 3 * inner)
+        {
+            throw std::runtime_error("Memory budget is too small for the partial planes");
+        }
+        const std::size_t band = std::min(length, share / inner - 2);
+
+        struct partial_plane
+        {
+            std::vector<double> buffer; // Band read by the worker
+            std::vector<double> values; // Values accumulated by the worker
+            std::vector<double> counts; // Valid values accumulated by the worker
+        };
+        std::vector<partial_plane> planes(threads);
+
+        for (std::size_t index = 0; index < outer; ++index)
+        {
+            for (auto &plane : planes)
+            {
+                plane.values.assign(inner, initial);
+                plane.counts.assign(inner, 0.0);
+            }
+
+            for (std::size_t first = 0; first < length; first += band)
+            {
+                pool.submit([&, index, first]
+                            {
+                    const std::size_t rows = std::min(band, length - first);
+                    auto &plane = planes[pool.worker()];
+                    plane.buffer.resize(rows * inner);
+
+                    source.read_as(region(index, 1, first, rows), std::span(plane.buffer));
+                    accumulate(plane.buffer.data(), rows, plane.values.data(), plane.counts.data()); });
+            }
+            pool.wait();
+
+            // Merge the partial planes into the first one
+            auto &merged = planes.front();
+            for (std::size_t p = 1; p < planes.size(); ++p)
+            {
+                for (std::size_t i = 0; i < inner; ++i)
+                {
+                    const double value = planes[p].values[i];
+                    switch (mode)
+                    {
+                    case reduce_mode::min:
+                        merged.values[i] = std::min(merged.values[i], value);
+                        break;
+                    case reduce_mode::max:
+                        merged.values[i] = std::max(merged.values[i], value);
+                        break;
+                    default:
+                        merged.values[i] += value;
+                        break;
+                    }
+                    merged.counts[i] += planes[p].counts[i];
+                }
+            }
+            finish(merged.values.data(), merged.counts.data(), result.data() + index * inner);
+        }
+    }
+
+    dest.write_data({0}, std::span<const double>(result));
+}
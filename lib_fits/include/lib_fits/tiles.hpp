@@ -0,0 +1,249 @@
+/**
+ * @file tiles.hpp
+ * @author Alina Gubeeva
+ * @brief Out-of-core processing of images tile by tile
+ * @version 0.1
+ * @date 2024-04-10
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "ifits.hpp"                 // ifits
+#include "details/region.hpp"        // image_region
+#include "details/work_stealing.hpp" // work_stealing_pool
+
+/**
+ * @brief Layout and resources of process_tiles.
+ */
+struct tile_options
+{
+    std::size_t tile_rows = 0;                          // Rows of a tile, 0 to derive them from the memory budget
+    std::size_t tile_columns = 0;                       // Columns of a tile, 0 for whole rows
+    std::size_t halo = 0;                               // Pixels around a tile passed to the kernel along both axes
+    std::size_t memory_budget = std::size_t(256) << 20; // Bytes of the buffers of the bands in flight
+    std::size_t threads = 0;                            // Workers, 0 for std::thread::hardware_concurrency()
+};
+
+/**
+ * @brief Tile passed to the kernel of process_tiles.
+ *
+ * The input holds the tile and its halo, clipped to the image, so the halo
+ * is thinner at the edges of the image. Both buffers are parts of larger
+ * row-major buffers, hence the strides.
+ */
+struct image_tile
+{
+    image_region region;       // Pixels of the tile in the image, {row, column}
+    image_region input_region; // Pixels of the input: the tile and its halo, clipped to the image
+    const double *input;       // First value of input_region
+    std::size_t input_stride;  // Values between two rows of input
+    double *output;            // First value of the tile in the output
+    std::size_t output_stride; // Values between two rows of output
+
+    /**
+     * @brief Input value relative to the first pixel of the tile, within input_region.
+     */
+    double in(std::ptrdiff_t row, std::ptrdiff_t column) const noexcept
+    {
+        const std::ptrdiff_t y = row + static_cast<std::ptrdiff_t>(region.start[0] - input_region.start[0]);
+        const std::ptrdiff_t x = column + static_cast<std::ptrdiff_t>(region.start[1] - input_region.start[1]);
+        return input[y * static_cast<std::ptrdiff_t>(input_stride) + x];
+    }
+
+    /**
+     * @brief Output value relative to the first pixel of the tile.
+     */
+    double &out(std::size_t row, std::size_t column) const noexcept
+    {
+        return output[row * output_stride + column];
+    }
+};
+
+/**
+ * @brief Run a kernel over a two-dimensional image tile by tile, writing its results to another HDU
+ *
+ * The image is read in bands of tile_rows rows plus the halo above and
+ * below, converted to double with its scaling (see read_as). Every band is
+ * split into tiles of tile_columns columns, run by the kernel on a
+ * work-stealing pool. The calling thread reads the next bands while the
+ * workers run the tiles of the previous ones, as long as the buffers of
+ * all the bands in flight (input and output) fit in the memory budget.
+ * The output of a band is written with one write once all its tiles have
+ * run and the bands before it are written, so the output file is written
+ * in order.
+ *
+ * Without tile_rows, the bands are as high as the budget allows for one
+ * band per worker plus one being read.
+ *
+ * @param source Image HDU
+ * @param dest HDU of an ofits file with the shape of the image, e.g. out.get_hdu<0>()
+ * @param kernel Called as kernel(const image_tile &) from the workers, concurrently
+ * @param options Layout of the tiles, memory budget and number of workers
+ * @throw std::runtime_error if the image is not two-dimensional, the shapes
+ * differ or one band does not fit in the budget
+ * @throw The first exception thrown by the kernel
+ */
+template <class Output, class Kernel>
+void process_tiles(ifits::hdu &source, Output &dest, Kernel kernel, const tile_options &options = {})
+{
+    const auto shape = source.get_shape();
+    if (shape.size() != 2)
+    {
+        throw std::runtime_error("Tiles need two-dimensional images");
+    }
+    if (dest.get_shape() != shape)
+    {
+        throw std::runtime_error("Output shape does not match the image");
+    }
+
+    const std::size_t height = shape[0], width = shape[1];
+    if (height == 0 || width == 0)
+    {
+        return;
+    }
+
+    const std::size_t threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    const std::size_t tile_columns = options.tile_columns ? std::min(options.tile_columns, width) : width;
+    const std::size_t halo = options.halo;
+
+    // Bytes of a band of the given rows: input with the halo and output
+    auto band_bytes = [&](std::size_t rows)
+    {
+        return (2 * rows + 2 * halo) * width * sizeof(double);
+    };
+
+    std::size_t band_rows = options.tile_rows;
+    if (!band_rows)
+    {
+        const std::size_t share = options.memory_budget / (threads + 1) / (width * sizeof(double));
+        band_rows = share > 2 * halo ? (share - 2 * halo) / 2 : 1;
+    }
+    band_rows = std::clamp<std::size_t>(band_rows, 1, height);
+
+    const std::size_t max_bands = options.memory_budget / band_bytes(band_rows);
+    if (max_bands == 0)
+    {
+        throw std::runtime_error("Memory budget is too small for one band of tiles");
+    }
+
+    struct tile_band
+    {
+        std::size_t first_row;              // First row of the band
+        std::size_t rows;                   // Rows of the band
+        std::size_t input_first_row;        // First row of the input, with the halo
+        std::vector<double> input;          // Rows of the band and its halo
+        std::vector<double> output;         // Rows of the band
+        std::atomic<std::size_t> remaining; // Tiles not run yet
+        bool done = false;                  // Whether all the tiles have run
+    };
+
+    std::mutex mutex;                             // Protects bands and failed
+    std::condition_variable space;                // Notified when a band is written or a tile fails
+    std::deque<std::unique_ptr<tile_band>> bands; // Bands in flight, in file order
+    bool failed = false;                          // Whether a tile has thrown
+
+    // Write the bands whose tiles have all run, in file order
+    auto finish_band = [&](tile_band &band)
+    {
+        std::lock_guard lock(mutex);
+        band.done = true;
+
+        while (!bands.empty() && bands.front()->done)
+        {
+            const auto &front = *bands.front();
+            dest.write_data({front.first_row, 0}, std::span<const double>(front.output));
+            bands.pop_front();
+            space.notify_one();
+        }
+    };
+
+    // Declared last, so that its destructor finishes the tasks before the state above goes
+    work_stealing_pool pool(threads);
+
+    for (std::size_t first_row = 0; first_row < height; first_row += band_rows)
+    {
+        {
+            std::unique_lock lock(mutex);
+            space.wait(lock, [&]
+                       { return failed || bands.size() < max_bands; });
+            if (failed)
+            {
+                break;
+            }
+        }
+
+        auto band = std::make_unique<tile_band>();
+        band->first_row = first_row;
+        band->rows = std::min(band_rows, height - first_row);
+        band->input_first_row = first_row - std::min(halo, first_row);
+
+        const std::size_t input_rows = std::min(height, first_row + band->rows + halo) - band->input_first_row;
+        band->input.resize(input_rows * width);
+        band->output.resize(band->rows * width);
+
+        source.read_as(image_region{{band->input_first_row, 0}, {input_rows, width}}, std::span(band->input));
+
+        const std::size_t tiles = (width + tile_columns - 1) / tile_columns;
+        band->remaining = tiles;
+
+        tile_band *current = band.get();
+        {
+            std::lock_guard lock(mutex);
+            bands.push_back(std::move(band));
+        }
+
+        for (std::size_t first_column = 0; first_column < width; first_column += tile_columns)
+        {
+            pool.submit([&, current, first_column, input_rows]
+                        {
+                try
+                {
+                    const std::size_t columns = std::min(tile_columns, width - first_column);
+                    const std::size_t input_first_column = first_column - std::min(halo, first_column);
+                    const std::size_t input_columns = std::min(width, first_column + columns + halo) - input_first_column;
+
+                    const image_tile tile{
+                        {{current->first_row, first_column}, {current->rows, columns}},
+                        {{current->input_first_row, input_first_column}, {input_rows, input_columns}},
+                        current->input.data() + input_first_column,
+                        width,
+                        current->output.data() + first_column,
+                        width};
+
+                    kernel(tile);
+
+                    if (--current->remaining == 0)
+                    {
+                        finish_band(*current);
+                    }
+                }
+                catch (...)
+                {
+                    {
+                        std::lock_guard lock(mutex);
+                        failed = true;
+                    }
+                    space.notify_all();
+                    throw;
+                } });
+        }
+    }
+
+    pool.wait();
+}
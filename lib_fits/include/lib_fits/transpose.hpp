@@ -0,0 +1,201 @@
+/**
+ * @file transpose.hpp
+ * @author Alina Gubeeva
+ * @brief Out-of-core transpose of cubes to pixel-major or tiled order
+ * @version 0.1
+ * @date 2024-04-10
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#pragma once
+
+// STL
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "ifits.hpp"                 // ifits
+#include "details/region.hpp"        // image_region
+#include "details/work_stealing.hpp" // work_stealing_pool
+
+/**
+ * @brief Layout and resources of transpose_cube.
+ *
+ * With blocks of 1x1 pixels the output is pixel-major: the time series of
+ * every pixel is contiguous.
+ */
+struct transpose_options
+{
+    std::size_t block_rows = 1;                         // Rows of a block of pixels
+    std::size_t block_columns = 1;                      // Columns of a block of pixels
+    std::size_t memory_budget = std::size_t(256) << 20; // Bytes of the input and output buffers of a slab
+    std::size_t threads = 1;                            // Threads reading, transposing and writing
+};
+
+/**
+ * @brief Shape of the transposed cube
+ *
+ * A cube of {frames, rows, columns} becomes {rows, columns, frames} with
+ * blocks of 1x1 pixels, and {row blocks, column blocks, frames, block rows,
+ * block columns} otherwise, the blocks at the edges being padded.
+ *
+ * @param shape Shape of the cube, slowest axis first
+ * @param options Size of the blocks
+ * @return The shape of the output HDU
+ * @throw std::runtime_error if the cube is not three-dimensional or a block size is 0
+ */
+inline std::vector<std::size_t> transposed_shape(const std::vector<std::size_t> &shape, const transpose_options &options = {})
+{
+    if (shape.size() != 3)
+    {
+        throw std::runtime_error("Transposed cubes must be three-dimensional");
+    }
+    if (options.block_rows == 0 || options.block_columns == 0)
+    {
+        throw std::runtime_error("Block sizes must be positive");
+    }
+
+    if (options.block_rows == 1 && options.block_columns == 1)
+    {
+        return {shape[1], shape[2], shape[0]};
+    }
+
+    return {(shape[1] + options.block_rows - 1) / options.block_rows,
+            (shape[2] + options.block_columns - 1) / options.block_columns,
+            shape[0], options.block_rows, options.block_columns};
+}
+
+/**
+ * @brief Rewrite a cube of frames in pixel-major or tiled order
+ *
+ * The cube is processed in slabs of whole rows of blocks, as many as the
+ * memory budget holds, or of a part of a row of blocks for wide frames.
+ * Every frame of a slab is one read (a run per row when the slab is part
+ * of the rows), the reads being spread over the threads. The slab is then
+ * transposed one row of blocks per task, in square tiles of blocks and
+ * frames that stay in the cache, and every row of blocks is written by its
+ * task with one write. Every value of the cube is read once.
+ *
+ * Padding pixels of the edge blocks are NaN, or 0 for integral outputs.
+ *
+ * @param source Cube of {frames, rows, columns}
+ * @param dest HDU of an ofits file of transposed_shape(source.get_shape(), options), e.g. out.get_hdu<0>()
+ * @param options Size of the blocks, memory budget and number of threads
+ * @throw std::runtime_error if the shapes do not match or one block does not fit in the budget
+ */
+template <class Output>
+void transpose_cube(ifits::hdu &source, Output &dest, const transpose_options &options = {})
+{
+    const auto shape = source.get_shape();
+    if (dest.get_shape() != transposed_shape(shape, options))
+    {
+        throw std::runtime_error("Output shape does not match the transposed cube");
+    }
+
+    const std::size_t frames = shape[0], height = shape[1], width = shape[2];
+    const std::size_t block_rows = options.block_rows, block_columns = options.block_columns;
+    const std::size_t row_blocks = (height + block_rows - 1) / block_rows;
+    const std::size_t column_blocks = (width + block_columns - 1) / block_columns;
+
+    if (frames == 0 || height == 0 || width == 0)
+    {
+        return;
+    }
+
+    // Bytes of the input and output buffers of the given blocks
+    auto slab_bytes = [&](std::size_t blocks)
+    {
+        return 2 * blocks * block_rows * block_columns * frames * sizeof(double);
+    };
+
+    // Slabs of whole rows of blocks when one fits, of parts of a row of blocks otherwise
+    std::size_t slab_row_blocks = options.memory_budget / std::max<std::size_t>(slab_bytes(column_blocks), 1);
+    std::size_t slab_column_blocks = column_blocks;
+    if (slab_row_blocks == 0)
+    {
+        slab_row_blocks = 1;
+        slab_column_blocks = options.memory_budget / slab_bytes(1);
+        if (slab_column_blocks == 0)
+        {
+            throw std::runtime_error("Memory budget is too small for one block of the cube");
+        }
+    }
+    slab_row_blocks = std::min(slab_row_blocks, row_blocks);
+
+    const std::size_t block_size = frames * block_rows * block_columns;
+    std::vector<double> input(std::min(slab_row_blocks * block_rows, height) * std::min(slab_column_blocks * block_columns, width) * frames);
+    std::vector<double> output(slab_row_blocks * slab_column_blocks * block_size);
+
+    work_stealing_pool pool(options.threads);
+
+    for (std::size_t first_row_block = 0; first_row_block < row_blocks; first_row_block += slab_row_blocks)
+    {
+        for (std::size_t first_column_block = 0; first_column_block < column_blocks; first_column_block += slab_column_blocks)
+        {
+            const std::size_t row_block_count = std::min(slab_row_blocks, row_blocks - first_row_block);
+            const std::size_t column_block_count = std::min(slab_column_blocks, column_blocks - first_column_block);
+
+            const std::size_t first_row = first_row_block * block_rows;
+            const std::size_t first_column = first_column_block * block_columns;
+            const std::size_t rows = std::min(row_block_count * block_rows, height - first_row);
+            const std::size_t columns = std::min(column_block_count * block_columns, width - first_column);
+            const std::size_t frame_size = rows * columns;
+
+            for (std::size_t frame = 0; frame < frames; ++frame)
+            {
+                pool.submit([&, frame, first_row, first_column, rows, columns, frame_size]
+                            { source.read_as(image_region{{frame, first_row, first_column}, {1, rows, columns}},
+                                             std::span(input.data() + frame * frame_size, frame_size)); });
+            }
+            pool.wait();
+
+            for (std::size_t row_block = 0; row_block < row_block_count; ++row_block)
+            {
+                pool.submit([&, row_block, first_row_block, first_column_block, column_block_count, rows, columns, frame_size]
+                            {
+                    constexpr std::size_t kTile = 32; // Blocks and frames of a tile of the transpose
+                    constexpr double kPadding = std::numeric_limits<double>::quiet_NaN();
+
+                    double *out = output.data() + row_block * column_block_count * block_size;
+
+                    for (std::size_t first_frame = 0; first_frame < frames; first_frame += kTile)
+                    {
+                        const std::size_t last_frame = std::min(frames, first_frame + kTile);
+
+                        for (std::size_t first_block = 0; first_block < column_block_count; first_block += kTile)
+                        {
+                            const std::size_t last_block = std::min(column_block_count, first_block + kTile);
+
+                            for (std::size_t block = first_block; block < last_block; ++block)
+                            {
+                                for (std::size_t frame = first_frame; frame < last_frame; ++frame)
+                                {
+                                    double *values = out + (block * frames + frame) * block_rows * block_columns;
+                                    const double *frame_values = input.data() + frame * frame_size;
+
+                                    for (std::size_t dy = 0; dy < block_rows; ++dy)
+                                    {
+                                        const std::size_t y = row_block * block_rows + dy;
+                                        for (std::size_t dx = 0; dx < block_columns; ++dx)
+                                        {
+                                            const std::size_t x = block * block_columns + dx;
+                                            values[dy * block_columns + dx] = y < rows && x < columns ? frame_values[y * columns + x] : kPadding;
+                                        }
+                                    }
+                                }
+                            }
+                        }
+                    }
+
+                    dest.write_data({first_row_block + row_block, first_column_block},
+                                    std::span<const double>(out, column_block_count * block_size)); });
+            }
+            pool.wait();
+        }
+    }
+}
@@ -0,0 +1,368 @@
+// Performance regression tests
+//
+// Every test measures a lib_fits throughput and the throughput of the same
+// I/O done with plain pread() on the same machine, and compares the ratio
+// lib_fits / pread with the baseline ratio in baselines.txt. A test fails if
+// the ratio drops more than the tolerance (default 25%) below its baseline,
+// so the check does not depend on the speed of the machine.
+//
+// Environment:
+//   LIB_FITS_PERF_TOLERANCE  allowed relative drop, e.g. 0.4 for 40%
+//   LIB_FITS_PERF_DIR        directory of the scratch files (default: temp directory)
+//
+// The measured ratios are printed, copy them to baselines.txt to rebaseline.
+
+#include <gtest/gtest.h>
+#include <lib_fits.hpp>
+
+// STL
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// POSIX
+#include <fcntl.h>
+#include <unistd.h>
+
+// Boost
+#include <boost/asio.hpp>
+
+// Path to the baseline ratios
+#ifndef PERF_BASELINES
+#define PERF_BASELINES "../perf/baselines.txt"
+#endif
+
+namespace
+{
+    /**
+     * @brief Number of measurements of each throughput, the best one is kept.
+     */
+    constexpr int kRepetitions = 9;
+
+    /**
+     * @brief Baseline ratios read from baselines.txt.
+     */
+    const std::map<std::string, double> &baselines()
+    {
+        static const auto ratios = []
+        {
+            std::map<std::string, double> ratios;
+            std::ifstream file(PERF_BASELINES);
+            if (!file)
+            {
+                throw std::runtime_error("Cannot open " PERF_BASELINES);
+            }
+
+            std::string line;
+            while (std::getline(file, line))
+            {
+                if (line.empty() || line[0] == '#')
+                {
+                    continue;
+                }
+                std::istringstream iss(line);
+                std::string name;
+                double ratio = 0;
+                if (iss >> name >> ratio)
+                {
+                    ratios[name] = ratio;
+                }
+            }
+            return ratios;
+        }();
+        return ratios;
+    }
+
+    /**
+     * @brief Allowed relative drop of a ratio below its baseline.
+     */
+    double tolerance()
+    {
+        const char *value = std::getenv("LIB_FITS_PERF_TOLERANCE");
+        return value ? std::stod(value) : 0.25;
+    }
+
+    /**
+     * @brief Path of a scratch file, removed first because ofits does not truncate.
+     */
+    std::filesystem::path scratch_file(const std::string &name)
+    {
+        const char *dir = std::getenv("LIB_FITS_PERF_DIR");
+        auto path = (dir ? std::filesystem::path(dir) : std::filesystem::temp_directory_path()) / ("lib_fits_perf_" + name);
+        std::filesystem::remove(path);
+        return path;
+    }
+
+    /**
+     * @brief Best throughputs of lib_fits and of the pread reference.
+     *
+     * The runs alternate so that noise of the machine affects both sides.
+     *
+     * @param units Units (bytes, pixels, operations) processed by one run
+     * @return Units per second of lib_fits and of the reference
+     */
+    std::pair<double, double> best_rates(const std::function<void()> &lib_fits_run, const std::function<void()> &pread_run, double units)
+    {
+        // Warm up the page cache and the allocator
+        lib_fits_run();
+        pread_run();
+
+        auto rate = [units](const std::function<void()> &run)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            run();
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            return units / elapsed.count();
+        };
+
+        double lib_fits_best = 0, pread_best = 0;
+        for (int i = 0; i < kRepetitions; ++i)
+        {
+            lib_fits_best = std::max(lib_fits_best, rate(lib_fits_run));
+            pread_best = std::max(pread_best, rate(pread_run));
+        }
+        return {lib_fits_best, pread_best};
+    }
+
+    /**
+     * @brief Compare the ratio of two throughputs with its baseline.
+     */
+    void check_ratio(const std::string &name, std::pair<double, double> rates)
+    {
+        const auto [lib_fits_rate, pread_rate] = rates;
+        const double ratio = lib_fits_rate / pread_rate;
+
+        std::printf("%-16s %.4f  (lib_fits %.4g/s, pread %.4g/s)\n", name.c_str(), ratio, lib_fits_rate, pread_rate);
+
+        const auto it = baselines().find(name);
+        ASSERT_NE(it, baselines().end()) << "No baseline for " << name;
+
+        EXPECT_GE(ratio, it->second * (1 - tolerance()))
+            << name << " regressed: ratio " << ratio << ", baseline " << it->second;
+    }
+
+    /**
+     * @brief File opened with POSIX open() for the reference reads.
+     */
+    class posix_file
+    {
+    public:
+        explicit posix_file(const std::filesystem::path &filename) : fd_(::open(filename.c_str(), O_RDONLY))
+        {
+            if (fd_ < 0)
+            {
+                throw std::runtime_error("Cannot open " + filename.string());
+            }
+        }
+
+        ~posix_file()
+        {
+            ::close(fd_);
+        }
+
+        posix_file(const posix_file &) = delete;
+        posix_file &operator=(const posix_file &) = delete;
+
+        void read_at(std::uint64_t offset, void *data, std::size_t size) const
+        {
+            if (::pread(fd_, data, size, static_cast<off_t>(offset)) != static_cast<ssize_t>(size))
+            {
+                throw std::runtime_error("pread failed");
+            }
+        }
+
+    private:
+        int fd_;
+    };
+} // namespace
+
+// Header parse MB/s: ifits opening a file with a 20-block header, against
+// reading the same header with one pread per block
+TEST(perf, header_parse)
+{
+    constexpr std::size_t kBlocks = 20;
+    constexpr std::size_t kCards = kBlocks * 36 - 8; // Room for the mandatory keywords and END
+
+    const auto filename = scratch_file("header.fits");
+    {
+        ofits<float> file(filename, {{{16, 16}}}, kBlocks);
+        for (std::size_t i = 0; i < kCards; ++i)
+        {
+            char key[9];
+            std::snprintf(key, sizeof(key), "KEY%05zu", i);
+            file.value_as<0>(key, std::to_string(i));
+        }
+        std::vector<float> data(16 * 16);
+        file.write_data<0>({0}, boost::asio::buffer(data));
+    }
+
+    auto parse = [&]
+    {
+        ifits file(filename);
+        if (file.get_hdus().front().get_headers().size() < kCards)
+        {
+            throw std::runtime_error("Header not parsed");
+        }
+    };
+
+    auto reference = [&]
+    {
+        posix_file file(filename);
+        char block[2880];
+        for (std::size_t i = 0; i < kBlocks; ++i)
+        {
+            file.read_at(i * sizeof(block), block, sizeof(block));
+        }
+    };
+
+    check_ratio("header_parse", best_rates(parse, reference, kBlocks * 2880));
+}
+
+// Pixels/s: reading a 1024x1024 float image row by row, against pread of the
+// same rows. The library stores pixels in native byte order without scaling,
+// so this is the whole decode path.
+TEST(perf, image_read)
+{
+    constexpr std::size_t kSide = 1024;
+
+    const auto filename = scratch_file("image.fits");
+    {
+        ofits<float> file(filename, {{{kSide, kSide}}});
+        std::vector<float> data(kSide * kSide, 1.0f);
+        file.write_data<0>({0}, boost::asio::buffer(data));
+    }
+
+    ifits file(filename);
+    auto image = ifits::hdu::image_hdu<float>(file.get_hdu<0>());
+    posix_file raw(filename);
+
+    std::vector<float> row(kSide);
+
+    auto read = [&]
+    {
+        for (std::size_t y = 0; y < kSide; ++y)
+        {
+            image.read_data({y}, boost::asio::buffer(row));
+        }
+    };
+
+    auto reference = [&]
+    {
+        for (std::size_t y = 0; y < kSide; ++y)
+        {
+            raw.read_at(2880 + y * kSide * sizeof(float), row.data(), kSide * sizeof(float));
+        }
+    };
+
+    check_ratio("image_read", best_rates(read, reference, kSide * kSide));
+}
+
+// Ops/s: random single-pixel reads, against pread of the same pixels
+TEST(perf, small_read)
+{
+    constexpr std::size_t kSide = 1024;
+    constexpr std::size_t kReads = 20000;
+
+    const auto filename = scratch_file("small.fits");
+    {
+        ofits<float> file(filename, {{{kSide, kSide}}});
+        std::vector<float> data(kSide * kSide, 1.0f);
+        file.write_data<0>({0}, boost::asio::buffer(data));
+    }
+
+    std::vector<std::size_t> positions(kReads);
+    std::uint64_t state = 0x9e3779b97f4a7c15ull;
+    for (auto &position : positions)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        position = state % (kSide * kSide);
+    }
+
+    ifits file(filename);
+    auto image = ifits::hdu::image_hdu<float>(file.get_hdu<0>());
+    posix_file raw(filename);
+
+    float value = 0;
+
+    auto read = [&]
+    {
+        for (auto position : positions)
+        {
+            image.read_data({position / kSide, position % kSide}, boost::asio::buffer(&value, sizeof(value)));
+        }
+    };
+
+    auto reference = [&]
+    {
+        for (auto position : positions)
+        {
+            raw.read_at(2880 + position * sizeof(float), &value, sizeof(value));
+        }
+    };
+
+    check_ratio("small_read", best_rates(read, reference, kReads));
+}
+
+// Pixels/s for scaling: reading a 1024x1024 int16 image with BSCALE and
+// BZERO into floats with read_as, row by row, against pread of the same rows
+// followed by a plain scaling loop
+TEST(perf, scaled_read)
+{
+    constexpr std::size_t kSide = 1024;
+    constexpr double kScale = 0.5, kZero = 100.0;
+
+    const auto filename = scratch_file("scaled.fits");
+    {
+        ofits<std::int16_t> file(filename, {{{kSide, kSide}}});
+        file.value_as<0>("BSCALE", "0.5");
+        file.value_as<0>("BZERO", "100");
+        std::vector<std::int16_t> data(kSide * kSide);
+        for (std::size_t i = 0; i < data.size(); ++i)
+        {
+            data[i] = static_cast<std::int16_t>(i % 65536 - 32768);
+        }
+        file.write_data<0>({0}, boost::asio::buffer(data));
+    }
+
+    ifits file(filename);
+    auto &hdu = file.get_hdu<0>();
+    posix_file raw(filename);
+
+    std::vector<std::int16_t> stored(kSide);
+    std::vector<float> row(kSide);
+
+    auto read = [&]
+    {
+        for (std::size_t y = 0; y < kSide; ++y)
+        {
+            hdu.read_as(image_region{{y, 0}, {1, kSide}}, std::span(row));
+        }
+    };
+
+    auto reference = [&]
+    {
+        for (std::size_t y = 0; y < kSide; ++y)
+        {
+            raw.read_at(2880 + y * kSide * sizeof(std::int16_t), stored.data(), kSide * sizeof(std::int16_t));
+            for (std::size_t x = 0; x < kSide; ++x)
+            {
+                row[x] = static_cast<float>(stored[x] * kScale + kZero);
+            }
+        }
+    };
+
+    check_ratio("scaled_read", best_rates(read, reference, kSide * kSide));
+}
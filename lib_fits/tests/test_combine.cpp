@@ -0,0 +1,135 @@
+// Unit tests for combine_images
+
+#include <gtest/gtest.h>
+#include <lib_fits.hpp>
+#include <boost/asio.hpp>
+
+// Path to the data used in the unit tests
+#define DATA_ROOT "../data"
+
+// Test the combinations of five frames against values computed per pixel
+TEST(test_combine, check_modes)
+{
+    const std::size_t height = 13, width = 11, frames = 5;
+
+    // Frame f holds pixel + f, frame 4 has an outlier at pixel 7, pixel 20 is NaN in two frames
+    std::vector<std::vector<float>> pixels(frames, std::vector<float>(height * width));
+    for (std::size_t f = 0; f < frames; ++f)
+    {
+        for (std::size_t i = 0; i < height * width; ++i)
+        {
+            pixels[f][i] = static_cast<float>(i + f);
+        }
+        const std::string name = DATA_ROOT "/combine_" + std::to_string(f) + ".fits";
+        std::filesystem::remove(name);
+    }
+    pixels[4][7] = 1000;
+    pixels[1][20] = pixels[3][20] = std::numeric_limits<float>::quiet_NaN();
+    for (std::size_t f = 0; f < frames; ++f)
+    {
+        pixels[f][30] = std::numeric_limits<float>::quiet_NaN();
+    }
+
+    std::vector<std::unique_ptr<ifits>> files;
+    std::vector<ifits::hdu *> inputs;
+    for (std::size_t f = 0; f < frames; ++f)
+    {
+        const std::string name = DATA_ROOT "/combine_" + std::to_string(f) + ".fits";
+        {
+            ofits<float> file{name, {{{height, width}}}};
+            file.write_data<0>({0}, boost::asio::buffer(pixels[f]));
+        }
+        files.push_back(std::make_unique<ifits>(name));
+        inputs.push_back(&files.back()->get_hdu<0>());
+    }
+
+    auto combined = [&](combine_mode mode)
+    {
+        std::filesystem::remove(DATA_ROOT "/combined.fits");
+        {
+            ofits<double> out{DATA_ROOT "/combined.fits", {{{height, width}}}};
+            combine_options options;
+            options.mode = mode;
+            options.band_rows = 4;
+            options.sigma = 1.5;
+            options.threads = 3;
+            combine_images(inputs, out.get_hdu<0>(), options);
+        }
+
+        ifits result(DATA_ROOT "/combined.fits");
+        std::vector<double> values(height * width);
+        ifits::hdu::image_hdu<double>(result.get_hdu<0>()).read_data({0}, boost::asio::buffer(values));
+        return values;
+    };
+
+    const auto mean = combined(combine_mode::mean);
+    EXPECT_DOUBLE_EQ(mean[0], 2);
+    EXPECT_DOUBLE_EQ(mean[7], (7 + 8 + 9 + 10 + 1000) / 5.0);
+    EXPECT_DOUBLE_EQ(mean[20], (20 + 22 + 24) / 3.0);
+    EXPECT_TRUE(std::isnan(mean[30]));
+    EXPECT_DOUBLE_EQ(mean[height * width - 1], height * width + 1);
+
+    const auto median = combined(combine_mode::median);
+    EXPECT_DOUBLE_EQ(median[0], 2);
+    EXPECT_DOUBLE_EQ(median[7], 9);
+    EXPECT_DOUBLE_EQ(median[20], 22);
+    EXPECT_TRUE(std::isnan(median[30]));
+
+    // The outlier is clipped, the other pixels keep all their values
+    const auto clipped = combined(combine_mode::sigma_clip);
+    EXPECT_DOUBLE_EQ(clipped[0], 2);
+    EXPECT_DOUBLE_EQ(clipped[7], (7 + 8 + 9 + 10) / 4.0);
+    EXPECT_DOUBLE_EQ(clipped[20], 22);
+    EXPECT_TRUE(std::isnan(clipped[30]));
+
+    // Even number of values
+    inputs.pop_back();
+    const auto even = combined(combine_mode::median);
+    EXPECT_DOUBLE_EQ(even[0], 1.5);
+    EXPECT_DOUBLE_EQ(even[20], 21);
+
+    ofits<float> other{DATA_ROOT "/combined.fits", {{{height, width + 1}}}};
+    EXPECT_THROW(combine_images(inputs, other.get_hdu<0>()), std::runtime_error);
+}
+
+// Test sigma clipping of identical values that are not representable
+TEST(test_combine, check_constant_stack)
+{
+    const std::size_t frames = 3;
+    std::vector<double> pixels(4 * 4, 0.1);
+
+    std::vector<std::unique_ptr<ifits>> files;
+    std::vector<ifits::hdu *> inputs;
+    for (std::size_t f = 0; f < frames; ++f)
+    {
+        const std::string name = DATA_ROOT "/combine_constant_" + std::to_string(f) + ".fits";
+        std::filesystem::remove(name);
+        {
+            ofits<double> file{name, {{{4, 4}}}};
+            file.write_data<0>({0}, boost::asio::buffer(pixels));
+        }
+        files.push_back(std::make_unique<ifits>(name));
+        inputs.push_back(&files.back()->get_hdu<0>());
+    }
+
+    // A threshold of 0 would reject every value, the bounds before it are kept
+    for (double sigma : {3.0, 0.0})
+    {
+        std::filesystem::remove(DATA_ROOT "/combined_constant.fits");
+        {
+            ofits<double> out{DATA_ROOT "/combined_constant.fits", {{{4, 4}}}};
+            combine_options options;
+            options.mode = combine_mode::sigma_clip;
+            options.sigma = sigma;
+            combine_images(inputs, out.get_hdu<0>(), options);
+        }
+
+        ifits result(DATA_ROOT "/combined_constant.fits");
+        std::vector<double> values(4 * 4);
+        ifits::hdu::image_hdu<double>(result.get_hdu<0>()).read_data({0}, boost::asio::buffer(values));
+        for (const double value : values)
+        {
+            EXPECT_DOUBLE_EQ(value, 0.1) << sigma;
+        }
+    }
+}
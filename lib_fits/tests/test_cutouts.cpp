@@ -0,0 +1,93 @@
+// Unit tests for read_cutouts
+
+#include <gtest/gtest.h>
+#include <lib_fits.hpp>
+#include <boost/asio.hpp>
+
+// Path to the data used in the unit tests
+#define DATA_ROOT "../data"
+
+// Test a batch of overlapping cutouts from two files and three HDUs, in random order
+TEST(test_cutouts, check_batch)
+{
+    std::filesystem::remove(DATA_ROOT "/cutouts_a.fits");
+    std::filesystem::remove(DATA_ROOT "/cutouts_b.fits");
+
+    std::vector<std::int16_t> scaled(40 * 50);
+    std::vector<float> floats(30 * 60), cube(3 * 20 * 25);
+    for (std::size_t i = 0; i < scaled.size(); ++i)
+    {
+        scaled[i] = static_cast<std::int16_t>(i * 7 % 1000) - 500;
+    }
+    for (std::size_t i = 0; i < floats.size(); ++i)
+    {
+        floats[i] = 0.25f * static_cast<float>(i);
+    }
+    for (std::size_t i = 0; i < cube.size(); ++i)
+    {
+        cube[i] = -static_cast<float>(i);
+    }
+
+    {
+        ofits<std::int16_t, float> file{DATA_ROOT "/cutouts_a.fits", {{{40, 50}, {30, 60}}}};
+        file.value_as<0>("BSCALE", "0.5");
+        file.value_as<0>("BZERO", "10");
+        file.write_data<0>({0}, boost::asio::buffer(scaled));
+        file.write_data<1>({0}, boost::asio::buffer(floats));
+    }
+    {
+        ofits<float> file{DATA_ROOT "/cutouts_b.fits", {{{3, 20, 25}}}};
+        file.write_data<0>({0}, boost::asio::buffer(cube));
+    }
+
+    auto metrics = std::make_shared<io_metrics>();
+    ifits a(DATA_ROOT "/cutouts_a.fits", metrics);
+    ifits b(DATA_ROOT "/cutouts_b.fits");
+    std::vector<ifits::hdu *> sources{&a.get_hdu(0), &a.get_hdu(1), &b.get_hdu(0)};
+
+    // Overlapping stamps of every HDU, shuffled
+    std::vector<image_region> regions;
+    std::vector<std::size_t> indices;
+    for (std::size_t k = 0; k < 60; ++k)
+    {
+        const std::size_t source = k % 3;
+        const std::size_t y = k * 13 % 12, x = k * 17 % 20;
+        regions.push_back(source == 2 ? image_region{{k % 3, y, x}, {1, 5, 4}} : image_region{{y, x}, {6, 5}});
+        indices.push_back(source);
+    }
+
+    for (const cutout_options &options : {cutout_options{}, cutout_options{0, 64, 1}, cutout_options{std::size_t(1) << 20, std::size_t(1) << 20, 2}})
+    {
+        std::vector<std::vector<double>> cutouts(regions.size());
+        std::vector<cutout_request> requests;
+        for (std::size_t k = regions.size(); k-- > 0;)
+        {
+            cutouts[k].assign(regions[k].size(), -1.0);
+            requests.push_back({sources[indices[k]], regions[k], std::span(cutouts[k])});
+        }
+
+        metrics->reset();
+        read_cutouts(requests, options);
+        const auto read = metrics->snapshot();
+
+        for (std::size_t k = 0; k < regions.size(); ++k)
+        {
+            std::vector<double> expected(regions[k].size());
+            sources[indices[k]]->read_as(regions[k], std::span(expected));
+            EXPECT_EQ(cutouts[k], expected) << k;
+        }
+
+        // One read per HDU when nothing limits the merging
+        if (options.max_gap == std::size_t(1) << 20)
+        {
+            EXPECT_EQ(read.read_syscalls, 2);
+        }
+    }
+
+    std::vector<double> small(3);
+    const std::vector<cutout_request> too_small{{sources[0], image_region{{0, 0}, {2, 2}}, std::span(small)}};
+    EXPECT_THROW(read_cutouts(too_small), std::runtime_error);
+    std::vector<double> single(4);
+    const std::vector<cutout_request> outside{{sources[0], image_region{{39, 0}, {2, 2}}, std::span(single)}};
+    EXPECT_THROW(read_cutouts(outside), std::runtime_error);
+}
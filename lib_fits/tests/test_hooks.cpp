@@ -0,0 +1,130 @@
+// Unit tests for io_hook
+
+#include <gtest/gtest.h>
+#include <lib_fits.hpp>
+#include <boost/asio.hpp>
+
+// Path to the data used in the unit tests
+#define DATA_ROOT "../data"
+
+// Test the events reported while writing and reading a file with two HDUs
+TEST(test_hooks, check_events)
+{
+    if constexpr (!kLibFitsHooks)
+    {
+        GTEST_SKIP() << "Hooks are compiled out";
+    }
+
+    std::vector<io_event> written;
+
+    std::vector<float> data(100, 1.0f);
+
+    {
+        ofits<float, float> file{DATA_ROOT "/hooks.fits", {{{10, 100}, {10, 100}}}, 1, nullptr, [&](const io_event &event)
+                                 { written.push_back(event); }};
+
+        file.write_data<1>({3}, boost::asio::buffer(data));
+    }
+
+    ASSERT_FALSE(written.empty());
+
+    // The last event is the data write into the second HDU
+    const auto &data_write = written.back();
+    EXPECT_EQ(data_write.operation, io_operation::write);
+    EXPECT_EQ(data_write.hdu, 1);
+    EXPECT_EQ(data_write.length, data.size() * sizeof(float));
+    EXPECT_LE(data_write.start, data_write.end);
+    EXPECT_FALSE(data_write.ec);
+
+    std::size_t flushes[2] = {0, 0};
+    for (const auto &event : written)
+    {
+        if (event.operation == io_operation::header_flush)
+        {
+            ++flushes[event.hdu];
+        }
+    }
+    EXPECT_EQ(flushes[0], 1);
+    EXPECT_EQ(flushes[1], 1);
+
+    std::vector<io_event> read;
+
+    ifits file(DATA_ROOT "/hooks.fits", nullptr, [&](const io_event &event)
+               { read.push_back(event); });
+
+    std::size_t parsed = 0;
+    for (const auto &event : read)
+    {
+        if (event.operation == io_operation::header_parse)
+        {
+            EXPECT_EQ(event.hdu, parsed);
+            EXPECT_EQ(event.length, 2880);
+            ++parsed;
+        }
+        else
+        {
+            EXPECT_EQ(event.operation, io_operation::read);
+        }
+    }
+    EXPECT_EQ(parsed, 2);
+
+    read.clear();
+
+    std::vector<float> buffer(100);
+    ifits::hdu::image_hdu<float>(file.get_hdu<1>()).read_data({3}, boost::asio::buffer(buffer));
+
+    ASSERT_EQ(read.size(), 1);
+    EXPECT_EQ(read[0].operation, io_operation::read);
+    EXPECT_EQ(read[0].hdu, 1);
+    EXPECT_EQ(read[0].length, buffer.size() * sizeof(float));
+    EXPECT_EQ(buffer, data);
+}
+
+// Test the HDU index of the events of a file with three HDUs, whatever the order in which ofits builds them
+TEST(test_hooks, check_hdu_indices)
+{
+    if constexpr (!kLibFitsHooks)
+    {
+        GTEST_SKIP() << "Hooks are compiled out";
+    }
+
+    std::filesystem::remove(DATA_ROOT "/hooks3.fits");
+
+    std::vector<io_event> written;
+    std::vector<float> data(100, 2.0f);
+
+    {
+        ofits<float, float, float> file{DATA_ROOT "/hooks3.fits", {{{10, 100}, {10, 100}, {10, 100}}}, 1, nullptr, [&](const io_event &event)
+                                        { written.push_back(event); }};
+
+        file.write_data<0>({1}, boost::asio::buffer(data));
+        file.write_data<1>({2}, boost::asio::buffer(data));
+        file.write_data<2>({3}, boost::asio::buffer(data));
+    }
+
+    // Every HDU takes one header block and two data blocks
+    const std::uint64_t hdu_size = 3 * 2880;
+
+    std::size_t flushes[3] = {0, 0, 0};
+    std::size_t writes[3] = {0, 0, 0};
+    for (const auto &event : written)
+    {
+        ASSERT_LT(event.hdu, 3);
+        EXPECT_EQ(event.hdu, event.offset / hdu_size) << event.offset;
+
+        if (event.operation == io_operation::header_flush)
+        {
+            EXPECT_EQ(event.offset, event.hdu * hdu_size);
+            ++flushes[event.hdu];
+        }
+        else if (event.operation == io_operation::write && event.length == data.size() * sizeof(float))
+        {
+            ++writes[event.hdu];
+        }
+    }
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+        EXPECT_EQ(flushes[i], 1) << i;
+        EXPECT_EQ(writes[i], 1) << i;
+    }
+}
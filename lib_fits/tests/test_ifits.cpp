@@ -194,3 +194,422 @@ TEST(test_ifits, check_read_data)
             }
         }); });
 }
+
+// Test that a stopped io_context only runs again after restart()
+TEST(test_ifits, check_run_after_stop)
+{
+    ifits example_fits(DATA_ROOT "/example.fits");
+    ifits::hdu::image_hdu<std::int16_t> image(example_fits.get_hdu<0>());
+
+    std::vector<std::int16_t> buffer(10);
+    bool done = false;
+    auto read = [&]
+    {
+        image.async_read_data({1, 2}, boost::asio::buffer(buffer), [&](const boost::system::error_code &error, std::size_t)
+                              { done = !error; });
+    };
+
+    example_fits.stop();
+    read();
+    example_fits.run();
+    EXPECT_FALSE(done);
+
+    example_fits.restart();
+    example_fits.run();
+    EXPECT_TRUE(done);
+
+    // A context that ran out of work needs a restart too
+    done = false;
+    read();
+    example_fits.restart();
+    example_fits.run();
+    EXPECT_TRUE(done);
+    EXPECT_EQ(buffer[0], 1);
+}
+
+// Test the memory accounting of the HDUs and of the file
+TEST(test_ifits, check_memory_usage)
+{
+    ifits movie64_fits(DATA_ROOT "/movie-64.fits");
+
+    memory_usage sum;
+    for (const auto &hdu : movie64_fits.get_hdus())
+    {
+        auto usage = hdu.get_memory_usage();
+
+        // Every keyword costs at least its hash node
+        EXPECT_GE(usage.headers, hdu.get_headers().size() * sizeof(std::pair<const std::string, std::string>));
+        EXPECT_GT(usage.index, 0);
+        EXPECT_EQ(usage.total(), usage.headers + usage.index + usage.caches + usage.objects);
+
+        sum += usage;
+    }
+
+    auto total = movie64_fits.get_memory_usage();
+
+    EXPECT_EQ(total.headers, sum.headers);
+    EXPECT_GT(total.objects, sum.objects);
+    EXPECT_GT(total.total(), sum.total());
+
+    // Long values live on the heap, short ones in the string object
+    EXPECT_EQ(memory_usage::heap_bytes(std::string("T")), 0);
+    EXPECT_GE(memory_usage::heap_bytes(std::string(100, 'x')), 101);
+}
+
+// Test reading regions converted to other types
+TEST(test_ifits, check_read_as)
+{
+    std::filesystem::remove(DATA_ROOT "/read_as.fits");
+
+    // Stored values i - 30 at the element i of a 3x4x5 cube
+    std::vector<std::int16_t> stored(60);
+    for (std::size_t i = 0; i < stored.size(); ++i)
+    {
+        stored[i] = static_cast<std::int16_t>(i) - 30;
+    }
+
+    {
+        ofits<std::int16_t> file{DATA_ROOT "/read_as.fits", {{{3, 4, 5}}}};
+        file.value_as<0>("BSCALE", "0.5");
+        file.value_as<0>("BZERO", "100");
+        file.write_data<0>({0}, boost::asio::buffer(stored));
+    }
+
+    ifits ifits_file(DATA_ROOT "/read_as.fits");
+    auto &hdu = ifits_file.get_hdu<0>();
+
+    EXPECT_EQ(hdu.get_shape(), (std::vector<std::size_t>{3, 4, 5}));
+
+    // Whole image with BSCALE and BZERO
+    std::vector<float> physical(60);
+    hdu.read_as(image_region::whole(hdu.get_shape()), std::span(physical));
+    for (std::size_t i = 0; i < physical.size(); ++i)
+    {
+        EXPECT_FLOAT_EQ(physical[i], 100.0f + 0.5f * stored[i]);
+    }
+
+    // Sub-cube of the stored values, runs of 3 elements
+    std::vector<double> raw(12);
+    hdu.read_as(image_region{{1, 1, 1}, {2, 2, 3}}, std::span(raw), pixel_scaling{});
+    std::size_t position = 0;
+    for (std::size_t a = 1; a < 3; ++a)
+    {
+        for (std::size_t b = 1; b < 3; ++b)
+        {
+            for (std::size_t c = 1; c < 4; ++c)
+            {
+                EXPECT_EQ(raw[position++], stored[a * 20 + b * 5 + c]);
+            }
+        }
+    }
+
+    // Whole rows, read directly without conversion
+    std::vector<std::int16_t> rows(10);
+    hdu.read_as(image_region{{2, 2, 0}, {1, 2, 5}}, std::span(rows), pixel_scaling{});
+    EXPECT_TRUE(std::equal(rows.begin(), rows.end(), stored.begin() + 50));
+
+    // Negative values saturate to 0, or throw
+    std::vector<std::uint8_t> narrow(60);
+    hdu.read_as(image_region::whole(hdu.get_shape()), std::span(narrow), pixel_scaling{});
+    EXPECT_EQ(narrow[0], 0);
+    EXPECT_EQ(narrow[59], 29);
+    EXPECT_THROW(hdu.read_as(image_region::whole(hdu.get_shape()), std::span(narrow), pixel_scaling{}, overflow_policy::error),
+                 std::overflow_error);
+
+    // Scaled values round to the nearest integer
+    std::vector<std::int32_t> rounded(60);
+    hdu.read_as(image_region::whole(hdu.get_shape()), std::span(rounded));
+    EXPECT_EQ(rounded[1], 86);  // 100 + 0.5 * -29 = 85.5
+    EXPECT_EQ(rounded[59], 115); // 100 + 0.5 * 29 = 114.5
+
+    EXPECT_THROW(hdu.read_as(image_region{{0, 0, 1}, {1, 1, 5}}, std::span(raw)), std::runtime_error);
+    EXPECT_THROW(hdu.read_as(image_region{{0, 0}, {1, 1}}, std::span(raw)), std::runtime_error);
+    EXPECT_THROW(hdu.read_as(image_region::whole(hdu.get_shape()), std::span(raw)), std::runtime_error);
+}
+
+// Test display limits estimated from sampled pixels
+TEST(test_ifits, check_display_limits)
+{
+    std::filesystem::remove(DATA_ROOT "/display_limits.fits");
+
+    // Values spread over 0..999 with bright outliers and NaN
+    std::vector<float> pixels(400 * 500);
+    for (std::size_t i = 0; i < pixels.size(); ++i)
+    {
+        pixels[i] = static_cast<float>(i * 7919 % 1000);
+        if (i % 97 == 0)
+        {
+            pixels[i] = 1e6f;
+        }
+        if (i % 101 == 0)
+        {
+            pixels[i] = std::numeric_limits<float>::quiet_NaN();
+        }
+    }
+
+    {
+        ofits<float> file{DATA_ROOT "/display_limits.fits", {{{400, 500}}}};
+        file.write_data<0>({0}, boost::asio::buffer(pixels));
+    }
+
+    ifits ifits_file(DATA_ROOT "/display_limits.fits");
+    auto &hdu = ifits_file.get_hdu<0>();
+
+    const auto sample = hdu.sample_pixels(10000);
+    EXPECT_GT(sample.size(), 9000);
+    EXPECT_LE(sample.size(), 10000);
+    EXPECT_TRUE(std::all_of(sample.begin(), sample.end(), [](float value)
+                            { return std::isfinite(value); }));
+
+    // Small images are read whole
+    EXPECT_EQ(hdu.sample_pixels(pixels.size()).size(), pixels.size() - (pixels.size() + 100) / 101);
+
+    // The runs read concurrently land in file order
+    std::filesystem::remove(DATA_ROOT "/display_order.fits");
+    std::vector<float> indices(300 * 200);
+    std::iota(indices.begin(), indices.end(), 0.0f);
+    {
+        ofits<float> file{DATA_ROOT "/display_order.fits", {{{300, 200}}}};
+        file.write_data<0>({0}, boost::asio::buffer(indices));
+    }
+    ifits order_file(DATA_ROOT "/display_order.fits");
+    const auto ordered = order_file.get_hdu<0>().sample_pixels(2000);
+    EXPECT_GT(ordered.size(), 1500);
+    EXPECT_TRUE(std::adjacent_find(ordered.begin(), ordered.end(), std::greater_equal<float>()) == ordered.end());
+
+    const display_limits percentiles = hdu.percentile_limits(1, 95);
+    EXPECT_NEAR(percentiles.low, 10, 15);
+    EXPECT_NEAR(percentiles.high, 950, 30);
+
+    const display_limits zscale = hdu.zscale();
+    EXPECT_GE(zscale.low, 0);
+    EXPECT_LT(zscale.high, 1e5);
+    EXPECT_LT(zscale.low, zscale.high);
+
+    // Percentiles of a known sample, interpolated between ranks
+    std::vector<float> values = {5, 1, 4, 2, 3};
+    EXPECT_DOUBLE_EQ(sample_percentile(values, 50), 3);
+    EXPECT_DOUBLE_EQ(sample_percentile(values, 12.5), 1.5);
+    EXPECT_DOUBLE_EQ(sample_percentile(values, 100), 5);
+
+    // A line without outliers spans the range of the sample
+    std::vector<float> line(1000);
+    for (std::size_t i = 0; i < line.size(); ++i)
+    {
+        line[i] = static_cast<float>(i);
+    }
+    const display_limits limits = zscale_limits(line);
+    EXPECT_DOUBLE_EQ(limits.low, 0);
+    EXPECT_DOUBLE_EQ(limits.high, 999);
+}
+
+// Test binned reads with partial edge bins
+TEST(test_ifits, check_read_binned)
+{
+    std::filesystem::remove(DATA_ROOT "/binned.fits");
+
+    // Two planes of 5x7 pixels, value i at the element i, one NaN
+    std::vector<float> pixels(2 * 5 * 7);
+    for (std::size_t i = 0; i < pixels.size(); ++i)
+    {
+        pixels[i] = static_cast<float>(i);
+    }
+    pixels[8] = std::numeric_limits<float>::quiet_NaN();
+
+    {
+        ofits<float> file{DATA_ROOT "/binned.fits", {{{2, 5, 7}}}};
+        file.write_data<0>({0}, boost::asio::buffer(pixels));
+    }
+
+    ifits ifits_file(DATA_ROOT "/binned.fits");
+    auto &hdu = ifits_file.get_hdu<0>();
+
+    const binning bins{2, 3, bin_mode::sum, 3};
+    EXPECT_EQ(hdu.get_binned_shape(bins), (std::vector<std::size_t>{2, 3, 3}));
+
+    // Reference bins computed from the pixels
+    auto expected = [&](bin_mode mode)
+    {
+        std::vector<double> values;
+        for (std::size_t plane = 0; plane < 2; ++plane)
+        {
+            for (std::size_t y = 0; y < 5; y += 2)
+            {
+                for (std::size_t x = 0; x < 7; x += 3)
+                {
+                    double sum = 0;
+                    std::size_t count = 0;
+                    for (std::size_t j = y; j < std::min<std::size_t>(y + 2, 5); ++j)
+                    {
+                        for (std::size_t i = x; i < std::min<std::size_t>(x + 3, 7); ++i)
+                        {
+                            const float value = pixels[plane * 35 + j * 7 + i];
+                            if (!std::isnan(value))
+                            {
+                                sum += value;
+                                ++count;
+                            }
+                        }
+                    }
+                    values.push_back(mode == bin_mode::sum ? sum : sum / static_cast<double>(count));
+                }
+            }
+        }
+        return values;
+    };
+
+    std::vector<double> sums(18);
+    hdu.read_binned(bins, std::span(sums));
+    EXPECT_EQ(sums, expected(bin_mode::sum));
+    EXPECT_EQ(sums[0], 0 + 1 + 2 + 7 + 9);
+    EXPECT_EQ(sums[8], 34); // Corner bin of a single pixel
+
+    std::vector<double> means(18);
+    ifits::hdu::image_hdu<float>(hdu).read_binned(binning{2, 3, bin_mode::mean, 1}, std::span(means));
+    EXPECT_EQ(means, expected(bin_mode::mean));
+
+    // Conversion of the bins to integers
+    std::vector<std::int16_t> rounded(18);
+    hdu.read_binned(binning{2, 3}, std::span(rounded));
+    EXPECT_EQ(rounded[0], 4); // 19 / 5 = 3.8
+
+    EXPECT_THROW(hdu.read_binned(binning{0, 3}, std::span(sums)), std::runtime_error);
+    EXPECT_THROW(hdu.read_binned(binning{1, 1}, std::span(sums)), std::runtime_error);
+}
+
+// Test frames of a cube calibrated while they are read
+TEST(test_ifits, check_read_frames)
+{
+    std::filesystem::remove(DATA_ROOT "/frames.fits");
+
+    // Four frames of 3x5 pixels, stored value 10 * frame + pixel
+    const std::size_t frames = 4, pixels = 15;
+    std::vector<std::int16_t> stored(frames * pixels);
+    for (std::size_t i = 0; i < stored.size(); ++i)
+    {
+        stored[i] = static_cast<std::int16_t>(10 * (i / pixels) + i % pixels);
+    }
+
+    {
+        ofits<std::int16_t> file{DATA_ROOT "/frames.fits", {{{frames, 3, 5}}}};
+        file.value_as<0>("BSCALE", "2");
+        file.write_data<0>({0}, boost::asio::buffer(stored));
+    }
+
+    master_frames masters;
+    masters.bias.assign(pixels, 1.0);
+    masters.dark.resize(pixels);
+    masters.flat.resize(pixels);
+    for (std::size_t i = 0; i < pixels; ++i)
+    {
+        masters.dark[i] = 0.5 * static_cast<double>(i);
+        masters.flat[i] = i % 2 ? 2.0 : 0.5;
+    }
+    masters.dark_scale = 2.0;
+    masters.flat[7] = 0.0;
+
+    ifits ifits_file(DATA_ROOT "/frames.fits");
+    auto &hdu = ifits_file.get_hdu<0>();
+    const frame_calibration calibration(masters, pixels);
+
+    // Frames 1 and 2 in double, calibrated in place
+    std::vector<double> calibrated(2 * pixels);
+    hdu.read_frames(1, 2, std::span(calibrated), calibration);
+    for (std::size_t i = 0; i < calibrated.size(); ++i)
+    {
+        const std::size_t pixel = i % pixels;
+        const double physical = 2.0 * stored[pixels + i];
+        const double expected = (physical - 1.0 - 2.0 * masters.dark[pixel]) / masters.flat[pixel];
+        if (pixel == 7)
+        {
+            EXPECT_TRUE(std::isnan(calibrated[i]));
+        }
+        else
+        {
+            EXPECT_DOUBLE_EQ(calibrated[i], expected) << i;
+        }
+    }
+
+    // Converted to float, and a hook seeing the frame indices
+    std::vector<float> converted(frames * pixels);
+    std::vector<std::size_t> seen;
+    ifits::hdu::image_hdu<std::int16_t>(hdu).read_frames(0, frames, std::span(converted), [&](std::span<double> values, std::size_t frame, std::size_t pixel)
+                                                        {
+        EXPECT_EQ(pixel, 0);
+        EXPECT_EQ(values.size(), pixels);
+        seen.push_back(frame);
+        calibration(values, frame, pixel); });
+    EXPECT_EQ(seen, (std::vector<std::size_t>{0, 1, 2, 3}));
+    EXPECT_FLOAT_EQ(converted[pixels + 1], static_cast<float>(calibrated[1]));
+
+    EXPECT_THROW(hdu.read_frames(3, 2, std::span(converted), calibration), std::runtime_error);
+    EXPECT_THROW(hdu.read_frames(0, 4, std::span(calibrated), calibration), std::runtime_error);
+    EXPECT_THROW(frame_calibration(masters, pixels + 1), std::runtime_error);
+
+    // A calibration of smaller frames would be read past its end
+    const frame_calibration smaller(master_frames{}, pixels - 5);
+    EXPECT_THROW(hdu.read_frames(0, 1, std::span(calibrated), smaller), std::runtime_error);
+    EXPECT_THROW(hdu.read_frames(0, 1, std::span(calibrated), std::ref(smaller)), std::runtime_error);
+    EXPECT_THROW(hdu.read_frames(0, 1, std::span(calibrated), [&](std::span<double> values, std::size_t frame, std::size_t pixel)
+                                 { smaller(values, frame, pixel); }),
+                 std::runtime_error);
+}
+
+TEST(test_ifits, check_read_decimated)
+{
+    std::filesystem::remove(DATA_ROOT "/decimated.fits");
+
+    // Rows longer than a span, stored value i % 65521
+    const std::vector<std::size_t> shape{3, 8, 70000};
+    std::vector<std::uint16_t> stored(shape[0] * shape[1] * shape[2]);
+    for (std::size_t i = 0; i < stored.size(); ++i)
+    {
+        stored[i] = static_cast<std::uint16_t>(i % 65521);
+    }
+
+    {
+        ofits<std::uint16_t> file{DATA_ROOT "/decimated.fits", {{{shape[0], shape[1], shape[2]}}}};
+        file.write_data<0>({0}, boost::asio::buffer(stored));
+    }
+
+    ifits ifits_file(DATA_ROOT "/decimated.fits");
+    ifits::hdu::image_hdu<std::uint16_t> hdu(ifits_file.get_hdu<0>());
+
+    // Samples of a region picked one by one
+    auto expected = [&](const image_region &region, const std::vector<std::size_t> &steps)
+    {
+        std::vector<std::uint16_t> values;
+        for (std::size_t z = region.start[0]; z < region.start[0] + region.count[0]; z += steps[0])
+        {
+            for (std::size_t y = region.start[1]; y < region.start[1] + region.count[1]; y += steps[1])
+            {
+                for (std::size_t x = region.start[2]; x < region.start[2] + region.count[2]; x += steps[2])
+                {
+                    values.push_back(stored[(z * shape[1] + y) * shape[2] + x]);
+                }
+            }
+        }
+        return values;
+    };
+
+    const image_region region{{1, 1, 3}, {2, 7, 69990}};
+    for (const auto &steps : std::vector<std::vector<std::size_t>>{{1, 1, 1}, {1, 2, 7}, {2, 3, 1000}, {1, 1, 20000}})
+    {
+        const auto reference = expected(region, steps);
+
+        // Default crossover, only sparse reads and only spans
+        for (const std::size_t max_gap : {std::size_t(32768), std::size_t(0), std::size_t(1) << 30})
+        {
+            std::vector<std::uint16_t> samples(reference.size() + 1, 7);
+            hdu.read_decimated(region, steps, std::span(samples), max_gap);
+            EXPECT_EQ(std::vector<std::uint16_t>(samples.begin(), samples.end() - 1), reference) << steps[2] << " " << max_gap;
+            EXPECT_EQ(samples.back(), 7);
+        }
+    }
+
+    std::vector<std::uint16_t> samples(4);
+    EXPECT_THROW(hdu.read_decimated(region, {1, 1}, std::span(samples)), std::runtime_error);
+    EXPECT_THROW(hdu.read_decimated(region, {1, 0, 1}, std::span(samples)), std::runtime_error);
+    EXPECT_THROW(hdu.read_decimated(image_region{{0, 0, 69999}, {1, 1, 2}}, {1, 1, 1}, std::span(samples)), std::runtime_error);
+    EXPECT_THROW(hdu.read_decimated(region, {1, 1, 20000}, std::span(samples)), std::runtime_error);
+}
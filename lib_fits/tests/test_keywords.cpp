@@ -0,0 +1,95 @@
+// Unit tests for the reserved keyword handles
+
+#include <gtest/gtest.h>
+#include <lib_fits.hpp>
+#include <boost/asio.hpp>
+
+// Path to the data used in the unit tests
+#define DATA_ROOT "../data"
+
+// Test the perfect hash of the reserved keywords
+TEST(test_keywords, check_slots)
+{
+    for (std::size_t slot = 0; slot < kReservedKeywords.size(); ++slot)
+    {
+        EXPECT_EQ(reserved_keyword_slot(kReservedKeywords[slot]), slot);
+    }
+
+    static_assert(kw::EXPTIME::slot < kReservedKeywords.size());
+    static_assert(kReservedKeywords[kw::BITPIX::slot] == "BITPIX");
+
+    EXPECT_EQ(reserved_keyword_slot("exptime"), kw::EXPTIME::slot);
+    EXPECT_EQ(reserved_keyword_slot("EXPTIMES"), kReservedKeywords.size());
+    EXPECT_EQ(reserved_keyword_slot("HISTORY"), kReservedKeywords.size());
+
+    EXPECT_EQ(indexed_keyword_slot("NAXIS12"), std::make_pair(kw::NAXISn::family, std::size_t(12)));
+    EXPECT_EQ(indexed_keyword_slot("TFORM3"), std::make_pair(kw::TFORMn::family, std::size_t(3)));
+    EXPECT_EQ(indexed_keyword_slot("NAXIS").first, kIndexedKeywords.size());
+    EXPECT_EQ(indexed_keyword_slot("NAXIS0").first, kIndexedKeywords.size());
+    EXPECT_EQ(indexed_keyword_slot("KEY00001").first, kIndexedKeywords.size());
+}
+
+// Test typed access to the keywords of a written file
+TEST(test_keywords, check_typed_access)
+{
+    {
+        ofits<std::int16_t> file{DATA_ROOT "/keywords.fits", {{{4, 8}}}};
+        file.value_as<0>("EXPTIME", "1.5D2");
+        file.value_as<0>("extname", "'SCI'");
+        file.value_as<0>("BZERO", "32768");
+        file.value_as<0>("CRPIX2", "-12.25");
+    }
+
+    ifits file(DATA_ROOT "/keywords.fits");
+    const auto &hdu = file.get_hdu<0>();
+
+    EXPECT_EQ(hdu.get<kw::SIMPLE>(), true);
+    EXPECT_EQ(hdu.get<kw::BITPIX>(), 16);
+    EXPECT_EQ(hdu.get<kw::NAXIS>(), 2);
+    EXPECT_EQ(hdu.get<kw::NAXISn>(1), 4);
+    EXPECT_EQ(hdu.get<kw::NAXISn>(2), 8);
+    EXPECT_DOUBLE_EQ(hdu.get<kw::EXPTIME>(), 150.0);
+    EXPECT_EQ(hdu.get<kw::EXTNAME>(), "SCI");
+    EXPECT_DOUBLE_EQ(hdu.get<kw::BZERO>(), 32768.0);
+    EXPECT_DOUBLE_EQ(hdu.get<kw::CRPIXn>(2), -12.25);
+
+    EXPECT_FALSE(hdu.get_optional<kw::BSCALE>().has_value());
+    EXPECT_DOUBLE_EQ(hdu.get_optional<kw::EXPTIME>().value(), 150.0);
+
+    EXPECT_THROW(hdu.get<kw::BSCALE>(), std::out_of_range);
+    EXPECT_THROW(hdu.get<kw::NAXISn>(3), std::out_of_range);
+    EXPECT_THROW(hdu.get<kw::CRPIXn>(1), std::out_of_range);
+
+    // The index survives copies of the HDU
+    auto copy = hdu;
+    EXPECT_EQ(copy.get<kw::NAXISn>(2), 8);
+}
+
+// Test that a repeated keyword reads as its first card in file order
+TEST(test_keywords, check_duplicated_keywords)
+{
+    std::filesystem::remove(DATA_ROOT "/duplicated.fits");
+
+    {
+        ofits<std::int16_t> file{DATA_ROOT "/duplicated.fits", {{{4, 8}}}};
+        for (const char *exptime : {"10", "20", "30", "40", "50"})
+        {
+            file.value_as<0>("EXPTIME", exptime);
+        }
+        file.value_as<0>("CRPIX1", "1.5");
+        file.value_as<0>("CRPIX1", "2.5");
+        file.value_as<0>("CRPIX1", "3.5");
+    }
+
+    ifits file(DATA_ROOT "/duplicated.fits");
+    const auto &hdu = file.get_hdu<0>();
+
+    EXPECT_EQ(hdu.get_headers().count("EXPTIME"), 5);
+    EXPECT_DOUBLE_EQ(hdu.get<kw::EXPTIME>(), 10.0);
+    EXPECT_DOUBLE_EQ(hdu.get<kw::CRPIXn>(1), 1.5);
+
+    // Copies insert the cards again, in file order
+    const auto copy = hdu;
+    EXPECT_DOUBLE_EQ(copy.get<kw::EXPTIME>(), 10.0);
+    EXPECT_DOUBLE_EQ(copy.get<kw::CRPIXn>(1), 1.5);
+}
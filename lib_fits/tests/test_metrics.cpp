@@ -0,0 +1,95 @@
+// Unit tests for io_metrics
+
+#include <gtest/gtest.h>
+#include <lib_fits.hpp>
+#include <boost/asio.hpp>
+
+// Path to the data used in the unit tests
+#define DATA_ROOT "../data"
+
+// Test the bucket layout of the latency histogram
+TEST(test_metrics, check_histogram_buckets)
+{
+    using snapshot = latency_histogram_snapshot;
+
+    // Every value falls into a bucket whose upper bound is not below it
+    for (std::uint64_t value : {0ull, 1ull, 7ull, 8ull, 15ull, 16ull, 1000ull, 123456789ull, ~0ull})
+    {
+        const auto index = snapshot::bucket_index(value);
+        EXPECT_LT(index, snapshot::kBuckets);
+        EXPECT_GE(snapshot::bucket_upper_bound(index), value);
+        if (index > 0)
+        {
+            EXPECT_LT(snapshot::bucket_upper_bound(index - 1), value);
+        }
+    }
+
+    latency_histogram histogram;
+    for (std::uint64_t i = 1; i <= 100; ++i)
+    {
+        histogram.record(i * 1000);
+    }
+
+    auto result = histogram.snapshot();
+
+    EXPECT_EQ(result.total, 100);
+    EXPECT_EQ(result.max, 100000);
+
+    // Percentiles are exact up to the 12.5% bucket width
+    EXPECT_NEAR(result.percentile(0.5), 50000, 50000 * 0.125);
+    EXPECT_NEAR(result.percentile(0.99), 99000, 99000 * 0.125);
+    EXPECT_EQ(result.percentile(1.0), 100000);
+}
+
+// Test the counters recorded while writing and reading a file
+TEST(test_metrics, check_counters)
+{
+    auto write_metrics = std::make_shared<io_metrics>();
+
+    std::vector<float> data(100, 1.0f);
+
+    {
+        ofits<float> file{DATA_ROOT "/metrics.fits", {{{10, 100}}}, 1, write_metrics};
+
+        EXPECT_EQ(file.get_metrics(), write_metrics);
+
+        file.write_data<0>({0}, boost::asio::buffer(data));
+
+        for (std::size_t i = 1; i < 4; ++i)
+        {
+            file.async_write_data<0>({i}, boost::asio::buffer(data), [](const boost::system::error_code &, std::size_t) {});
+        }
+
+        EXPECT_EQ(write_metrics->snapshot().queue_depth, 3);
+
+        file.run();
+    }
+
+    auto written = write_metrics->snapshot();
+
+    EXPECT_EQ(written.write_ops, 4);
+    EXPECT_EQ(written.queue_depth, 0);
+    EXPECT_EQ(written.max_queue_depth, 3);
+    EXPECT_EQ(written.write_latency.total, 4);
+    EXPECT_GE(written.write_syscalls, 4);
+    EXPECT_GE(written.bytes_written, 4 * data.size() * sizeof(float));
+
+    auto read_metrics = std::make_shared<io_metrics>();
+
+    ifits file(DATA_ROOT "/metrics.fits", read_metrics);
+
+    auto parsed = read_metrics->snapshot();
+
+    EXPECT_EQ(parsed.hdus_parsed, 1);
+    EXPECT_GT(parsed.read_syscalls, 0);
+    EXPECT_EQ(parsed.read_ops, 0);
+
+    std::vector<float> buffer(100);
+    ifits::hdu::image_hdu<float>(file.get_hdu<0>()).read_data({2}, boost::asio::buffer(buffer));
+
+    auto read = read_metrics->snapshot();
+
+    EXPECT_EQ(read.read_ops, 1);
+    EXPECT_EQ(read.bytes_read, parsed.bytes_read + buffer.size() * sizeof(float));
+    EXPECT_EQ(read.read_latency.total, 1);
+}
@@ -122,3 +122,381 @@ TEST(ofits_test, check_three_hdu)
 
     EXPECT_EQ(ifits_file.get_hdu<2>().value_as<std::string>("NAXIS2"), "4");
 }
+
+// Test writing a header that spans several header blocks
+TEST(ofits_test, check_multi_block_header)
+{
+    std::vector<std::int16_t> data = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+
+    {
+        // Two header blocks hold 72 keywords including END
+        ofits<std::int16_t> multi_block_file{DATA_ROOT "/multi_block_header.fits", {{{10, 10}}}, 2};
+
+        // 6 mandatory keywords + 65 extra keywords + END = 72
+        for (int i = 0; i < 65; ++i)
+        {
+            multi_block_file.value_as<0>("KEY" + std::to_string(i), std::to_string(i));
+        }
+
+        // No room left for another keyword
+        EXPECT_THROW(multi_block_file.value_as<0>("KEY65", "65"), std::runtime_error);
+
+        multi_block_file.write_data<0>({9}, boost::asio::buffer(data));
+    }
+
+    ifits ifits_file(DATA_ROOT "/multi_block_header.fits");
+
+    auto &hdu_0 = ifits_file.get_hdu<0>();
+
+    EXPECT_EQ(hdu_0.value_as<std::string>("KEY64"), "64");
+
+    // The data block starts after both header blocks
+    std::vector<std::int16_t> buffer(10);
+    ifits::hdu::image_hdu<std::int16_t>(hdu_0).read_data({9}, boost::asio::buffer(buffer));
+
+    EXPECT_EQ(buffer, data);
+}
+
+// Test reading and writing through views with a shape known at compile time
+TEST(ofits_test, check_static_view)
+{
+    using cube = static_extents<4, 3, 5>;
+
+    static_assert(cube::strides == cube::index_type{15, 5, 1});
+    static_assert(cube::offset({1, 2, 3}) == 1 * 15 + 2 * 5 + 3);
+    static_assert(!cube::contains({0, 3, 0}));
+
+    std::filesystem::remove(DATA_ROOT "/static_view.fits");
+
+    std::vector<float> row = {1.0f, 2.0f, 3.0f, 4.0f, 5.0f};
+
+    {
+        ofits<float> file{DATA_ROOT "/static_view.fits", {{{4, 3, 5}}}};
+
+        auto view = file.static_view<0, 4, 3, 5>();
+        view.write_data({1, 2, 0}, boost::asio::buffer(row));
+        view.write_pixel({3, 0, 4}, 42.0f);
+
+        // The dynamic API addresses the same elements
+        file.write_data<0>({2, 1, 0}, boost::asio::buffer(row));
+
+        EXPECT_THROW(view.write_pixel({4, 0, 0}, 0.0f), std::runtime_error);
+        EXPECT_THROW(view.write_data({3, 2, 1}, boost::asio::buffer(row)), std::runtime_error);
+        EXPECT_THROW((file.static_view<0, 4, 5, 3>()), std::runtime_error);
+    }
+
+    ifits ifits_file(DATA_ROOT "/static_view.fits");
+    ifits::hdu::image_hdu<float> image(ifits_file.get_hdu<0>());
+
+    auto view = image.static_view<4, 3, 5>();
+    EXPECT_EQ(view.read_pixel({3, 0, 4}), 42.0f);
+    EXPECT_EQ(view.read_pixel({2, 1, 4}), 5.0f);
+
+    std::vector<float> buffer(5);
+    image.read_data({1, 2, 0}, boost::asio::buffer(buffer));
+    EXPECT_EQ(buffer, row);
+
+    view.read_data({2, 1, 0}, boost::asio::buffer(buffer));
+    EXPECT_EQ(buffer, row);
+
+    EXPECT_THROW((image.static_view<4, 3>()), std::runtime_error);
+    EXPECT_THROW((image.static_view<4, 3, 6>()), std::runtime_error);
+}
+
+// Test writing float data into an int16 HDU with BSCALE and BZERO
+TEST(ofits_test, check_scaled_write)
+{
+    std::filesystem::remove(DATA_ROOT "/scaled_write.fits");
+
+    // Physical values with two decimals, the last two out of range of the scaling
+    std::vector<float> physical = {100.0f, 100.01f, 99.99f, -200.5f, 427.67f, 0.02f, 1000.0f, -1000.0f};
+
+    {
+        ofits<std::int16_t> file{DATA_ROOT "/scaled_write.fits", {{{2, 4}}}};
+        file.set_scaling<0>({0.01, 100});
+
+        EXPECT_THROW(file.set_scaling<0>({0.02, 100}), std::runtime_error);
+        EXPECT_THROW(file.write_data<0>({0}, std::span(physical), overflow_policy::error), std::overflow_error);
+
+        EXPECT_EQ(file.write_data<0>({0}, std::span(physical)), physical.size() * sizeof(std::int16_t));
+    }
+
+    ifits ifits_file(DATA_ROOT "/scaled_write.fits");
+    auto &hdu = ifits_file.get_hdu<0>();
+
+    EXPECT_DOUBLE_EQ(hdu.get<kw::BSCALE>(), 0.01);
+    EXPECT_DOUBLE_EQ(hdu.get<kw::BZERO>(), 100.0);
+
+    std::vector<std::int16_t> stored(8);
+    hdu.read_as(image_region::whole(hdu.get_shape()), std::span(stored), pixel_scaling{});
+    EXPECT_EQ(stored, (std::vector<std::int16_t>{0, 1, -1, -30050, 32767, -9998, 32767, -32768}));
+
+    std::vector<float> read(8);
+    hdu.read_as(image_region::whole(hdu.get_shape()), std::span(read));
+    for (std::size_t i = 0; i < 6; ++i)
+    {
+        EXPECT_NEAR(read[i], physical[i], 0.005f);
+    }
+}
+
+// Test the exponents of the scaling and statistics cards
+TEST(ofits_test, check_value_format)
+{
+    std::filesystem::remove(DATA_ROOT "/value_format.fits");
+
+    std::vector<float> values = {1e-30f, 2e30f};
+
+    {
+        ofits<std::int32_t, float, std::int16_t> file{DATA_ROOT "/value_format.fits", {{{2}, {2}, {2}}}};
+        file.set_scaling<0>({1e-5, 1e20});
+        file.track_statistics<1>();
+        file.write_data<1>({0}, boost::asio::buffer(values));
+
+        const double inf = std::numeric_limits<double>::infinity();
+        EXPECT_THROW(file.set_scaling<2>({inf, 0}), std::runtime_error);
+        EXPECT_THROW(file.set_scaling<2>({1, std::numeric_limits<double>::quiet_NaN()}), std::runtime_error);
+    }
+
+    ifits ifits_file(DATA_ROOT "/value_format.fits");
+    const auto &scaled = ifits_file.get_hdu<0>();
+    const auto &tracked = ifits_file.get_hdu<1>();
+
+    for (const auto *hdu : {&scaled, &tracked})
+    {
+        for (const auto &[key, value] : hdu->get_headers())
+        {
+            EXPECT_EQ(value.find('e'), std::string::npos) << key << " = " << value;
+        }
+    }
+    EXPECT_DOUBLE_EQ(scaled.get<kw::BSCALE>(), 1e-5);
+    EXPECT_DOUBLE_EQ(scaled.get<kw::BZERO>(), 1e20);
+    EXPECT_DOUBLE_EQ(tracked.get<kw::DATAMIN>(), 1e-30f);
+    EXPECT_DOUBLE_EQ(tracked.get<kw::DATAMAX>(), 2e30f);
+}
+
+// Test writing data of another type without scaling
+TEST(ofits_test, check_converted_write)
+{
+    std::filesystem::remove(DATA_ROOT "/converted_write.fits");
+
+    std::vector<double> source = {1.4, 1.5, -1.5, 300.0, -5.0};
+
+    {
+        ofits<std::uint8_t, float> file{DATA_ROOT "/converted_write.fits", {{{5}, {5}}}};
+        file.write_data<0>({0}, std::span(source));
+        file.write_data<1>({0}, std::span(source));
+    }
+
+    ifits ifits_file(DATA_ROOT "/converted_write.fits");
+
+    std::vector<std::uint8_t> bytes(5);
+    ifits::hdu::image_hdu<std::uint8_t>(ifits_file.get_hdu<0>()).read_data({0}, boost::asio::buffer(bytes));
+    EXPECT_EQ(bytes, (std::vector<std::uint8_t>{1, 2, 0, 255, 0}));
+
+    std::vector<float> floats(5);
+    ifits::hdu::image_hdu<float>(ifits_file.get_hdu<1>()).read_data({0}, boost::asio::buffer(floats));
+    EXPECT_EQ(floats, (std::vector<float>{1.4f, 1.5f, -1.5f, 300.0f, -5.0f}));
+}
+
+// Test the range checks of converted writes at the bounds of the destination types
+TEST(ofits_test, check_converted_write_bounds)
+{
+    std::filesystem::remove(DATA_ROOT "/converted_bounds.fits");
+
+    std::vector<float> bounds = {-32768.0f, 32767.0f, -32768.4f, 32767.4f};
+
+    {
+        ofits<std::int16_t> file{DATA_ROOT "/converted_bounds.fits", {{{4}}}};
+        EXPECT_NO_THROW(file.write_data<0>({0}, std::span(bounds), overflow_policy::error));
+    }
+
+    ifits ifits_file(DATA_ROOT "/converted_bounds.fits");
+    std::vector<std::int16_t> stored(4);
+    ifits::hdu::image_hdu<std::int16_t>(ifits_file.get_hdu<0>()).read_data({0}, boost::asio::buffer(stored));
+    EXPECT_EQ(stored, (std::vector<std::int16_t>{-32768, 32767, -32768, 32767}));
+
+    // Values rounding to the bounds are in range, the next integers are not
+    const auto check = []<class To>(std::vector<double> in_range, std::vector<double> out_of_range)
+    {
+        std::vector<To> dst(in_range.size());
+        EXPECT_NO_THROW(convert_pixels(in_range.data(), dst.data(), in_range.size(), {}, overflow_policy::error));
+        for (const double value : out_of_range)
+        {
+            To single;
+            EXPECT_THROW(convert_pixels(&value, &single, 1, {}, overflow_policy::error), std::overflow_error);
+        }
+    };
+
+    check.operator()<std::int16_t>({-32768.0, 32767.0, -32768.49, 32767.49}, {-32768.5, 32767.5, -32769.0, 32768.0});
+    check.operator()<std::uint16_t>({0.0, 65535.0, -0.3, -0.49, 65535.49}, {-0.5, -1.0, 65535.5, 65536.0});
+    check.operator()<std::int32_t>({-2147483648.0, 2147483647.0, -2147483648.49}, {-2147483648.5, 2147483647.5});
+    check.operator()<std::uint32_t>({0.0, 4294967295.0, -0.3}, {-0.5, 4294967295.5});
+    check.operator()<std::int64_t>({-9223372036854775808.0}, {-9223372036854777856.0, 9223372036854775808.0});
+    check.operator()<std::uint8_t>({-0.3, 255.3}, {-0.7, 255.5, std::nan("")});
+}
+
+// Test writing and reading unsigned integers with the BZERO convention
+TEST(ofits_test, check_unsigned)
+{
+    std::filesystem::remove(DATA_ROOT "/unsigned.fits");
+
+    std::vector<std::uint16_t> words = {0, 1, 32767, 32768, 65535, 12345};
+    std::vector<std::uint32_t> dwords = {0, 4000000000u, 2147483648u, 7};
+
+    {
+        ofits<std::uint16_t, std::uint32_t> file{DATA_ROOT "/unsigned.fits", {{{2, 3}, {2, 2}}}};
+
+        EXPECT_THROW(file.set_scaling<0>({2.0, 0.0}), std::runtime_error);
+
+        file.write_data<0>({0}, boost::asio::buffer(words));
+
+        // Asynchronous writes and converted writes of signed values
+        file.async_write_data<1>({0}, boost::asio::buffer(dwords.data(), 2 * sizeof(std::uint32_t)), [](const boost::system::error_code &error, std::size_t)
+                                 { EXPECT_FALSE(error); });
+        std::vector<std::int64_t> tail = {2147483648, 7};
+        file.write_data<1>({1}, std::span(tail));
+        file.run();
+    }
+
+    ifits ifits_file(DATA_ROOT "/unsigned.fits");
+    auto &hdu_0 = ifits_file.get_hdu<0>();
+    auto &hdu_1 = ifits_file.get_hdu<1>();
+
+    EXPECT_EQ(hdu_0.get<kw::BITPIX>(), 16);
+    EXPECT_DOUBLE_EQ(hdu_0.get<kw::BZERO>(), 32768.0);
+    EXPECT_TRUE(hdu_0.is_unsigned());
+    EXPECT_TRUE(hdu_1.is_unsigned());
+
+    // apply() selects the unsigned type
+    hdu_0.apply([&](auto image)
+                {
+        using T = typename decltype(image)::value_type;
+        EXPECT_TRUE((std::is_same_v<T, std::uint16_t>));
+
+        std::vector<T> buffer(6);
+        image.read_data({0}, boost::asio::buffer(buffer));
+        EXPECT_EQ(std::vector<std::uint16_t>(buffer.begin(), buffer.end()), words); });
+
+    // The stored values are the signed ones shifted by BZERO
+    std::vector<std::int16_t> stored(6);
+    ifits::hdu::image_hdu<std::int16_t>(hdu_0).read_data({0}, boost::asio::buffer(stored));
+    EXPECT_EQ(stored, (std::vector<std::int16_t>{-32768, -32767, -1, 0, 32767, 12345 - 32768}));
+
+    std::vector<double> physical(4);
+    hdu_1.read_as(image_region::whole(hdu_1.get_shape()), std::span(physical));
+    EXPECT_EQ(physical, (std::vector<double>{0.0, 4000000000.0, 2147483648.0, 7.0}));
+
+    // Asynchronous reads of a row split in odd-sized buffers
+    std::array<unsigned char, 3> head;
+    std::array<unsigned char, 9> rest;
+    ifits::hdu::image_hdu<std::uint16_t>(hdu_0).async_read_data({0}, std::array{boost::asio::buffer(head), boost::asio::buffer(rest)},
+                                                                [](const boost::system::error_code &error, std::size_t bytes)
+                                                                { EXPECT_FALSE(error); EXPECT_EQ(bytes, 12); });
+    ifits_file.run();
+
+    std::vector<std::uint16_t> joined(6);
+    std::memcpy(joined.data(), head.data(), head.size());
+    std::memcpy(reinterpret_cast<unsigned char *>(joined.data()) + head.size(), rest.data(), rest.size());
+    EXPECT_EQ(joined, words);
+}
+
+// Test the statistics accumulated while writing and reading
+TEST(ofits_test, check_statistics)
+{
+    std::filesystem::remove(DATA_ROOT "/statistics.fits");
+
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    std::vector<float> frame = {1.5f, nan, -2.0f, 4.0f, 0.5f, nan, 3.0f, 7.0f, -1.0f, 2.0f};
+    std::vector<float> scaled = {10.0f, 20.5f, -5.0f, 12.25f};
+
+    {
+        ofits<float, std::int16_t, float> file{DATA_ROOT "/statistics.fits", {{{2, 5}, {4}, {2}}}};
+        file.track_statistics<0>();
+        file.set_scaling<1>({0.5, 100});
+        file.track_statistics<1>();
+        file.track_statistics<2>();
+
+        file.write_data<0>({0}, boost::asio::buffer(frame.data(), 5 * sizeof(float)));
+        file.static_view<0, 2, 5>().write_data({1, 0}, boost::asio::buffer(frame.data() + 5, 5 * sizeof(float)));
+        file.write_data<1>({0}, std::span(scaled));
+        file.write_data<2>({0}, boost::asio::buffer(std::vector<float>{nan, nan}));
+
+        const image_statistics statistics = file.get_statistics<0>();
+        EXPECT_EQ(statistics.count, 8);
+        EXPECT_EQ(statistics.invalid, 2);
+        EXPECT_DOUBLE_EQ(statistics.min, -2.0);
+        EXPECT_DOUBLE_EQ(statistics.max, 7.0);
+        EXPECT_DOUBLE_EQ(statistics.mean(), 1.875);
+
+        // Stored values of the scaled HDU
+        EXPECT_DOUBLE_EQ(file.get_statistics<1>().min, -210.0);
+        EXPECT_DOUBLE_EQ(file.get_statistics<1>().max, -159.0);
+
+        EXPECT_EQ(file.get_statistics<2>().count, 0);
+        EXPECT_EQ(file.get_statistics<2>().invalid, 2);
+    }
+
+    ifits ifits_file(DATA_ROOT "/statistics.fits");
+
+    // Written by the destructor, in physical values
+    EXPECT_DOUBLE_EQ(ifits_file.get_hdu<0>().get<kw::DATAMIN>(), -2.0);
+    EXPECT_DOUBLE_EQ(ifits_file.get_hdu<0>().get<kw::DATAMAX>(), 7.0);
+    EXPECT_DOUBLE_EQ(ifits_file.get_hdu<1>().get<kw::DATAMIN>(), -5.0);
+    EXPECT_DOUBLE_EQ(ifits_file.get_hdu<1>().get<kw::DATAMAX>(), 20.5);
+
+    // No valid values, the reserved cards are comments
+    EXPECT_FALSE(ifits_file.get_hdu<2>().get_optional<kw::DATAMIN>().has_value());
+    EXPECT_FALSE(ifits_file.get_hdu<2>().get_optional<kw::DATAMAX>().has_value());
+    EXPECT_EQ(ifits_file.get_hdu<2>().get_headers().count("COMMENT"), 2);
+
+    // Per-row partials merged at the end
+    ifits::hdu::image_hdu<float> image(ifits_file.get_hdu<0>());
+    image_statistics rows[2];
+    std::vector<float> row(5);
+    image.read_data({0}, boost::asio::buffer(row), rows[0]);
+    image.read_data({1}, boost::asio::buffer(row), rows[1]);
+    rows[0] += rows[1];
+
+    EXPECT_EQ(rows[0].count, 8);
+    EXPECT_EQ(rows[0].invalid, 2);
+    EXPECT_DOUBLE_EQ(rows[0].sum, 15.0);
+    EXPECT_DOUBLE_EQ(rows[0].sum_squares, 1.5 * 1.5 + 4 + 16 + 0.25 + 9 + 49 + 1 + 4);
+
+    // BLANK values are invalid
+    ifits::hdu::image_hdu<std::int16_t> stored(ifits_file.get_hdu<1>());
+    EXPECT_FALSE(stored.get_blank().has_value());
+
+    image_statistics asynchronous;
+    std::vector<std::int16_t> values(4);
+    stored.async_read_data({0}, boost::asio::buffer(values), asynchronous, [](const boost::system::error_code &error, std::size_t)
+                           { EXPECT_FALSE(error); });
+    ifits_file.run();
+    EXPECT_EQ(asynchronous.count, 4);
+    EXPECT_DOUBLE_EQ(asynchronous.max, -159.0);
+}
+
+// Test the statistics of integers with a BLANK value
+TEST(ofits_test, check_statistics_blank)
+{
+    std::filesystem::remove(DATA_ROOT "/statistics_blank.fits");
+
+    std::vector<std::uint16_t> values = {0, 10, 65535, 20};
+
+    {
+        ofits<std::uint16_t> file{DATA_ROOT "/statistics_blank.fits", {{{4}}}};
+        file.value_as<0>("BLANK", "32767"); // Stored value of 65535
+        file.write_data<0>({0}, boost::asio::buffer(values));
+    }
+
+    ifits ifits_file(DATA_ROOT "/statistics_blank.fits");
+    ifits::hdu::image_hdu<std::uint16_t> image(ifits_file.get_hdu<0>());
+    EXPECT_EQ(image.get_blank(), std::uint16_t(65535));
+
+    image_statistics statistics;
+    std::vector<std::uint16_t> read(4);
+    image.read_data({0}, boost::asio::buffer(read), statistics);
+    EXPECT_EQ(read, values);
+    EXPECT_EQ(statistics.count, 3);
+    EXPECT_EQ(statistics.invalid, 1);
+    EXPECT_DOUBLE_EQ(statistics.max, 20.0);
+}
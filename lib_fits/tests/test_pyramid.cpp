@@ -0,0 +1,122 @@
+// Unit tests for pyramid
+
+#include <gtest/gtest.h>
+#include <lib_fits.hpp>
+#include <boost/asio.hpp>
+
+// Path to the data used in the unit tests
+#define DATA_ROOT "../data"
+
+// Test the levels of a pyramid against block means of the image
+TEST(test_pyramid, check_levels)
+{
+    std::filesystem::remove(DATA_ROOT "/pyramid.fits");
+    std::filesystem::remove(DATA_ROOT "/pyramid_levels.fits");
+
+    // 37x29 image, value i at the element i, a few NaN
+    const std::size_t height = 37, width = 29;
+    std::vector<float> pixels(height * width);
+    for (std::size_t i = 0; i < pixels.size(); ++i)
+    {
+        pixels[i] = i % 41 == 0 ? std::numeric_limits<float>::quiet_NaN() : static_cast<float>(i);
+    }
+
+    {
+        ofits<float> file{DATA_ROOT "/pyramid.fits", {{{height, width}}}};
+        file.write_data<0>({0}, boost::asio::buffer(pixels));
+    }
+
+    ifits image(DATA_ROOT "/pyramid.fits");
+    write_pyramid<double, 3>(image.get_hdu<0>(), DATA_ROOT "/pyramid_levels.fits", 3);
+
+    pyramid levels(image.get_hdu<0>(), DATA_ROOT "/pyramid_levels.fits");
+    ASSERT_EQ(levels.levels(), 4);
+
+    for (std::size_t level = 1; level < 4; ++level)
+    {
+        const std::size_t block = std::size_t(1) << level;
+        const auto shape = levels.get_level(level).get_shape();
+        ASSERT_EQ(shape, (std::vector<std::size_t>{(height + block - 1) / block, (width + block - 1) / block}));
+        EXPECT_EQ(levels.get_level(level).value_as<std::size_t>("PYRLEVEL"), level);
+
+        std::vector<double> values(shape[0] * shape[1]);
+        levels.read_level(level, image_region::whole(shape), std::span(values));
+
+        for (std::size_t y = 0; y < shape[0]; ++y)
+        {
+            for (std::size_t x = 0; x < shape[1]; ++x)
+            {
+                double sum = 0;
+                std::size_t count = 0;
+                for (std::size_t j = y * block; j < std::min(height, (y + 1) * block); ++j)
+                {
+                    for (std::size_t i = x * block; i < std::min(width, (x + 1) * block); ++i)
+                    {
+                        if (!std::isnan(pixels[j * width + i]))
+                        {
+                            sum += pixels[j * width + i];
+                            ++count;
+                        }
+                    }
+                }
+                EXPECT_DOUBLE_EQ(values[y * shape[1] + x], sum / static_cast<double>(count));
+            }
+        }
+    }
+
+    // Coarsest level still covering the requested resolution
+    EXPECT_EQ(levels.pick_level(37, 29), 0);
+    EXPECT_EQ(levels.pick_level(19, 15), 1);
+    EXPECT_EQ(levels.pick_level(10, 8), 2);
+    EXPECT_EQ(levels.pick_level(10, 7), 2);
+    EXPECT_EQ(levels.pick_level(1, 1), 3);
+    EXPECT_EQ(levels.pick_level(100, 100), 0);
+}
+
+// Test a sidecar file of another image
+TEST(test_pyramid, check_mismatch)
+{
+    std::filesystem::remove(DATA_ROOT "/pyramid_small.fits");
+    std::filesystem::remove(DATA_ROOT "/pyramid_small_levels.fits");
+    std::filesystem::remove(DATA_ROOT "/pyramid_other.fits");
+
+    std::vector<std::int16_t> pixels(8 * 8, 1);
+    {
+        ofits<std::int16_t, std::int16_t> file{DATA_ROOT "/pyramid_small.fits", {{{8, 8}, {9, 8}}}};
+        file.write_data<0>({0}, boost::asio::buffer(pixels));
+        file.write_data<1>({0}, boost::asio::buffer(pixels));
+        file.write_data<1>({8, 0}, boost::asio::buffer(pixels.data(), 8 * sizeof(std::int16_t)));
+    }
+
+    ifits image(DATA_ROOT "/pyramid_small.fits");
+    write_pyramid<float, 2>(image.get_hdu<0>(), DATA_ROOT "/pyramid_small_levels.fits");
+
+    pyramid levels(image.get_hdu<0>(), DATA_ROOT "/pyramid_small_levels.fits");
+    std::vector<float> values(4);
+    levels.read_level(2, image_region{{0, 0}, {2, 2}}, std::span(values));
+    EXPECT_EQ(values, std::vector<float>(4, 1.0f));
+
+    // Level 1 of a 9x8 image has 5 rows
+    auto &other = image.get_hdu<1>();
+    EXPECT_THROW(pyramid(other, DATA_ROOT "/pyramid_small_levels.fits"), std::runtime_error);
+}
+
+// Test regenerating a sidecar file with fewer levels
+TEST(test_pyramid, check_regenerate)
+{
+    std::filesystem::remove(DATA_ROOT "/pyramid_regenerate.fits");
+
+    std::vector<float> pixels(32 * 32, 2.0f);
+    {
+        ofits<float> file{DATA_ROOT "/pyramid_regenerate.fits", {{{32, 32}}}};
+        file.write_data<0>({0}, boost::asio::buffer(pixels));
+    }
+
+    ifits image(DATA_ROOT "/pyramid_regenerate.fits");
+    write_pyramid<float, 4>(image.get_hdu<0>(), DATA_ROOT "/pyramid_regenerate_levels.fits");
+    write_pyramid<float, 1>(image.get_hdu<0>(), DATA_ROOT "/pyramid_regenerate_levels.fits");
+
+    pyramid levels(image.get_hdu<0>(), DATA_ROOT "/pyramid_regenerate_levels.fits");
+    EXPECT_EQ(levels.levels(), 2);
+    EXPECT_EQ(levels.pick_level(1, 1), 1);
+}
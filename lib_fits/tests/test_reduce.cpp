@@ -0,0 +1,153 @@
+// Unit tests for reduce_axis
+
+#include <gtest/gtest.h>
+#include <lib_fits.hpp>
+#include <boost/asio.hpp>
+
+// Path to the data used in the unit tests
+#define DATA_ROOT "../data"
+
+// Test every reduction along every axis of a cube, with every strategy
+TEST(test_reduce, check_axes)
+{
+    std::filesystem::remove(DATA_ROOT "/reduce_cube.fits");
+
+    const std::vector<std::size_t> shape{6, 4, 5};
+    std::vector<float> pixels(6 * 4 * 5);
+    for (std::size_t i = 0; i < pixels.size(); ++i)
+    {
+        pixels[i] = static_cast<float>(i * 37 % 23) - 7.0f;
+    }
+    pixels[3] = pixels[3 + 20] = std::numeric_limits<float>::quiet_NaN();
+    for (std::size_t k = 0; k < 6; ++k)
+    {
+        pixels[k * 20 + 9] = std::numeric_limits<float>::quiet_NaN(); // No valid value along axis 0
+    }
+
+    {
+        ofits<float> file{DATA_ROOT "/reduce_cube.fits", {{{6, 4, 5}}}};
+        file.write_data<0>({0}, boost::asio::buffer(pixels));
+    }
+
+    ifits cube_file(DATA_ROOT "/reduce_cube.fits");
+    auto &cube = cube_file.get_hdu<0>();
+
+    // Reference reduction of the values of one output pixel
+    auto reference = [](std::vector<double> values, reduce_mode mode)
+    {
+        std::erase_if(values, [](double value)
+                      { return std::isnan(value); });
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        switch (mode)
+        {
+        case reduce_mode::sum:
+            return std::accumulate(values.begin(), values.end(), 0.0);
+        case reduce_mode::mean:
+            return values.empty() ? nan : std::accumulate(values.begin(), values.end(), 0.0) / static_cast<double>(values.size());
+        case reduce_mode::min:
+            return values.empty() ? nan : *std::min_element(values.begin(), values.end());
+        case reduce_mode::max:
+            return values.empty() ? nan : *std::max_element(values.begin(), values.end());
+        default:
+            std::sort(values.begin(), values.end());
+            if (values.empty())
+            {
+                return nan;
+            }
+            return values.size() % 2 ? values[values.size() / 2] : 0.5 * (values[values.size() / 2 - 1] + values[values.size() / 2]);
+        }
+    };
+
+    for (std::size_t axis = 0; axis < 3; ++axis)
+    {
+        const auto reduced = reduced_shape(shape, axis);
+        ASSERT_EQ(reduced.size(), 2);
+
+        for (reduce_mode mode : {reduce_mode::sum, reduce_mode::mean, reduce_mode::min, reduce_mode::max, reduce_mode::median})
+        {
+            // Whole outer indices per task, then bands into partial planes
+            for (std::size_t budget : {std::size_t(1) << 20, 3 * 60 * sizeof(double)})
+            {
+                std::filesystem::remove(DATA_ROOT "/reduced.fits");
+                {
+                    ofits<double> out{DATA_ROOT "/reduced.fits", {{{reduced[0], reduced[1]}}}};
+                    reduce_axis(cube, axis, out.get_hdu<0>(), {mode, budget, 3});
+                }
+
+                ifits result_file(DATA_ROOT "/reduced.fits");
+                std::vector<double> result(reduced[0] * reduced[1]);
+                ifits::hdu::image_hdu<double>(result_file.get_hdu<0>()).read_data({0}, boost::asio::buffer(result));
+
+                std::size_t position = 0;
+                for (std::size_t a = 0; a < reduced[0]; ++a)
+                {
+                    for (std::size_t b = 0; b < reduced[1]; ++b)
+                    {
+                        std::vector<double> values;
+                        for (std::size_t k = 0; k < shape[axis]; ++k)
+                        {
+                            std::size_t index[3];
+                            index[axis] = k;
+                            index[axis == 0 ? 1 : 0] = a;
+                            index[axis == 2 ? 1 : 2] = b;
+                            values.push_back(pixels[(index[0] * 4 + index[1]) * 5 + index[2]]);
+                        }
+
+                        const double expected = reference(values, mode);
+                        const double value = result[position++];
+                        if (std::isnan(expected))
+                        {
+                            EXPECT_TRUE(std::isnan(value)) << axis << " " << static_cast<int>(mode);
+                        }
+                        else
+                        {
+                            EXPECT_DOUBLE_EQ(value, expected) << axis << " " << static_cast<int>(mode) << " " << budget;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    EXPECT_THROW(reduced_shape(shape, 3), std::runtime_error);
+
+    ofits<double> wrong{DATA_ROOT "/reduced.fits", {{{4, 4}}}};
+    EXPECT_THROW(reduce_axis(cube, 0, wrong.get_hdu<0>()), std::runtime_error);
+}
+
+// Test that the median of pixels along the last axis reads whole slabs
+TEST(test_reduce, check_median_reads)
+{
+    std::filesystem::remove(DATA_ROOT "/reduce_spectra.fits");
+
+    // Three spectra of 101 values, one inner value per index of the axis
+    const std::size_t spectra = 3, length = 101;
+    std::vector<float> pixels(spectra * length);
+    for (std::size_t i = 0; i < pixels.size(); ++i)
+    {
+        pixels[i] = static_cast<float>(i * 37 % 101);
+    }
+
+    {
+        ofits<float> file{DATA_ROOT "/reduce_spectra.fits", {{{spectra, length}}}};
+        file.write_data<0>({0}, boost::asio::buffer(pixels));
+    }
+
+    auto metrics = std::make_shared<io_metrics>();
+    ifits spectra_file(DATA_ROOT "/reduce_spectra.fits", metrics);
+
+    std::filesystem::remove(DATA_ROOT "/reduced.fits");
+    {
+        ofits<double> out{DATA_ROOT "/reduced.fits", {{{spectra}}}};
+        metrics->reset();
+        reduce_axis(spectra_file.get_hdu<0>(), 1, out.get_hdu<0>(), {reduce_mode::median});
+        EXPECT_EQ(metrics->snapshot().read_syscalls, 1);
+    }
+
+    ifits result_file(DATA_ROOT "/reduced.fits");
+    std::vector<double> result(spectra);
+    ifits::hdu::image_hdu<double>(result_file.get_hdu<0>()).read_data({0}, boost::asio::buffer(result));
+
+    // Every spectrum is a permutation of 0 to 100
+    EXPECT_EQ(result, std::vector<double>(spectra, 50.0));
+}
@@ -0,0 +1,158 @@
+// Unit tests for io_scheduler
+
+#include <gtest/gtest.h>
+#include <lib_fits.hpp>
+#include <boost/asio.hpp>
+
+// Path to the data used in the unit tests
+#define DATA_ROOT "../data"
+
+// Test the order in which waiting operations are admitted
+TEST(test_scheduler, check_order)
+{
+    io_scheduler scheduler({1, 1024, 2.0, 1.0});
+
+    std::vector<std::string> started;
+    auto submit = [&](io_priority priority, const std::string &name, io_scheduler::clock::time_point deadline = io_scheduler::clock::time_point::max())
+    {
+        scheduler.submit(priority, 100, deadline, [&, name]
+                         { started.push_back(name); });
+    };
+
+    // The first operation takes the only slot, the others wait
+    submit(io_priority::bulk, "b0");
+    for (int i = 1; i <= 4; ++i)
+    {
+        submit(io_priority::bulk, "b" + std::to_string(i));
+    }
+    for (int i = 1; i <= 4; ++i)
+    {
+        submit(io_priority::interactive, "i" + std::to_string(i));
+    }
+    EXPECT_EQ(scheduler.in_flight(), 1);
+    EXPECT_EQ(scheduler.queued(), 8);
+
+    // Finishing at 50, 100, 150 and 200 in virtual time, the interactive operations get twice the bytes of the bulk ones
+    while (started.size() < 9)
+    {
+        scheduler.release();
+    }
+    EXPECT_EQ(started, (std::vector<std::string>{"b0", "i1", "i2", "i3", "b1", "i4", "b2", "b3", "b4"}));
+
+    // An operation past its deadline goes first, whatever its class
+    started.clear();
+    submit(io_priority::interactive, "i5");
+    submit(io_priority::bulk, "late", io_scheduler::clock::now() - std::chrono::seconds(1));
+    submit(io_priority::bulk, "later", io_scheduler::clock::now() + std::chrono::hours(1));
+    scheduler.release();
+    scheduler.release();
+    EXPECT_EQ(started, (std::vector<std::string>{"late", "i5"}));
+
+    scheduler.release();
+    scheduler.release();
+    EXPECT_EQ(started.back(), "later");
+    EXPECT_EQ(scheduler.queued(), 0);
+    EXPECT_EQ(scheduler.in_flight(), 0);
+}
+
+// Test asynchronous reads and writes going through a scheduler, split into chunks
+TEST(test_scheduler, check_files)
+{
+    std::filesystem::remove(DATA_ROOT "/scheduled.fits");
+
+    auto scheduler = std::make_shared<io_scheduler>(io_scheduler_options{2, 1000, 16.0, 1.0});
+
+    std::vector<float> pixels(100 * 50);
+    for (std::size_t i = 0; i < pixels.size(); ++i)
+    {
+        pixels[i] = static_cast<float>(i);
+    }
+
+    std::size_t writes = 0;
+    {
+        ofits<float> file{DATA_ROOT "/scheduled.fits", {{{100, 50}}}, 1, nullptr, [&](const io_event &event)
+                          {
+                              if (event.operation == io_operation::write && event.length > 0 && event.offset >= 2880)
+                              {
+                                  EXPECT_LE(event.length, 1000);
+                                  ++writes;
+                              }
+                          },
+                          io_schedule{scheduler, io_priority::bulk}};
+        file.get_hdu<0>().async_write_data({0}, boost::asio::buffer(pixels), [](const boost::system::error_code &error, std::size_t bytes)
+                                           {
+            EXPECT_FALSE(error);
+            EXPECT_EQ(bytes, 100 * 50 * sizeof(float)); });
+        file.run();
+    }
+    if constexpr (kLibFitsHooks)
+    {
+        EXPECT_EQ(writes, (pixels.size() * sizeof(float) + 999) / 1000);
+    }
+
+    ifits bulk(DATA_ROOT "/scheduled.fits", nullptr, {}, io_schedule{scheduler, io_priority::bulk});
+    ifits interactive(DATA_ROOT "/scheduled.fits", nullptr, {}, io_schedule{scheduler, io_priority::interactive, std::chrono::milliseconds(10)});
+
+    std::vector<float> all(pixels.size()), row(50);
+    ifits::hdu::image_hdu<float>(bulk.get_hdu<0>()).async_read_data({0}, boost::asio::buffer(all), [](const boost::system::error_code &error, std::size_t)
+                                                                     { EXPECT_FALSE(error); });
+    ifits::hdu::image_hdu<float>(interactive.get_hdu<0>()).async_read_data({40}, boost::asio::buffer(row), [](const boost::system::error_code &error, std::size_t)
+                                                                            { EXPECT_FALSE(error); });
+
+    std::thread bulk_thread([&]
+                            { bulk.run(); });
+    interactive.run();
+    bulk_thread.join();
+
+    EXPECT_EQ(all, pixels);
+    EXPECT_EQ(row, std::vector<float>(pixels.begin() + 40 * 50, pixels.begin() + 41 * 50));
+    EXPECT_EQ(scheduler->in_flight(), 0);
+    EXPECT_EQ(scheduler->queued(), 0);
+}
+
+// Test an operation of a file queued while the operations of another file hold every slot
+TEST(test_scheduler, check_queued_file)
+{
+    std::filesystem::remove(DATA_ROOT "/scheduled_queued.fits");
+
+    std::vector<float> pixels(100 * 50);
+    for (std::size_t i = 0; i < pixels.size(); ++i)
+    {
+        pixels[i] = static_cast<float>(i);
+    }
+
+    {
+        ofits<float> file{DATA_ROOT "/scheduled_queued.fits", {{{100, 50}}}};
+        file.write_data<0>({0}, boost::asio::buffer(pixels));
+    }
+
+    auto scheduler = std::make_shared<io_scheduler>(io_scheduler_options{1, 1000, 16.0, 1.0});
+
+    ifits bulk(DATA_ROOT "/scheduled_queued.fits", nullptr, {}, io_schedule{scheduler, io_priority::bulk});
+    ifits interactive(DATA_ROOT "/scheduled_queued.fits", nullptr, {}, io_schedule{scheduler, io_priority::interactive});
+
+    // The first chunk of the bulk read takes the only slot, the row waits in the queue
+    std::vector<float> all(pixels.size()), row(50);
+    ifits::hdu::image_hdu<float>(bulk.get_hdu<0>()).async_read_data({0}, boost::asio::buffer(all), [](const boost::system::error_code &error, std::size_t)
+                                                                     { EXPECT_FALSE(error); });
+
+    bool row_done = false;
+    ifits::hdu::image_hdu<float>(interactive.get_hdu<0>()).async_read_data({40}, boost::asio::buffer(row), [&](const boost::system::error_code &error, std::size_t)
+                                                                            {
+        EXPECT_FALSE(error);
+        row_done = true; });
+    EXPECT_EQ(scheduler->in_flight(), 1);
+    EXPECT_EQ(scheduler->queued(), 1);
+
+    // The interactive file has no operation started yet, its run() waits for the queued one
+    std::thread interactive_thread([&]
+                                   { interactive.run(); });
+    bulk.run();
+    interactive_thread.join();
+
+    EXPECT_TRUE(row_done);
+    EXPECT_EQ(all, pixels);
+    EXPECT_EQ(row, std::vector<float>(pixels.begin() + 40 * 50, pixels.begin() + 41 * 50));
+    EXPECT_EQ(scheduler->in_flight(), 0);
+    EXPECT_EQ(scheduler->queued(), 0);
+}
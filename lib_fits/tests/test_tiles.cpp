@@ -0,0 +1,141 @@
+// Unit tests for process_tiles and work_stealing_pool
+
+#include <gtest/gtest.h>
+#include <lib_fits.hpp>
+#include <boost/asio.hpp>
+
+// Path to the data used in the unit tests
+#define DATA_ROOT "../data"
+
+// Test that every submitted task runs once and exceptions reach wait()
+TEST(test_tiles, check_work_stealing_pool)
+{
+    std::vector<std::atomic<int>> runs(1000);
+    {
+        work_stealing_pool pool(4);
+        for (std::size_t i = 0; i < runs.size(); i += 10)
+        {
+            // Tasks submitted by the workers go to their own queues
+            pool.submit([&, i]
+                        {
+                for (std::size_t j = i; j < i + 10; ++j)
+                {
+                    pool.submit([&, j]
+                                { ++runs[j]; });
+                } });
+        }
+        pool.wait();
+    }
+    EXPECT_TRUE(std::all_of(runs.begin(), runs.end(), [](const auto &count)
+                            { return count == 1; }));
+
+    work_stealing_pool pool(2);
+    pool.submit([]
+                { throw std::runtime_error("Task failed"); });
+    EXPECT_THROW(pool.wait(), std::runtime_error);
+
+    // The pool runs tasks again after the failure was reported
+    std::atomic<int> reused{0};
+    pool.submit([&]
+                { ++reused; });
+    pool.wait();
+    EXPECT_EQ(reused, 1);
+}
+
+// Test a 3x3 box sum over tiles with halos against the direct sum
+TEST(test_tiles, check_box_filter)
+{
+    std::filesystem::remove(DATA_ROOT "/tiles_in.fits");
+    std::filesystem::remove(DATA_ROOT "/tiles_out.fits");
+
+    const std::size_t height = 50, width = 37;
+    std::vector<std::int16_t> pixels(height * width);
+    for (std::size_t i = 0; i < pixels.size(); ++i)
+    {
+        pixels[i] = static_cast<std::int16_t>(i * 31 % 101);
+    }
+
+    {
+        ofits<std::int16_t> file{DATA_ROOT "/tiles_in.fits", {{{height, width}}}};
+        file.write_data<0>({0}, boost::asio::buffer(pixels));
+    }
+
+    ifits in(DATA_ROOT "/tiles_in.fits");
+
+    auto box_sum = [](const image_tile &tile)
+    {
+        for (std::size_t y = 0; y < tile.region.count[0]; ++y)
+        {
+            for (std::size_t x = 0; x < tile.region.count[1]; ++x)
+            {
+                const std::ptrdiff_t row = static_cast<std::ptrdiff_t>(tile.region.start[0] + y);
+                const std::ptrdiff_t column = static_cast<std::ptrdiff_t>(tile.region.start[1] + x);
+
+                double sum = 0;
+                for (std::ptrdiff_t dy = -1; dy <= 1; ++dy)
+                {
+                    for (std::ptrdiff_t dx = -1; dx <= 1; ++dx)
+                    {
+                        const std::ptrdiff_t j = row + dy, i = column + dx;
+                        if (j >= static_cast<std::ptrdiff_t>(tile.input_region.start[0]) &&
+                            j < static_cast<std::ptrdiff_t>(tile.input_region.start[0] + tile.input_region.count[0]) &&
+                            i >= static_cast<std::ptrdiff_t>(tile.input_region.start[1]) &&
+                            i < static_cast<std::ptrdiff_t>(tile.input_region.start[1] + tile.input_region.count[1]))
+                        {
+                            sum += tile.in(static_cast<std::ptrdiff_t>(y) + dy, static_cast<std::ptrdiff_t>(x) + dx);
+                        }
+                    }
+                }
+                tile.out(y, x) = sum;
+            }
+        }
+    };
+
+    {
+        ofits<std::int32_t> out{DATA_ROOT "/tiles_out.fits", {{{height, width}}}};
+        tile_options options;
+        options.tile_rows = 7;
+        options.tile_columns = 10;
+        options.halo = 1;
+        options.memory_budget = 3 * (2 * 7 + 2) * width * sizeof(double); // Three bands in flight
+        options.threads = 4;
+        process_tiles(in.get_hdu<0>(), out.get_hdu<0>(), box_sum, options);
+
+        // One band does not fit
+        options.memory_budget = 100;
+        EXPECT_THROW(process_tiles(in.get_hdu<0>(), out.get_hdu<0>(), box_sum, options), std::runtime_error);
+
+        // Errors of the kernel reach the caller
+        options.memory_budget = std::size_t(1) << 20;
+        EXPECT_THROW(process_tiles(in.get_hdu<0>(), out.get_hdu<0>(), [&](const image_tile &tile)
+                                   {
+                                       if (tile.region.start[0] > 20)
+                                       {
+                                           throw std::runtime_error("Kernel failed");
+                                       }
+                                       box_sum(tile); },
+                                   options),
+                     std::runtime_error);
+    }
+
+    ifits result(DATA_ROOT "/tiles_out.fits");
+    std::vector<std::int32_t> sums(height * width);
+    ifits::hdu::image_hdu<std::int32_t>(result.get_hdu<0>()).read_data({0}, boost::asio::buffer(sums));
+
+    // The failed run may only have written bands before the failing tiles, with the same values
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        for (std::size_t x = 0; x < width; ++x)
+        {
+            std::int32_t sum = 0;
+            for (std::size_t j = y ? y - 1 : 0; j < std::min(height, y + 2); ++j)
+            {
+                for (std::size_t i = x ? x - 1 : 0; i < std::min(width, x + 2); ++i)
+                {
+                    sum += pixels[j * width + i];
+                }
+            }
+            ASSERT_EQ(sums[y * width + x], sum) << y << " " << x;
+        }
+    }
+}
@@ -0,0 +1,138 @@
+// Unit tests for transpose_cube
+
+#include <gtest/gtest.h>
+#include <lib_fits.hpp>
+#include <boost/asio.hpp>
+
+// Path to the data used in the unit tests
+#define DATA_ROOT "../data"
+
+namespace
+{
+    constexpr std::size_t kFrames = 7, kHeight = 5, kWidth = 6;
+
+    // Value of the pixel (y, x) of a frame
+    std::int16_t pixel_value(std::size_t frame, std::size_t y, std::size_t x)
+    {
+        return static_cast<std::int16_t>(100 * frame + 10 * y + x);
+    }
+
+    ifits &cube_file()
+    {
+        static const bool written = []
+        {
+            std::filesystem::remove(DATA_ROOT "/transpose_cube.fits");
+
+            std::vector<std::int16_t> pixels;
+            for (std::size_t frame = 0; frame < kFrames; ++frame)
+            {
+                for (std::size_t y = 0; y < kHeight; ++y)
+                {
+                    for (std::size_t x = 0; x < kWidth; ++x)
+                    {
+                        pixels.push_back(pixel_value(frame, y, x));
+                    }
+                }
+            }
+
+            ofits<std::int16_t> file{DATA_ROOT "/transpose_cube.fits", {{{kFrames, kHeight, kWidth}}}};
+            file.write_data<0>({0}, boost::asio::buffer(pixels));
+            return true;
+        }();
+        (void)written;
+
+        static ifits file(DATA_ROOT "/transpose_cube.fits");
+        return file;
+    }
+}
+
+// Test the pixel-major order, with slabs of whole rows and of parts of a row
+TEST(test_transpose, check_pixel_major)
+{
+    auto &cube = cube_file().get_hdu<0>();
+
+    // Four of the six columns per slab with the second budget
+    for (std::size_t budget : {std::size_t(1) << 20, 2 * 4 * kFrames * sizeof(double)})
+    {
+        std::filesystem::remove(DATA_ROOT "/transposed.fits");
+
+        transpose_options options;
+        options.memory_budget = budget;
+        options.threads = 3;
+        EXPECT_EQ(transposed_shape(cube.get_shape(), options), (std::vector<std::size_t>{kHeight, kWidth, kFrames}));
+
+        {
+            ofits<std::int16_t> out{DATA_ROOT "/transposed.fits", {{{kHeight, kWidth, kFrames}}}};
+            transpose_cube(cube, out.get_hdu<0>(), options);
+        }
+
+        ifits result(DATA_ROOT "/transposed.fits");
+        std::vector<std::int16_t> series(kHeight * kWidth * kFrames);
+        ifits::hdu::image_hdu<std::int16_t>(result.get_hdu<0>()).read_data({0}, boost::asio::buffer(series));
+
+        for (std::size_t y = 0; y < kHeight; ++y)
+        {
+            for (std::size_t x = 0; x < kWidth; ++x)
+            {
+                for (std::size_t frame = 0; frame < kFrames; ++frame)
+                {
+                    ASSERT_EQ(series[(y * kWidth + x) * kFrames + frame], pixel_value(frame, y, x)) << budget;
+                }
+            }
+        }
+    }
+
+    transpose_options options;
+    options.memory_budget = 8;
+    ofits<std::int16_t> out{DATA_ROOT "/transposed.fits", {{{kHeight, kWidth, kFrames}}}};
+    EXPECT_THROW(transpose_cube(cube, out.get_hdu<0>(), options), std::runtime_error);
+}
+
+// Test blocks of 2x4 pixels, padded at the edges
+TEST(test_transpose, check_tiled)
+{
+    auto &cube = cube_file().get_hdu<0>();
+    std::filesystem::remove(DATA_ROOT "/transposed_tiled.fits");
+
+    transpose_options options;
+    options.block_rows = 2;
+    options.block_columns = 4;
+    options.threads = 2;
+    EXPECT_EQ(transposed_shape(cube.get_shape(), options), (std::vector<std::size_t>{3, 2, kFrames, 2, 4}));
+
+    {
+        ofits<float> out{DATA_ROOT "/transposed_tiled.fits", {{{3, 2, kFrames, 2, 4}}}};
+        transpose_cube(cube, out.get_hdu<0>(), options);
+    }
+
+    ifits result(DATA_ROOT "/transposed_tiled.fits");
+    std::vector<float> tiles(3 * 2 * kFrames * 2 * 4);
+    ifits::hdu::image_hdu<float>(result.get_hdu<0>()).read_data({0}, boost::asio::buffer(tiles));
+
+    // Position of the pixel (y, x) of a frame in the blocks
+    auto position = [](std::size_t frame, std::size_t y, std::size_t x)
+    {
+        return (((y / 2 * 2 + x / 4) * kFrames + frame) * 2 + y % 2) * 4 + x % 4;
+    };
+
+    std::size_t padding = 0;
+    for (const float value : tiles)
+    {
+        padding += std::isnan(value);
+    }
+    EXPECT_EQ(padding, kFrames * (3 * 2 * 2 * 4 - kHeight * kWidth));
+
+    for (std::size_t frame = 0; frame < kFrames; ++frame)
+    {
+        for (std::size_t y = 0; y < kHeight; ++y)
+        {
+            for (std::size_t x = 0; x < kWidth; ++x)
+            {
+                ASSERT_EQ(tiles[position(frame, y, x)], pixel_value(frame, y, x));
+            }
+        }
+    }
+
+    ofits<float> wrong{DATA_ROOT "/transposed_tiled.fits", {{{kHeight, kWidth, kFrames}}}};
+    EXPECT_THROW(transpose_cube(cube, wrong.get_hdu<0>(), options), std::runtime_error);
+}